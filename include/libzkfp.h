@@ -442,6 +442,23 @@ ZKINTERFACE int APICALL ZKFPM_GetDeviceCount();
 	*/
 	ZKINTERFACE int APICALL ZKFPM_VerifyByID(HANDLE hDBCache, unsigned int fid, unsigned char* fpTemplate, unsigned int cbTemplate);
 
+	/**
+		*	@brief	Template quality score
+		*	@param	:
+		*	name			|	type		  |	param direction		|	description of param
+		*	----------------|-----------------|---------------------|------------------------
+		*	hDevice			|	HANDLE		  |	[in]				|	open device (ZKFPM_OpenDevice)
+		*	fpTemplate		|	unsigned char*|	[in]				|	fingerprint template
+		*	cbTemplate		|	unsigned int  | [in]				|	template size
+		*	@return
+		*	value			|	type		|	description of value
+		*	----------------|---------------|-------------------------------
+		*	0-100			|	int			|	quality, higher is better
+		*	<0				|	int			|	error code (ZKFP_ERR_INVALID_HANDLE when hDevice is not an open device)
+		*	@note	Exported by libzkfp.dll (see libzkfp.def) but missing from the vendor header
+	*/
+	ZKINTERFACE int APICALL ZKFPM_GetTemplateQuality(HANDLE hDevice, unsigned char* fpTemplate, unsigned int cbTemplate);
+
 	/**
 		*	@brief	ȡһⲿͼָ
 		*	@param	:
@@ -0,0 +1,224 @@
+#include "AdmissionController.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+
+const uint64_t StrideBase = 1u << 20;
+const size_t LatencyWindow = 4096;
+
+double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) return 0.0;
+    size_t k = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+TaskPriority priorityOf(size_t lane) {
+    return lane == (size_t)Lane::Bulk ? TaskPriority::Low : TaskPriority::High;
+}
+
+} // namespace
+
+const char* toString(Lane lane) {
+    switch (lane) {
+    case Lane::Verify: return "verify";
+    case Lane::Identify: return "identify";
+    case Lane::Bulk: return "bulk";
+    }
+    return "?";
+}
+
+AdmissionController::AdmissionController(size_t maxConcurrent, WorkerPool& pool)
+    : pool(pool), maxConcurrent(maxConcurrent ? maxConcurrent : pool.size()) {
+    // Door traffic is latency-bound and light; bulk gets what is left
+    LaneConfig verify;
+    verify.weight = 8;
+    verify.deadline = std::chrono::milliseconds(500);
+    verify.slo = std::chrono::milliseconds(200);
+    LaneConfig identify;
+    identify.weight = 4;
+    identify.deadline = std::chrono::milliseconds(1000);
+    identify.slo = std::chrono::milliseconds(500);
+    LaneConfig bulk;
+    bulk.weight = 1;
+    bulk.maxQueue = 256;
+    bulk.slo = std::chrono::milliseconds(10000);
+    lanes[(size_t)Lane::Verify].config = verify;
+    lanes[(size_t)Lane::Identify].config = identify;
+    lanes[(size_t)Lane::Bulk].config = bulk;
+}
+
+AdmissionController::~AdmissionController() {
+    drain();
+}
+
+void AdmissionController::configure(Lane lane, const LaneConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    lanes[(size_t)lane].config = config;
+    lanes[(size_t)lane].config.weight = std::max(1u, config.weight);
+}
+
+bool AdmissionController::submit(Lane lane, std::function<void()> job, Done done, Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex);
+    LaneState& state = lanes[(size_t)lane];
+    if (state.queue.size() >= state.config.maxQueue) {
+        state.rejected++;
+        lock.unlock();
+        if (done) done(Admission::Rejected);
+        return false;
+    }
+    Clock::time_point now = Clock::now();
+    if (deadline == Clock::time_point() && state.config.deadline.count() > 0) deadline = now + state.config.deadline;
+    // A lane that was idle rejoins at the current position instead of cashing in old credit
+    if (state.queue.empty()) state.pass = std::max(state.pass, globalPass);
+    state.queue.push_back({ std::move(job), std::move(done), now, deadline });
+    state.admitted++;
+    dispatch(lock);
+    return true;
+}
+
+void AdmissionController::dispatch(std::unique_lock<std::mutex>& lock) {
+    std::vector<std::pair<size_t, Request>> toRun, toShed;
+    Clock::time_point now = Clock::now();
+    while (running < maxConcurrent) {
+        size_t next = LaneCount;
+        for (size_t i = 0; i < LaneCount; ++i)
+            if (!lanes[i].queue.empty() && (next == LaneCount || lanes[i].pass < lanes[next].pass)) next = i;
+        if (next == LaneCount) break;
+
+        LaneState& state = lanes[next];
+        Request request = std::move(state.queue.front());
+        state.queue.pop_front();
+        if (request.deadline != Clock::time_point() && now > request.deadline) {
+            state.shed++;
+            toShed.emplace_back(next, std::move(request));
+            continue;
+        }
+        globalPass = state.pass;
+        state.pass += StrideBase / state.config.weight;
+        running++;
+        toRun.emplace_back(next, std::move(request));
+    }
+    lock.unlock();
+
+    for (auto& [lane, request] : toShed)
+        if (request.done) request.done(Admission::Shed);
+    for (auto& [lane, request] : toRun) {
+        pool.post([this, lane = lane, request = std::move(request)]() mutable {
+            request.job();
+            double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - request.submitted).count();
+            finish(lane, request, latencyMs);
+        }, priorityOf(lane));
+    }
+    lock.lock();
+    // Notified under the lock: drain() in the destructor must not return while we still hold it
+    if (isIdle()) idle.notify_all();
+}
+
+bool AdmissionController::isIdle() const {
+    return running == 0 && std::all_of(lanes.begin(), lanes.end(), [](const LaneState& l) { return l.queue.empty(); });
+}
+
+void AdmissionController::finish(size_t lane, const Request& request, double latencyMs) {
+    if (request.done) request.done(Admission::Completed);
+    std::unique_lock<std::mutex> lock(mutex);
+    LaneState& state = lanes[lane];
+    state.completed++;
+    if (latencyMs <= (double)state.config.slo.count()) state.withinSlo++;
+    if (state.latencies.size() < LatencyWindow) state.latencies.push_back(latencyMs);
+    else state.latencies[state.latencyCursor++ % LatencyWindow] = latencyMs;
+    running--;
+    dispatch(lock);
+}
+
+Admission AdmissionController::run(Lane lane, std::function<void()> job, Clock::time_point deadline) {
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
+    bool finished = false;
+    Admission result = Admission::Completed;
+    submit(lane, std::move(job), [&](Admission admission) {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        result = admission;
+        finished = true;
+        doneCv.notify_one();
+    }, deadline);
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCv.wait(lock, [&] { return finished; });
+    return result;
+}
+
+bool AdmissionController::runBulk(size_t count, const std::function<void(size_t, size_t)>& fn, size_t chunk,
+                                  const std::atomic<bool>* cancel) {
+    chunk = std::max<size_t>(1, chunk);
+    size_t limit;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        limit = std::max<size_t>(1, lanes[(size_t)Lane::Bulk].config.maxQueue / 2);
+    }
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
+    size_t outstanding = 0;
+    bool ok = true;
+    for (size_t begin = 0; begin < count && !(cancel && cancel->load()); begin += chunk) {
+        size_t end = std::min(count, begin + chunk);
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCv.wait(lock, [&] { return outstanding < limit; });
+            outstanding++;
+        }
+        submit(Lane::Bulk, [&fn, begin, end] { fn(begin, end); }, [&](Admission admission) {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (admission != Admission::Completed) ok = false;
+            outstanding--;
+            doneCv.notify_all();
+        });
+    }
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCv.wait(lock, [&] { return outstanding == 0; });
+    return ok;
+}
+
+void AdmissionController::drain() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return isIdle(); });
+}
+
+std::array<LaneStats, LaneCount> AdmissionController::stats() const {
+    std::array<LaneStats, LaneCount> result;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < LaneCount; ++i) {
+        const LaneState& state = lanes[i];
+        LaneStats& s = result[i];
+        s.admitted = state.admitted;
+        s.rejected = state.rejected;
+        s.shed = state.shed;
+        s.completed = state.completed;
+        s.withinSlo = state.withinSlo;
+        s.queued = state.queue.size();
+        s.sloMs = (double)state.config.slo.count();
+        s.p50Ms = percentile(state.latencies, 0.50);
+        s.p95Ms = percentile(state.latencies, 0.95);
+        s.p99Ms = percentile(state.latencies, 0.99);
+        s.maxMs = state.latencies.empty() ? 0.0 : *std::max_element(state.latencies.begin(), state.latencies.end());
+    }
+    return result;
+}
+
+std::string AdmissionController::summary() const {
+    std::ostringstream oss;
+    auto all = stats();
+    for (size_t i = 0; i < LaneCount; ++i) {
+        const LaneStats& s = all[i];
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "%-8s %llu done, %llu rejected, %llu shed, %zu queued; p50 %.1f ms, p95 %.1f ms, p99 %.1f ms; "
+                      "%.1f%% within %.0f ms SLO\n",
+                      toString((Lane)i), (unsigned long long)s.completed, (unsigned long long)s.rejected,
+                      (unsigned long long)s.shed, s.queued, s.p50Ms, s.p95Ms, s.p99Ms,
+                      100.0 * s.sloAttainment(), s.sloMs);
+        oss << line;
+    }
+    return oss.str();
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "WorkerPool.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Request classes competing for the SDK: people at the door first, bulk jobs last
+enum class Lane { Verify = 0, Identify = 1, Bulk = 2 };
+constexpr size_t LaneCount = 3;
+const char* toString(Lane lane);
+
+struct LaneConfig {
+    unsigned weight = 1;                      // share of dispatches while several lanes are waiting
+    size_t maxQueue = 64;                     // submissions beyond this are rejected
+    std::chrono::milliseconds deadline{ 0 };  // default time a request may wait to start (0 = none)
+    std::chrono::milliseconds slo{ 100 };     // end-to-end latency target, for reporting
+};
+
+enum class Admission {
+    Completed,
+    Rejected, // lane queue full
+    Shed,     // deadline passed before it could start
+};
+
+struct LaneStats {
+    uint64_t admitted = 0;
+    uint64_t rejected = 0;
+    uint64_t shed = 0;
+    uint64_t completed = 0;
+    uint64_t withinSlo = 0;
+    size_t queued = 0;
+    double sloMs = 0.0;
+    double p50Ms = 0.0; // over the most recent completions
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+
+    double sloAttainment() const { return completed ? (double)withinSlo / completed : 1.0; }
+};
+
+// Admission control in front of the shared pool. At most maxConcurrent
+// requests run at once; the rest wait in per-lane queues and are dispatched
+// by stride scheduling on the lane weights, so a deep bulk backlog delays
+// a verify by at most the bulk work already running. Requests that would
+// start after their deadline are shed instead of run late.
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Done = std::function<void(Admission)>;
+
+    // maxConcurrent = 0 uses the pool size
+    explicit AdmissionController(size_t maxConcurrent = 0, WorkerPool& pool = WorkerPool::shared());
+    ~AdmissionController();
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    void configure(Lane lane, const LaneConfig& config);
+
+    // Never blocks. done() runs on the pool after the job, or inline when the
+    // request is rejected. A zero deadline means the lane default.
+    bool submit(Lane lane, std::function<void()> job, Done done = nullptr, Clock::time_point deadline = {});
+    // Blocking form for door threads (not for use from inside the pool)
+    Admission run(Lane lane, std::function<void()> job, Clock::time_point deadline = {});
+    // fn(begin, end) over [0, count) in chunks through the Bulk lane. Keeps
+    // the lane queue topped up without ever being rejected; blocks until done.
+    // Setting *cancel stops submitting further chunks.
+    bool runBulk(size_t count, const std::function<void(size_t, size_t)>& fn, size_t chunk = 64,
+                 const std::atomic<bool>* cancel = nullptr);
+
+    // Wait until every queued and running request has finished
+    void drain();
+
+    std::array<LaneStats, LaneCount> stats() const;
+    std::string summary() const;
+
+private:
+    struct Request {
+        std::function<void()> job;
+        Done done;
+        Clock::time_point submitted;
+        Clock::time_point deadline;
+    };
+    struct LaneState {
+        LaneConfig config;
+        std::deque<Request> queue;
+        uint64_t pass = 0; // stride scheduling position
+        uint64_t admitted = 0, rejected = 0, shed = 0, completed = 0, withinSlo = 0;
+        std::vector<double> latencies; // ring of recent end-to-end latencies (ms)
+        size_t latencyCursor = 0;
+    };
+
+    void dispatch(std::unique_lock<std::mutex>& lock);
+    void finish(size_t lane, const Request& request, double latencyMs);
+    bool isIdle() const; // caller holds mutex
+
+    WorkerPool& pool;
+    size_t maxConcurrent;
+    mutable std::mutex mutex;
+    std::condition_variable idle;
+    std::array<LaneState, LaneCount> lanes;
+    uint64_t globalPass = 0;
+    size_t running = 0;
+};
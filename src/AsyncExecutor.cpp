@@ -0,0 +1,31 @@
+#include "AsyncExecutor.h"
+
+// ===== Strand =====
+
+void Strand::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(job));
+        if (running) return;
+        running = true;
+    }
+    pool.post([this] { runNext(); }, priority, affinity);
+}
+
+void Strand::runNext() {
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = std::move(pending.front());
+        pending.pop_front();
+    }
+    job();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty()) {
+            running = false;
+            return;
+        }
+    }
+    pool.post([this] { runNext(); }, priority, affinity);
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "WorkerPool.h"
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Coroutine layer for the awaitable device API, running on the shared
+// WorkerPool: strands serialize work on one SDK handle, and sleepFor() parks
+// a coroutine on the pool's timer so waiting never holds a worker.
+
+// Runs posted jobs one at a time, in order, on a WorkerPool. Used for every
+// call that touches one SDK device or DB cache handle; the jobs are pinned to
+// one worker so the handle is only ever used from that thread.
+class Strand {
+public:
+    explicit Strand(WorkerPool& pool, TaskPriority priority = TaskPriority::High)
+        : pool(pool), affinity(pool.nextAffinity()), priority(priority) {}
+    void post(std::function<void()> job);
+    WorkerPool& getPool() { return pool; }
+    int getAffinity() const { return affinity; }
+
+private:
+    void runNext();
+
+    WorkerPool& pool;
+    int affinity;
+    TaskPriority priority;
+    std::mutex mutex;
+    std::deque<std::function<void()>> pending;
+    bool running = false;
+};
+
+// ===== Task<T> =====
+
+template <typename T>
+class Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                auto next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    ~Task() { if (handle) handle.destroy(); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() {
+        if (handle.promise().error) std::rethrow_exception(handle.promise().error);
+        return std::move(*handle.promise().value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    std::coroutine_handle<promise_type> handle;
+};
+
+// ===== Awaitables =====
+
+// co_await offload(strand, fn): run a blocking call on the strand, resume on the pool thread with its result
+template <typename Fn>
+auto offload(Strand& strand, Fn fn) {
+    using R = decltype(fn());
+    struct Awaiter {
+        Strand& strand;
+        Fn fn;
+        std::optional<R> result;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            strand.post([this, h] {
+                result.emplace(fn());
+                strand.getPool().post([h] { h.resume(); });
+            });
+        }
+        R await_resume() { return std::move(*result); }
+    };
+    return Awaiter{ strand, std::move(fn), std::nullopt };
+}
+
+// co_await sleepFor(pool, d): suspend without holding a worker
+inline auto sleepFor(WorkerPool& pool, std::chrono::steady_clock::duration delay) {
+    struct Awaiter {
+        WorkerPool& pool;
+        std::chrono::steady_clock::duration delay;
+        bool await_ready() const noexcept { return delay <= std::chrono::steady_clock::duration::zero(); }
+        void await_suspend(std::coroutine_handle<> h) { pool.postAfter(delay, [h] { h.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{ pool, delay };
+}
+
+// ===== Launching =====
+
+namespace detail {
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+template <typename T, typename Fn>
+DetachedTask runDetached(Task<T> task, Fn onDone) {
+    onDone(co_await task);
+}
+} // namespace detail
+
+// Start a task without blocking; onDone(result) is called on whichever thread finishes it
+template <typename T, typename Fn>
+void spawn(Task<T> task, Fn onDone) {
+    detail::runDetached(std::move(task), std::move(onDone));
+}
+
+// Block the calling thread until the task completes (for main/GUI glue code)
+template <typename T>
+T syncWait(Task<T> task) {
+    std::promise<T> done;
+    std::future<T> result = done.get_future();
+    spawn(std::move(task), [&done](T value) { done.set_value(std::move(value)); });
+    return result.get();
+}
@@ -0,0 +1,121 @@
+#include "AsyncFingerprintDevice.h"
+
+const char* toString(FpError error) {
+    switch (error) {
+    case FpError::Ok:              return "OK";
+    case FpError::NotInitialized:  return "SDK not initialized";
+    case FpError::NoDevice:        return "No fingerprint device";
+    case FpError::DeviceNotOpen:   return "Device not opened";
+    case FpError::Timeout:         return "Timed out";
+    case FpError::CaptureFailed:   return "Capture failed";
+    case FpError::ExtractFailed:   return "Template extraction failed";
+    case FpError::NoMatch:         return "No match";
+    case FpError::InvalidTemplate: return "Invalid template";
+    case FpError::SdkError:        return "SDK error";
+    }
+    return "Unknown";
+}
+
+AsyncFingerprintDevice::AsyncFingerprintDevice(FingerprintDevice& device, WorkerPool& pool)
+    : device(device), pool(pool), strand(pool) {}
+
+// Called on the strand, right after a failed sync call
+FpStatus AsyncFingerprintDevice::failure(FpError error) const {
+    return { error, device.getLastErrorCode(), device.getLastError() };
+}
+
+FpStatus AsyncFingerprintDevice::matchFailure() const {
+    switch (device.getLastErrorCode()) {
+    case ZKFP_ERR_INVALID_HANDLE: return failure(FpError::NotInitialized); // no DB cache
+    case ZKFP_ERR_INVALID_PARAM:  return failure(FpError::InvalidTemplate);
+    case ZKFP_ERR_OK:
+    case ZKFP_ERR_FAIL:           return failure(FpError::NoMatch);
+    default:                      return failure(FpError::SdkError);
+    }
+}
+
+Task<FpStatus> AsyncFingerprintDevice::initialize() {
+    co_return co_await offload(strand, [this]() -> FpStatus {
+        if (!device.initialize()) return failure(FpError::NotInitialized);
+        return {};
+    });
+}
+
+Task<FpStatus> AsyncFingerprintDevice::open(int index) {
+    co_return co_await offload(strand, [this, index]() -> FpStatus {
+        int count = device.getDeviceCount();
+        if (count < 0) return { FpError::NotInitialized, ZKFP_ERR_INIT, "SDK not initialized." };
+        if (count <= index) return { FpError::NoDevice, ZKFP_ERR_NO_DEVICE, "No device at index " + std::to_string(index) + "." };
+        if (!device.openDevice(index)) return failure(FpError::DeviceNotOpen);
+        return {};
+    });
+}
+
+Task<FpStatus> AsyncFingerprintDevice::close() {
+    co_return co_await offload(strand, [this]() -> FpStatus {
+        device.closeDevice();
+        return {};
+    });
+}
+
+Task<CaptureResult> AsyncFingerprintDevice::acquire(Clock::time_point deadline, Clock::duration pollInterval) {
+    for (;;) {
+        CaptureResult result = co_await offload(strand, [this]() {
+            CaptureResult r;
+            if (!device.canCapture()) {
+                r.status = { FpError::DeviceNotOpen, ZKFP_ERR_INVALID_HANDLE, "Device not opened." };
+                return r;
+            }
+            if (device.acquireLiveFingerprint(r.image, r.width, r.height))
+                r.fpTemplate = device.getLastTemplate();
+            else
+                r.status = failure(FpError::CaptureFailed);
+            return r;
+        });
+
+        // ZKFP_ERR_CAPTURE is the sensor's "no finger"; anything else (including a
+        // finished replay) will not go away by polling again
+        if (result.status.ok() || result.status.sdkCode != ZKFP_ERR_CAPTURE) co_return result;
+        if (Clock::now() + pollInterval >= deadline) {
+            result.status.error = FpError::Timeout;
+            co_return result;
+        }
+        // No finger yet: give the worker back until the next poll
+        co_await sleepFor(pool, pollInterval);
+    }
+}
+
+Task<MatchResult> AsyncFingerprintDevice::identify(std::vector<unsigned char> tpl) {
+    co_return co_await offload(strand, [this, tpl = std::move(tpl)]() {
+        MatchResult r;
+        if (tpl.empty()) {
+            r.status = { FpError::InvalidTemplate, ZKFP_ERR_INVALID_PARAM, "Empty template." };
+            return r;
+        }
+        unsigned int score = 0;
+        if (device.identifyTemplate(tpl.data(), static_cast<unsigned int>(tpl.size()), r.fid, score))
+            r.score = static_cast<int>(score);
+        else
+            r.status = matchFailure();
+        return r;
+    });
+}
+
+Task<MatchResult> AsyncFingerprintDevice::verify(unsigned int fid, std::vector<unsigned char> tpl) {
+    co_return co_await offload(strand, [this, fid, tpl = std::move(tpl)]() {
+        MatchResult r;
+        r.fid = fid;
+        if (!device.verifyTemplate(fid, tpl.data(), static_cast<unsigned int>(tpl.size()), r.score))
+            r.status = matchFailure();
+        return r;
+    });
+}
+
+Task<MatchResult> AsyncFingerprintDevice::enroll(std::vector<unsigned char> tpl) {
+    co_return co_await offload(strand, [this, tpl = std::move(tpl)]() {
+        MatchResult r;
+        if (!device.enrollTemplate(tpl.data(), static_cast<unsigned int>(tpl.size()), r.fid))
+            r.status = failure(FpError::SdkError);
+        return r;
+    });
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "AsyncExecutor.h"
+#include "FingerprintDevice.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Typed result codes for the awaitable API (the sync API only has lastError strings)
+enum class FpError {
+    Ok = 0,
+    NotInitialized,
+    NoDevice,
+    DeviceNotOpen,
+    Timeout,
+    CaptureFailed,
+    ExtractFailed,
+    NoMatch,
+    InvalidTemplate,
+    SdkError,
+};
+
+const char* toString(FpError error);
+
+struct FpStatus {
+    FpError error = FpError::Ok;
+    int sdkCode = ZKFP_ERR_OK;
+    std::string message;
+
+    bool ok() const { return error == FpError::Ok; }
+};
+
+struct CaptureResult {
+    FpStatus status;
+    CaptureBuffer image;
+    int width = 0;
+    int height = 0;
+    TemplateBuffer fpTemplate;
+};
+
+struct MatchResult {
+    FpStatus status;
+    unsigned int fid = 0;
+    int score = 0;
+};
+
+// Awaitable front end over one FingerprintDevice. All SDK calls for the device
+// run on a single strand of the shared pool, so any number of sessions can
+// co_await it while only the pool's threads ever block inside the SDK.
+class AsyncFingerprintDevice {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit AsyncFingerprintDevice(FingerprintDevice& device, WorkerPool& pool = WorkerPool::shared());
+
+    Task<FpStatus> initialize();
+    Task<FpStatus> open(int index = 0);
+    Task<FpStatus> close();
+
+    // Poll the sensor until a fingerprint is captured or the deadline passes.
+    // Only "no finger yet" is retried; any other capture error is returned at once.
+    Task<CaptureResult> acquire(Clock::time_point deadline,
+                                Clock::duration pollInterval = std::chrono::milliseconds(50));
+
+    Task<MatchResult> identify(std::vector<unsigned char> tpl);
+    Task<MatchResult> verify(unsigned int fid, std::vector<unsigned char> tpl);
+    Task<MatchResult> enroll(std::vector<unsigned char> tpl);
+
+    FingerprintDevice& getDevice() { return device; }
+    WorkerPool& getPool() { return pool; }
+
+private:
+    FpStatus failure(FpError error) const;
+    // A failed identify/verify: NoMatch unless the SDK call itself failed
+    FpStatus matchFailure() const;
+
+    FingerprintDevice& device;
+    WorkerPool& pool;
+    Strand strand;
+};
@@ -0,0 +1,84 @@
+#include "Base64.h"
+#include <array>
+
+namespace base64 {
+
+namespace {
+
+const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr unsigned char kPad = 0xFD;
+constexpr unsigned char kSkip = 0xFE;
+constexpr unsigned char kBad = 0xFF;
+
+std::array<unsigned char, 256> buildDecodeTable() {
+    std::array<unsigned char, 256> table;
+    table.fill(kBad);
+    for (unsigned char i = 0; i < 64; ++i) table[(unsigned char)kAlphabet[i]] = i;
+    table[(unsigned char)'='] = kPad;
+    table[(unsigned char)' '] = kSkip;
+    table[(unsigned char)'\t'] = kSkip;
+    table[(unsigned char)'\r'] = kSkip;
+    table[(unsigned char)'\n'] = kSkip;
+    return table;
+}
+
+const std::array<unsigned char, 256> kDecode = buildDecodeTable();
+
+} // namespace
+
+size_t encodedSize(size_t rawSize) {
+    return (rawSize + 2) / 3 * 4;
+}
+
+void encode(const unsigned char* data, size_t size, std::string& out) {
+    size_t base = out.size();
+    out.resize(base + encodedSize(size));
+    char* p = &out[base];
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        unsigned v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *p++ = kAlphabet[(v >> 18) & 63];
+        *p++ = kAlphabet[(v >> 12) & 63];
+        *p++ = kAlphabet[(v >> 6) & 63];
+        *p++ = kAlphabet[v & 63];
+    }
+    if (i < size) {
+        unsigned v = data[i] << 16;
+        if (i + 1 < size) v |= data[i + 1] << 8;
+        *p++ = kAlphabet[(v >> 18) & 63];
+        *p++ = kAlphabet[(v >> 12) & 63];
+        *p++ = (i + 1 < size) ? kAlphabet[(v >> 6) & 63] : '=';
+        *p++ = '=';
+    }
+}
+
+bool decode(const char* text, size_t length, std::vector<unsigned char>& out) {
+    out.clear();
+    out.reserve(length / 4 * 3);
+    unsigned acc = 0;
+    int bits = 0;
+    size_t symbols = 0, padding = 0;
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char d = kDecode[(unsigned char)text[i]];
+        if (d == kSkip) continue;
+        if (d == kPad) {
+            padding++;
+            continue;
+        }
+        if (d == kBad || padding) return false; // data after padding
+        acc = (acc << 6) | d;
+        bits += 6;
+        symbols++;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back((unsigned char)(acc >> bits));
+        }
+    }
+    // Padding may only complete the last quantum ("xx==" or "xxx="); unpadded
+    // input is accepted, but never a lone symbol in the last quantum
+    if (padding) return padding <= 2 && (symbols + padding) % 4 == 0;
+    return symbols % 4 != 1;
+}
+
+} // namespace base64
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Standard (RFC 4648) base64, the same encoding ZKFPM_BlobToBase64 produces.
+// Plain functions so bulk jobs can run them on many threads at once.
+namespace base64 {
+
+size_t encodedSize(size_t rawSize);
+void encode(const unsigned char* data, size_t size, std::string& out);
+// Returns false on characters outside the alphabet and on '=' anywhere but as
+// trailing padding; whitespace is skipped
+bool decode(const char* text, size_t length, std::vector<unsigned char>& out);
+
+} // namespace base64
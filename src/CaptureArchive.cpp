@@ -0,0 +1,268 @@
+#include "CaptureArchive.h"
+#include "GrayCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <sstream>
+
+namespace {
+
+const char ArchiveMagic[4] = { 'Z', 'K', 'A', 'R' };
+const uint32_t ArchiveVersion = 1;
+const size_t RecordHeaderSize = 28;
+
+size_t paddedSize(size_t size) { return (size + 7) & ~size_t(7); }
+
+std::tm localTime(uint64_t unixTimeUs) {
+    std::time_t seconds = (std::time_t)(unixTimeUs / 1000000);
+    std::tm tm{};
+    localtime_s(&tm, &seconds);
+    return tm;
+}
+
+} // namespace
+
+std::string ArchiveStats::summary() const {
+    std::ostringstream oss;
+    oss << archived << "/" << submitted << " frames archived, " << dropped << " dropped, "
+        << writeErrors << " write errors, " << pending << " pending; "
+        << batches << " batches in " << files << " files";
+    if (storedBytes) {
+        char ratio[32];
+        std::snprintf(ratio, sizeof(ratio), ", %.2fx compression", compressionRatio());
+        oss << ratio;
+    }
+    return oss.str();
+}
+
+CaptureArchiver::CaptureArchiver(WorkerPool& pool) : pool(pool) {}
+
+CaptureArchiver::~CaptureArchiver() {
+    stop();
+    for (Frame* f : freeFrames) delete f;
+}
+
+bool CaptureArchiver::start(const ArchiveOptions& archiveOptions) {
+    stop();
+    std::error_code error;
+    std::filesystem::create_directories(archiveOptions.rootDir, error);
+    if (archiveOptions.rootDir.empty() || error) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastError = "Cannot create archive directory: " + archiveOptions.rootDir;
+        return false;
+    }
+    options = archiveOptions;
+    options.maxPendingFrames = std::max<size_t>(1, options.maxPendingFrames);
+    options.batchFrames = std::max<size_t>(1, options.batchFrames);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        written = ArchiveStats();
+        lastError.clear();
+    }
+    submitted = 0;
+    dropped = 0;
+    stopping = false;
+    running = true;
+    writer = std::thread([this] { writerLoop(); });
+    return true;
+}
+
+void CaptureArchiver::stop() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCv.notify_all();
+    writer.join();
+    running = false;
+}
+
+// ===== Capture side =====
+
+bool CaptureArchiver::submit(const unsigned char* image, int width, int height,
+                             const unsigned char* tpl, unsigned int templateSize) {
+    if (!running || !image || width <= 0 || height <= 0) return false;
+    submitted++;
+    if (pending.fetch_add(1) >= options.maxPendingFrames) {
+        pending--;
+        dropped++;
+        return false;
+    }
+
+    Frame* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(freeMutex);
+        if (!freeFrames.empty()) {
+            frame = freeFrames.back();
+            freeFrames.pop_back();
+        }
+    }
+    if (!frame) frame = new Frame;
+    frame->unixTimeUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    frame->width = width;
+    frame->height = height;
+    frame->image.assign(image, image + (size_t)width * height);
+    frame->fpTemplate.assign(tpl, tpl + (tpl ? templateSize : 0));
+    pool.post([this, frame] { compress(frame); }, TaskPriority::Low);
+    return true;
+}
+
+void CaptureArchiver::compress(Frame* frame) {
+    frame->payload.clear();
+    GrayCodec::encode(frame->image.data(), frame->width, frame->height, frame->payload);
+    frame->codec = ArchiveCodec::Gray;
+    if (frame->payload.size() >= frame->image.size()) { // noise-like frame: store as is
+        frame->payload.swap(frame->image);
+        frame->codec = ArchiveCodec::Raw;
+    }
+    // Notify under the lock: once the frame is visible the writer may finish and stop() return
+    std::lock_guard<std::mutex> lock(queueMutex);
+    ready.push_back(frame);
+    queueCv.notify_one();
+}
+
+void CaptureArchiver::recycle(Frame* frame) {
+    std::lock_guard<std::mutex> lock(freeMutex);
+    if (freeFrames.size() < options.maxPendingFrames) freeFrames.push_back(frame);
+    else delete frame;
+}
+
+// ===== Writer thread =====
+
+void CaptureArchiver::writerLoop() {
+    std::vector<Frame*> batch;
+    for (;;) {
+        bool finishing;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCv.wait_for(lock, options.flushInterval,
+                             [&] { return stopping || ready.size() >= options.batchFrames; });
+            batch.swap(ready);
+            finishing = stopping;
+        }
+        if (!batch.empty()) {
+            writeBatch(batch);
+            size_t count = batch.size();
+            for (Frame* f : batch) recycle(f);
+            batch.clear();
+            pending -= count;
+        }
+        // On stop, keep going until frames still being compressed have been written
+        if (finishing && pending.load() == 0) break;
+        if (finishing) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    currentDay.clear();
+}
+
+bool CaptureArchiver::openFileFor(uint64_t unixTimeUs) {
+    std::tm tm = localTime(unixTimeUs);
+    char day[16], clock[16];
+    std::strftime(day, sizeof(day), "%Y-%m-%d", &tm);
+    std::strftime(clock, sizeof(clock), "%H%M%S", &tm);
+    if (file && currentDay == day && fileBytes < options.maxFileBytes) return true;
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    std::filesystem::path dir = std::filesystem::path(options.rootDir) / day;
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    std::filesystem::path path;
+    do {
+        path = dir / ("capture-" + std::string(clock) + "-" + std::to_string(fileSequence++) + ".zka");
+    } while (std::filesystem::exists(path, error));
+
+    file = std::fopen(path.string().c_str(), "wb");
+    if (!file || std::fwrite(ArchiveMagic, 1, 4, file) != 4 || std::fwrite(&ArchiveVersion, 4, 1, file) != 1) {
+        if (file) std::fclose(file);
+        file = nullptr;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastError = "Cannot create archive file: " + path.string();
+        return false;
+    }
+    currentDay = day;
+    fileBytes = 8;
+    std::lock_guard<std::mutex> lock(statsMutex);
+    written.files++;
+    written.storedBytes += 8;
+    return true;
+}
+
+bool CaptureArchiver::writeBatch(std::vector<Frame*>& batch) {
+    static const unsigned char zeros[8] = {};
+    uint64_t rawBytes = 0, storedBytes = 0;
+    size_t archived = 0;
+    bool ok = true;
+    for (Frame* f : batch) {
+        if (!openFileFor(f->unixTimeUs)) {
+            ok = false;
+            break;
+        }
+        uint32_t w = (uint32_t)f->width, h = (uint32_t)f->height, codec = (uint32_t)f->codec;
+        uint32_t payloadSize = (uint32_t)f->payload.size(), templateSize = (uint32_t)f->fpTemplate.size();
+        unsigned char header[RecordHeaderSize];
+        std::memcpy(header, &f->unixTimeUs, 8);
+        std::memcpy(header + 8, &w, 4);
+        std::memcpy(header + 12, &h, 4);
+        std::memcpy(header + 16, &codec, 4);
+        std::memcpy(header + 20, &payloadSize, 4);
+        std::memcpy(header + 24, &templateSize, 4);
+        size_t body = (size_t)payloadSize + templateSize;
+        size_t pad = paddedSize(RecordHeaderSize + body) - RecordHeaderSize - body;
+        if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header) ||
+            std::fwrite(f->payload.data(), 1, payloadSize, file) != payloadSize ||
+            std::fwrite(f->fpTemplate.data(), 1, templateSize, file) != templateSize ||
+            std::fwrite(zeros, 1, pad, file) != pad) {
+            ok = false;
+            break;
+        }
+        size_t recordBytes = RecordHeaderSize + body + pad;
+        fileBytes += recordBytes;
+        storedBytes += recordBytes;
+        rawBytes += (uint64_t)w * h;
+        archived++;
+    }
+    // One flush per batch rather than per frame
+    if (file && std::fflush(file) != 0) {
+        ok = false;
+        archived = 0;
+    }
+    if (!ok && file) { // start a fresh file rather than append after a partial record
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    written.archived += archived;
+    written.writeErrors += batch.size() - archived;
+    written.rawBytes += rawBytes;
+    written.storedBytes += storedBytes;
+    written.batches++;
+    if (!ok && lastError.empty()) lastError = "Failed to write archive batch.";
+    return ok;
+}
+
+ArchiveStats CaptureArchiver::stats() const {
+    ArchiveStats s;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        s = written;
+    }
+    s.submitted = submitted.load();
+    s.dropped = dropped.load();
+    s.pending = pending.load();
+    return s;
+}
+
+std::string CaptureArchiver::getLastError() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return lastError;
+}
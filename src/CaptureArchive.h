@@ -0,0 +1,111 @@
+#pragma once
+#include "MemoryAccounting.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Audit archive of captured images, kept off the capture path. submit() only
+// copies the frame into a pooled buffer and returns; compression (GrayCodec)
+// runs on the shared pool at Low priority and a writer thread appends frames
+// in batches to date-sharded files:
+//   <root>/YYYY-MM-DD/capture-HHMMSS-<n>.zka
+//   header  "ZKAR" + u32 version
+//   records [u64 unixTimeUs][u32 width][u32 height][u32 codec][u32 payloadSize]
+//           [u32 templateSize][payload][template bytes], padded to 8 bytes
+// At most maxPendingFrames are in flight (queued, compressing or waiting for
+// the disk); beyond that new frames are dropped and counted, never waited on.
+struct ArchiveOptions {
+    std::string rootDir;
+    size_t maxPendingFrames = 64;
+    size_t batchFrames = 16;
+    std::chrono::milliseconds flushInterval{ 1000 }; // a partial batch is written after this
+    uint64_t maxFileBytes = 256ull << 20;           // roll to a new file past this size
+};
+
+enum class ArchiveCodec : uint32_t { Raw = 0, Gray = 1 };
+
+struct ArchiveStats {
+    uint64_t submitted = 0;
+    uint64_t archived = 0;
+    uint64_t dropped = 0;     // queue full: the disk or the pool fell behind
+    uint64_t writeErrors = 0; // frames lost to failed writes
+    uint64_t rawBytes = 0;    // image bytes of archived frames
+    uint64_t storedBytes = 0; // bytes written, headers included
+    uint64_t batches = 0;
+    uint64_t files = 0;
+    size_t pending = 0;
+
+    double compressionRatio() const { return storedBytes ? (double)rawBytes / storedBytes : 0.0; }
+    std::string summary() const;
+};
+
+class CaptureArchiver {
+public:
+    explicit CaptureArchiver(WorkerPool& pool = WorkerPool::shared());
+    ~CaptureArchiver();
+    CaptureArchiver(const CaptureArchiver&) = delete;
+    CaptureArchiver& operator=(const CaptureArchiver&) = delete;
+
+    bool start(const ArchiveOptions& options);
+    // Writes whatever is still pending, then closes the current file
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Never blocks on compression or I/O; false if the frame was dropped
+    bool submit(const unsigned char* image, int width, int height,
+                const unsigned char* tpl, unsigned int templateSize);
+
+    ArchiveStats stats() const;
+    std::string getLastError() const;
+
+private:
+    struct Frame {
+        uint64_t unixTimeUs = 0;
+        int width = 0;
+        int height = 0;
+        CaptureBuffer image;
+        TemplateBuffer fpTemplate;
+        CaptureBuffer payload;
+        ArchiveCodec codec = ArchiveCodec::Raw;
+    };
+
+    void compress(Frame* frame);
+    void writerLoop();
+    bool writeBatch(std::vector<Frame*>& batch);
+    bool openFileFor(uint64_t unixTimeUs);
+    void recycle(Frame* frame);
+
+    WorkerPool& pool;
+    ArchiveOptions options;
+    bool running = false;
+
+    std::atomic<size_t> pending{ 0 };
+    std::atomic<uint64_t> submitted{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+
+    std::mutex freeMutex;
+    std::vector<Frame*> freeFrames; // recycled buffers, so steady state allocates nothing
+
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::vector<Frame*> ready; // compressed, waiting for the writer
+    bool stopping = false;
+    std::thread writer;
+
+    // Writer thread only (stats are read under statsMutex)
+    FILE* file = nullptr;
+    std::string currentDay;
+    uint64_t fileBytes = 0;
+    unsigned fileSequence = 0;
+
+    mutable std::mutex statsMutex;
+    ArchiveStats written;
+    std::string lastError;
+};
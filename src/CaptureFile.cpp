@@ -0,0 +1,217 @@
+#include "CaptureFile.h"
+#include "libzkfptype.h"
+#include <cstring>
+#include <io.h>
+
+namespace {
+
+const char CaptureMagic[4] = { 'Z', 'K', 'C', 'F' };
+const uint32_t CaptureVersion = 1;
+const size_t HeaderSize = 8;
+const size_t RecordHeaderSize = 24;
+
+size_t paddedSize(size_t size) { return (size + 7) & ~size_t(7); }
+
+// True when nothing but (part of) a capture header is there to lose: a missing
+// file, an empty one, or a header cut short before the first record
+bool safeToCreate(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return true;
+    unsigned char head[HeaderSize + 1];
+    size_t got = std::fread(head, 1, sizeof(head), f);
+    std::fclose(f);
+    unsigned char expected[HeaderSize];
+    std::memcpy(expected, CaptureMagic, 4);
+    std::memcpy(expected + 4, &CaptureVersion, 4);
+    return got < HeaderSize && std::memcmp(head, expected, got) == 0;
+}
+
+uint64_t readU64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+uint32_t readU32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+} // namespace
+
+// ===== Recorder =====
+
+CaptureRecorder::~CaptureRecorder() {
+    close();
+}
+
+bool CaptureRecorder::open(const std::string& path) {
+    close();
+    frames = 0;
+    timestampBase = 0;
+
+    // Appending to an existing recording keeps its timeline monotonic
+    long long end = 0;
+    {
+        CaptureReader existing;
+        if (existing.open(path)) {
+            if (existing.size()) timestampBase = existing.frame(existing.size() - 1).timestampUs + 1;
+            frames = existing.size();
+            end = (long long)existing.validBytes();
+        } else if (!safeToCreate(path)) {
+            // Never truncate a file that is not ours (a mistyped path, another format)
+            lastError = existing.getLastError() + " (refusing to overwrite it)";
+            return false;
+        }
+    }
+
+    file = std::fopen(path.c_str(), end ? "r+b" : "wb");
+    if (!file) {
+        lastError = "Cannot open capture file: " + path;
+        return false;
+    }
+    if (end) {
+        // Drop any torn tail left by a crash, then append after the last good record
+        _chsize_s(_fileno(file), end);
+        _fseeki64(file, end, SEEK_SET);
+    } else {
+        std::fwrite(CaptureMagic, 1, 4, file);
+        std::fwrite(&CaptureVersion, 4, 1, file);
+    }
+    start = std::chrono::steady_clock::now();
+    return true;
+}
+
+void CaptureRecorder::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+bool CaptureRecorder::record(const unsigned char* image, int width, int height,
+                             const unsigned char* tpl, unsigned int templateSize) {
+    if (!file) {
+        lastError = "Capture file not open.";
+        return false;
+    }
+    uint64_t ts = timestampBase + (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - start).count();
+    uint32_t w = (uint32_t)width, h = (uint32_t)height;
+    uint32_t imageSize = w * h;
+    unsigned char header[RecordHeaderSize];
+    std::memcpy(header, &ts, 8);
+    std::memcpy(header + 8, &w, 4);
+    std::memcpy(header + 12, &h, 4);
+    std::memcpy(header + 16, &imageSize, 4);
+    std::memcpy(header + 20, &templateSize, 4);
+
+    static const unsigned char zeros[8] = {};
+    size_t payload = (size_t)imageSize + templateSize;
+    bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+              std::fwrite(image, 1, imageSize, file) == imageSize &&
+              std::fwrite(tpl, 1, templateSize, file) == templateSize &&
+              std::fwrite(zeros, 1, paddedSize(payload) - payload, file) == paddedSize(payload) - payload;
+    // One flush per frame: the sensor delivers a handful of frames per second
+    if (!ok || std::fflush(file) != 0) {
+        lastError = "Failed to write capture frame.";
+        return false;
+    }
+    frames++;
+    return true;
+}
+
+// ===== Reader =====
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const std::string& path) {
+    close();
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        lastError = "Cannot open capture file: " + path;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < (long long)HeaderSize) {
+        lastError = "Capture file is empty or truncated: " + path;
+        close();
+        return false;
+    }
+    mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    view = mapping ? static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (!view) {
+        lastError = "Cannot map capture file: " + path;
+        close();
+        return false;
+    }
+    if (std::memcmp(view, CaptureMagic, 4) != 0 || readU32(view + 4) != CaptureVersion) {
+        lastError = "Not a capture file (or unsupported version): " + path;
+        close();
+        return false;
+    }
+
+    size_t total = (size_t)fileSize.QuadPart;
+    size_t pos = HeaderSize;
+    while (pos + RecordHeaderSize <= total) {
+        const unsigned char* rec = view + pos;
+        CaptureFrame f;
+        f.timestampUs = readU64(rec);
+        f.width = (int)readU32(rec + 8);
+        f.height = (int)readU32(rec + 12);
+        f.imageSize = readU32(rec + 16);
+        f.templateSize = readU32(rec + 20);
+        size_t payload = (size_t)f.imageSize + f.templateSize;
+        if (f.templateSize > MAX_TEMPLATE_SIZE || (uint64_t)f.width * (uint64_t)f.height != f.imageSize ||
+            pos + RecordHeaderSize + payload > total)
+            break; // torn or corrupt tail
+        f.image = rec + RecordHeaderSize;
+        f.fpTemplate = f.image + f.imageSize;
+        frames.push_back(f);
+        pos += RecordHeaderSize + paddedSize(payload);
+    }
+    validEnd = pos;
+    return true;
+}
+
+void CaptureReader::close() {
+    frames.clear();
+    validEnd = 0;
+    if (view) {
+        UnmapViewOfFile(view);
+        view = nullptr;
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+}
+
+// ===== Replay =====
+
+bool CaptureReplay::open(const std::string& path, ReplayPacing pacingMode, bool loopFrames) {
+    pacing = pacingMode;
+    loop = loopFrames;
+    if (!reader.open(path)) return false;
+    rewind();
+    return true;
+}
+
+void CaptureReplay::rewind() {
+    cursor = 0;
+    start = Clock::now();
+}
+
+bool CaptureReplay::next(const CaptureFrame*& frame) {
+    if (reader.size() == 0) return false;
+    if (cursor >= reader.size()) {
+        if (!loop) return false;
+        rewind();
+    }
+    const CaptureFrame& f = reader.frame(cursor);
+    if (pacing == ReplayPacing::Original) {
+        uint64_t offset = f.timestampUs - reader.frame(0).timestampUs;
+        if (Clock::now() - start < std::chrono::microseconds(offset)) return false;
+    }
+    frame = &f;
+    cursor++;
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Raw sensor capture file, append-only and laid out so it can be mapped and
+// walked in place:
+//   header  "ZKCF" + u32 version
+//   records [u64 timestampUs][u32 width][u32 height][u32 imageSize][u32 templateSize]
+//           [image bytes][template bytes], padded to 8 bytes
+// A record cut short by a crash is ignored by the reader, so recording can
+// simply be resumed by appending.
+struct CaptureFrame {
+    uint64_t timestampUs;   // since the recording started
+    int width;
+    int height;
+    const unsigned char* image;
+    unsigned int imageSize;
+    const unsigned char* fpTemplate;
+    unsigned int templateSize;
+};
+
+class CaptureRecorder {
+public:
+    CaptureRecorder() = default;
+    ~CaptureRecorder();
+
+    // Creates the file, or appends to an existing capture file; any other
+    // non-empty file is left alone and open() fails
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    bool record(const unsigned char* image, int width, int height,
+                const unsigned char* tpl, unsigned int templateSize);
+
+    size_t getFrameCount() const { return frames; }
+    std::string getLastError() const { return lastError; }
+
+private:
+    FILE* file = nullptr;
+    std::chrono::steady_clock::time_point start;
+    uint64_t timestampBase = 0; // last timestamp already in the file when appending
+    size_t frames = 0;
+    std::string lastError;
+};
+
+class CaptureReader {
+public:
+    CaptureReader() = default;
+    ~CaptureReader();
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    size_t size() const { return frames.size(); }
+    const CaptureFrame& frame(size_t index) const { return frames[index]; }
+    // End of the last complete record (anything after it is a torn write)
+    size_t validBytes() const { return validEnd; }
+    std::string getLastError() const { return lastError; }
+
+private:
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    const unsigned char* view = nullptr;
+    std::vector<CaptureFrame> frames; // points into the mapped view
+    size_t validEnd = 0;
+    std::string lastError;
+};
+
+enum class ReplayPacing {
+    Original,       // frames become available at their recorded offsets
+    AsFastAsPossible
+};
+
+// Serves a capture file in place of the sensor (see FingerprintDevice::setReplay)
+class CaptureReplay {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    bool open(const std::string& path, ReplayPacing pacing = ReplayPacing::Original, bool loop = false);
+    void rewind();
+
+    // Next frame if one is due; false when waiting (Original pacing) or finished
+    bool next(const CaptureFrame*& frame);
+    bool finished() const { return !loop && cursor >= reader.size(); }
+
+    size_t size() const { return reader.size(); }
+    std::string getLastError() const { return reader.getLastError(); }
+
+private:
+    CaptureReader reader;
+    ReplayPacing pacing = ReplayPacing::Original;
+    bool loop = false;
+    size_t cursor = 0;
+    Clock::time_point start;
+};
@@ -0,0 +1,369 @@
+#include "CapturePipeline.h"
+#include "FrameQuality.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+namespace {
+
+double millisBetween(CapturePipeline::Clock::time_point a, CapturePipeline::Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+void putU16(unsigned char* p, uint16_t v) { std::memcpy(p, &v, 2); }
+void putU32(unsigned char* p, uint32_t v) { std::memcpy(p, &v, 4); }
+
+constexpr uint32_t BmpHeaderSize = 14 + 40 + 256 * 4;
+
+uint32_t bmpStride(int width) { return ((uint32_t)width + 3) & ~3u; }
+
+// 8-bit grayscale BMP (bottom-up rows padded to 4 bytes, 256-entry gray
+// palette). Only the header is written; the pixels follow at BmpHeaderSize.
+bool createGrayBmp(const std::string& path, int width, int height, FILE*& file) {
+    unsigned char header[BmpHeaderSize] = {};
+    header[0] = 'B';
+    header[1] = 'M';
+    putU32(header + 2, BmpHeaderSize + bmpStride(width) * (uint32_t)height);
+    putU32(header + 10, BmpHeaderSize);
+    putU32(header + 14, 40);
+    putU32(header + 18, (uint32_t)width);
+    putU32(header + 22, (uint32_t)height);
+    putU16(header + 26, 1);
+    putU16(header + 28, 8);
+    putU32(header + 34, bmpStride(width) * (uint32_t)height);
+    putU32(header + 46, 256);
+    for (int i = 0; i < 256; ++i) {
+        unsigned char* entry = header + 54 + i * 4;
+        entry[0] = entry[1] = entry[2] = (unsigned char)i;
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    if (std::fwrite(header, 1, BmpHeaderSize, file) == BmpHeaderSize && std::fflush(file) == 0) return true;
+    std::fclose(file);
+    file = nullptr;
+    return false;
+}
+
+// Overwrites the pixels of a file made by createGrayBmp with the same size
+bool writeGrayRows(FILE* file, const unsigned char* pixels, int width, int height, CaptureBuffer& rows) {
+    const uint32_t stride = bmpStride(width);
+    rows.resize((size_t)stride * height); // padding bytes stay zero: only the first width bytes of a row are copied
+    for (int y = 0; y < height; ++y)
+        std::memcpy(rows.data() + (size_t)(height - 1 - y) * stride, pixels + (size_t)y * width, (size_t)width);
+    return std::fseek(file, (long)BmpHeaderSize, SEEK_SET) == 0 &&
+           std::fwrite(rows.data(), 1, rows.size(), file) == rows.size() && std::fflush(file) == 0;
+}
+
+} // namespace
+
+void StageTiming::add(double ms) {
+    count++;
+    totalMs += ms;
+    maxMs = std::max(maxMs, ms);
+}
+
+std::string PipelineStats::summary() const {
+    char line[320];
+    std::snprintf(line, sizeof(line),
+                  "%llu acquired, %llu extracted (%.1f/s), %llu failed, %llu dropped; "
+                  "acquire %.1f ms, queued %.1f ms, extract %.1f ms, touch-to-template %.1f ms avg (%.1f max)",
+                  (unsigned long long)acquired, (unsigned long long)extracted, framesPerSecond(),
+                  (unsigned long long)extractFailed, (unsigned long long)dropped,
+                  acquire.meanMs(), queued.meanMs(), extract.meanMs(),
+                  touchToTemplate.meanMs(), touchToTemplate.maxMs);
+    std::string text = line;
+    if (duplicates || lowQuality || notSelected) {
+        std::snprintf(line, sizeof(line), "; best-of-N skipped %llu repeats, %llu low quality, %llu not selected",
+                      (unsigned long long)duplicates, (unsigned long long)lowQuality, (unsigned long long)notSelected);
+        text += line;
+    }
+    return text;
+}
+
+CapturePipeline::CapturePipeline(FingerprintDevice& device, WorkerPool& pool) : device(device), pool(pool) {}
+
+CapturePipeline::~CapturePipeline() {
+    stop();
+}
+
+bool CapturePipeline::start(size_t bufferCount, std::chrono::milliseconds interval) {
+    stop();
+    if (!device.getHandle()) {
+        lastError = "Device not opened.";
+        return false;
+    }
+    if (!device.getCaptureParams(width, height, dpi) || width <= 0 || height <= 0) {
+        lastError = device.getLastError();
+        return false;
+    }
+    pollInterval = interval;
+
+    std::error_code error;
+    std::filesystem::path tempDir = std::filesystem::temp_directory_path(error);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        extractors.push_back(std::make_unique<Extractor>());
+        Extractor& x = *extractors.back();
+        x.handle = ZKFPM_DBInit();
+        if (!x.handle) {
+            lastError = "Failed to create DB cache for extraction worker " + std::to_string(i) + ".";
+            stop(); // frees what was created so far
+            return false;
+        }
+        std::string name = "zkfp-pipeline-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(i) + ".bmp";
+        x.path = (tempDir / name).string();
+        if (!createGrayBmp(x.path, width, height, x.file)) {
+            lastError = "Failed to create scratch image " + x.path + ".";
+            stop();
+            return false;
+        }
+        x.tpl.resize(MAX_TEMPLATE_SIZE);
+    }
+
+    slots.clear();
+    freeSlots.clear();
+    finished.clear();
+    for (size_t i = 0; i < std::max<size_t>(2, bufferCount); ++i) {
+        slots.push_back(std::make_unique<Slot>());
+        slots.back()->frame.image.resize((size_t)width * height);
+        freeSlots.push_back(slots.back().get());
+    }
+    nextSequence = nextToDeliver = 0;
+    extracting = 0;
+    stopping = false;
+    counters = PipelineStats();
+    lastError.clear();
+    startedAt = Clock::now();
+    running = true;
+    acquirer = std::thread([this] { acquireLoop(); });
+    return true;
+}
+
+void CapturePipeline::stop() {
+    if (running) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        acquirer.join();
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return extracting == 0; });
+        counters.seconds = std::chrono::duration<double>(Clock::now() - startedAt).count();
+        running = false;
+    }
+    std::error_code error;
+    for (const auto& x : extractors) {
+        if (x->handle) ZKFPM_DBFree(x->handle);
+        if (x->file) {
+            std::fclose(x->file);
+            std::filesystem::remove(x->path, error);
+        }
+    }
+    extractors.clear();
+}
+
+// ===== Stage 1: image-only acquisition (one thread, the only one touching the sensor) =====
+
+CapturePipeline::Slot* CapturePipeline::takeSlot(std::unique_lock<std::mutex>& lock) {
+    for (;;) {
+        if (stopping) return nullptr;
+        if (!freeSlots.empty()) {
+            Slot* slot = freeSlots.back();
+            freeSlots.pop_back();
+            return slot;
+        }
+        // Nobody is polling: recycle the oldest finished frame rather than stall the sensor
+        auto oldest = finished.begin();
+        if (oldest != finished.end() && oldest->first == nextToDeliver) {
+            Slot* slot = oldest->second;
+            finished.erase(oldest);
+            nextToDeliver++;
+            counters.dropped++;
+            return slot;
+        }
+        changed.wait(lock); // every buffer is being extracted
+    }
+}
+
+void CapturePipeline::acquireLoop() {
+    HANDLE handle = device.getHandle();
+    const unsigned int imageSize = (unsigned int)((size_t)width * height);
+    previousImage.clear();
+    Slot* best = nullptr;           // best-of-N candidate of the current touch
+    Clock::time_point windowStart;
+    bool touchSelected = false;     // a frame of this touch already went to extraction
+    for (;;) {
+        Slot* slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slot = takeSlot(lock);
+        }
+        if (!slot) break;
+        slot->frame.image.resize(imageSize);
+
+        Clock::time_point touchedAt;
+        bool stopped = false;
+        for (;;) {
+            touchedAt = Clock::now();
+            if (ZKFPM_AcquireFingerprintImage(handle, slot->frame.image.data(), imageSize) == ZKFP_ERR_OK) break;
+            // Finger lifted: the touch is over, extract its best frame now
+            touchSelected = false;
+            previousImage.clear();
+            if (best) {
+                submit(best);
+                best = nullptr;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            if (changed.wait_for(lock, pollInterval, [&] { return stopping; })) {
+                stopped = true;
+                break;
+            }
+        }
+        if (stopped) {
+            release(slot);
+            break;
+        }
+
+        slot->touchedAt = touchedAt;
+        slot->acquiredAt = Clock::now();
+        slot->frame.width = width;
+        slot->frame.height = height;
+        slot->frame.quality = -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            counters.acquired++;
+            counters.acquire.add(millisBetween(touchedAt, slot->acquiredAt));
+        }
+        if (selection.enabled) slot = select(slot, best, windowStart, touchSelected);
+        if (slot) submit(slot);
+    }
+    if (best) release(best);
+}
+
+CapturePipeline::Slot* CapturePipeline::select(Slot* slot, Slot*& best, Clock::time_point& windowStart, bool& touchSelected) {
+    const CaptureBuffer& image = slot->frame.image;
+    bool repeat = previousImage.size() == image.size() &&
+                  FrameQuality::meanAbsDiff(previousImage.data(), image.data(), image.size()) < selection.duplicateDiff;
+    previousImage.assign(image.begin(), image.end());
+    if (!repeat && !touchSelected) slot->frame.quality = FrameQuality::score(image.data(), slot->frame.width, slot->frame.height);
+
+    Slot* discard = slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (repeat) counters.duplicates++;
+        else if (touchSelected) counters.notSelected++;
+        else if (slot->frame.quality < selection.minQuality) counters.lowQuality++;
+        else if (!best) {
+            best = slot;
+            windowStart = slot->touchedAt;
+            discard = nullptr;
+        } else {
+            if (slot->frame.quality > best->frame.quality) std::swap(discard, best);
+            best->touchedAt = windowStart; // touch-to-template counts from the first usable frame
+            counters.notSelected++;
+        }
+        if (discard) freeSlots.push_back(discard);
+    }
+
+    // Repeats still count towards the window, so a finger held still is not waited on forever
+    if (!best || (best->frame.quality < selection.acceptQuality && Clock::now() - windowStart < selection.window))
+        return nullptr;
+    Slot* chosen = best;
+    best = nullptr;
+    touchSelected = true;
+    return chosen;
+}
+
+void CapturePipeline::submit(Slot* slot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slot->frame.sequence = nextSequence++;
+        slot->acquiredAt = Clock::now(); // a best-of-N pick may have waited out its window
+        extracting++;
+    }
+    pool.post([this, slot] { extract(slot); }, TaskPriority::High);
+}
+
+void CapturePipeline::release(Slot* slot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(slot);
+    }
+    changed.notify_all();
+}
+
+// ===== Stage 2: extraction on the shared pool =====
+
+void CapturePipeline::extract(Slot* slot) {
+    Clock::time_point begin = Clock::now();
+    Extractor& x = *extractors[pool.currentWorker()];
+    PipelineFrame& frame = slot->frame;
+    unsigned int size = (unsigned int)x.tpl.size();
+    frame.fpTemplate.clear();
+    if (!writeGrayRows(x.file, frame.image.data(), frame.width, frame.height, x.rows)) {
+        frame.sdkCode = ZKFP_ERR_FAIL;
+    } else {
+        frame.sdkCode = ZKFPM_ExtractFromImage(x.handle, x.path.c_str(), dpi, x.tpl.data(), &size);
+        if (frame.sdkCode == ZKFP_ERR_OK && size > 0) frame.fpTemplate.assign(x.tpl.begin(), x.tpl.begin() + size);
+        else if (frame.sdkCode == ZKFP_ERR_OK) frame.sdkCode = ZKFP_ERR_FAIL;
+    }
+    Clock::time_point end = Clock::now();
+    frame.touchToTemplateMs = millisBetween(slot->touchedAt, end);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.queued.add(millisBetween(slot->acquiredAt, begin));
+    if (frame.ok()) {
+        counters.extracted++;
+        counters.extract.add(millisBetween(begin, end));
+        counters.touchToTemplate.add(frame.touchToTemplateMs);
+    } else {
+        counters.extractFailed++;
+    }
+    finished.emplace(frame.sequence, slot);
+    extracting--;
+    changed.notify_all(); // under the lock: stop() may be waiting to tear down
+}
+
+// ===== Consumer =====
+
+bool CapturePipeline::poll(PipelineFrame& out) {
+    Slot* slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = finished.find(nextToDeliver);
+        if (it == finished.end()) return false;
+        slot = it->second;
+        finished.erase(it);
+        nextToDeliver++;
+    }
+    // Swap buffers so the slot keeps an allocation and the caller gets the pixels without a copy
+    out.sequence = slot->frame.sequence;
+    out.width = slot->frame.width;
+    out.height = slot->frame.height;
+    out.sdkCode = slot->frame.sdkCode;
+    out.quality = slot->frame.quality;
+    out.touchToTemplateMs = slot->frame.touchToTemplateMs;
+    out.image.swap(slot->frame.image);
+    out.fpTemplate.swap(slot->frame.fpTemplate);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(slot);
+    }
+    changed.notify_all();
+    return true;
+}
+
+PipelineStats CapturePipeline::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    PipelineStats s = counters;
+    if (running) s.seconds = std::chrono::duration<double>(Clock::now() - startedAt).count();
+    return s;
+}
+
+std::string CapturePipeline::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastError;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "WorkerPool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StageTiming {
+    uint64_t count = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+
+    void add(double ms);
+    double meanMs() const { return count ? totalMs / count : 0.0; }
+};
+
+struct PipelineStats {
+    uint64_t acquired = 0;      // images read from the sensor
+    uint64_t extracted = 0;
+    uint64_t extractFailed = 0; // image read but no template (poor quality, partial touch)
+    uint64_t dropped = 0;       // finished frames replaced before anyone polled them
+    uint64_t duplicates = 0;    // best-of-N: same image as the previous frame
+    uint64_t lowQuality = 0;    // best-of-N: below minQuality
+    uint64_t notSelected = 0;   // best-of-N: a better frame of the same touch was extracted
+    StageTiming acquire;        // ZKFPM_AcquireFingerprintImage calls that returned an image
+    StageTiming queued;         // image ready -> extraction started
+    StageTiming extract;        // image handed to the SDK -> template
+    StageTiming touchToTemplate;
+    double seconds = 0.0;
+
+    double framesPerSecond() const { return seconds > 0.0 ? extracted / seconds : 0.0; }
+    std::string summary() const;
+};
+
+struct PipelineFrame {
+    uint64_t sequence = 0;
+    CaptureBuffer image;
+    int width = 0;
+    int height = 0;
+    TemplateBuffer fpTemplate; // empty if extraction failed
+    int sdkCode = ZKFP_ERR_OK;
+    int quality = -1; // FrameQuality::score, when best-of-N selection is on
+    double touchToTemplateMs = 0.0;
+
+    bool ok() const { return !fpTemplate.empty(); }
+};
+
+// Best-of-N: instead of extracting every frame, the acquisition thread
+// streams the frames of one touch, skips repeats of the previous image,
+// scores the rest and extracts only the best one. A touch ends when the
+// finger is lifted (the sensor stops returning images).
+struct SelectionOptions {
+    bool enabled = false;
+    std::chrono::milliseconds window{ 300 }; // from the first usable frame of a touch
+    double duplicateDiff = 1.5;              // mean abs pixel difference that still counts as a repeat
+    int minQuality = 20;                     // never extracted below this
+    int acceptQuality = 85;                  // extracted at once, without waiting out the window
+};
+
+// Two-stage live capture. ZKFPM_AcquireFingerprint reads the image and
+// extracts the template in one blocking call; here a dedicated thread only
+// reads images (ZKFPM_AcquireFingerprintImage) into a small set of pooled
+// buffers while the shared pool extracts earlier frames, so frame N+1 is on
+// the sensor while frame N is being extracted.
+//
+// The SDK only extracts from an image file, so each worker has its own
+// scratch 8-bit BMP, created with its header by start() and kept open; a
+// frame only rewrites the pixel rows before ZKFPM_ExtractFromImage runs on
+// the worker's own DB handle.
+class CapturePipeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CapturePipeline(FingerprintDevice& device, WorkerPool& pool = WorkerPool::shared());
+    ~CapturePipeline();
+    CapturePipeline(const CapturePipeline&) = delete;
+    CapturePipeline& operator=(const CapturePipeline&) = delete;
+
+    // The device must be open; nothing else may use the sensor until stop()
+    bool start(size_t bufferCount = 4, std::chrono::milliseconds pollInterval = std::chrono::milliseconds(10));
+    // Takes effect on the next start()
+    void setSelection(const SelectionOptions& options) { selection = options; }
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Next finished frame in capture order, failed extractions included.
+    // Never blocks; false if nothing is ready yet.
+    bool poll(PipelineFrame& frame);
+
+    PipelineStats stats() const;
+    std::string getLastError() const;
+
+private:
+    // One per pool worker, touched only by that worker while running
+    struct Extractor {
+        HANDLE handle = nullptr;
+        std::string path;
+        FILE* file = nullptr;
+        CaptureBuffer rows;  // the frame bottom-up with padded rows, as the file stores it
+        TemplateBuffer tpl;  // MAX_TEMPLATE_SIZE, the SDK's output buffer
+    };
+
+    struct Slot {
+        PipelineFrame frame;
+        Clock::time_point touchedAt;  // acquire call that returned this image started
+        Clock::time_point acquiredAt;
+    };
+
+    void acquireLoop();
+    // Best-of-N step for a fresh image; returns the frame to extract, if any
+    Slot* select(Slot* slot, Slot*& best, Clock::time_point& windowStart, bool& touchSelected);
+    void submit(Slot* slot);
+    void release(Slot* slot);
+    void extract(Slot* slot);
+    Slot* takeSlot(std::unique_lock<std::mutex>& lock);
+
+    FingerprintDevice& device;
+    WorkerPool& pool;
+    bool running = false;
+    int width = 0;
+    int height = 0;
+    int dpi = 500;
+    std::chrono::milliseconds pollInterval{ 10 };
+    SelectionOptions selection;
+    std::vector<unsigned char> previousImage; // acquisition thread only
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<std::unique_ptr<Extractor>> extractors; // indexed by pool worker
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Slot*> freeSlots;
+    std::map<uint64_t, Slot*> finished; // by sequence, waiting for poll()
+    uint64_t nextSequence = 0;
+    uint64_t nextToDeliver = 0;
+    size_t extracting = 0;
+    bool stopping = false;
+    std::thread acquirer;
+
+    Clock::time_point startedAt;
+    PipelineStats counters;
+    std::string lastError;
+};
@@ -0,0 +1,189 @@
+#include "CascadeIdentifier.h"
+#include "MemoryAccounting.h"
+#include <algorithm>
+#include <string>
+
+CascadeIdentifier::CascadeIdentifier(WorkerPool& pool) : topk(pool) {}
+
+CascadeIdentifier::~CascadeIdentifier() {
+    release();
+}
+
+bool CascadeIdentifier::initialize() {
+    release();
+    if (!topk.initialize()) {
+        lastError = topk.getLastError();
+        return false;
+    }
+    cache = ZKFPM_DBInit();
+    if (!cache) {
+        lastError = "Failed to create DB cache for the cascade.";
+        release();
+        return false;
+    }
+    ZKFPM_DBSetParameter(cache, FP_MTHRESHOLD_CODE, options.shortlistScore);
+    return true;
+}
+
+void CascadeIdentifier::release() {
+    topk.release();
+    clearCache();
+    if (cache) ZKFPM_DBFree(cache);
+    cache = nullptr;
+}
+
+void CascadeIdentifier::clearCache() {
+    if (!cached) return;
+    ZKFPM_DBClear(cache);
+    MemoryAccounting::sdkTemplatesRemoved(cached);
+    cached = 0;
+}
+
+void CascadeIdentifier::setOptions(const CascadeOptions& value) {
+    options = value;
+    if (cache) ZKFPM_DBSetParameter(cache, FP_MTHRESHOLD_CODE, options.shortlistScore);
+}
+
+void CascadeIdentifier::setGallery(const std::vector<GalleryEntry>& entries, const IdentityIndex& identities) {
+    gallery = entries;
+    identityOf.clear();
+    templatesOf.clear();
+    if (cache) clearCache();
+    for (size_t i = 0; i < gallery.size(); ++i) {
+        Identity id;
+        if (!identities.find(gallery[i].fid, id)) continue;
+        identityOf[gallery[i].fid] = id;
+        templatesOf[id.personId].push_back(i);
+        // Only templates with a person go in, so every DBIdentify hit resolves
+        if (cache && ZKFPM_DBAdd(cache, gallery[i].fid, const_cast<unsigned char*>(gallery[i].data), gallery[i].size) == ZKFP_ERR_OK)
+            cached++;
+    }
+    MemoryAccounting::sdkTemplatesAdded(cached);
+}
+
+void CascadeIdentifier::hidePerson(uint32_t personId, std::vector<size_t>& hidden) {
+    for (size_t i : templatesOf.at(personId))
+        if (ZKFPM_DBDel(cache, gallery[i].fid) == ZKFP_ERR_OK) hidden.push_back(i); // else never made it into the cache
+}
+
+bool CascadeIdentifier::unhide(std::vector<size_t>& hidden) {
+    size_t lost = 0;
+    for (size_t i : hidden)
+        if (ZKFPM_DBAdd(cache, gallery[i].fid, const_cast<unsigned char*>(gallery[i].data), gallery[i].size) != ZKFP_ERR_OK)
+            lost++;
+    hidden.clear();
+    if (!lost) return true;
+    cached -= lost;
+    MemoryAccounting::sdkTemplatesRemoved(lost);
+    lastError = "Failed to put " + std::to_string(lost) + " template(s) back into the cascade's DB cache.";
+    return false;
+}
+
+bool CascadeIdentifier::firstStageIdentify(const unsigned char* tpl, unsigned int size, std::vector<Shortlisted>& shortlist) {
+    // DBIdentify only reports the best template, so each person found is
+    // taken out of the cache for the next call to reach the runner-up
+    std::vector<size_t> hidden;
+    size_t rounds = std::min(options.identifyRounds, options.shortlist);
+    while (shortlist.size() < rounds) {
+        unsigned int fid = 0, score = 0;
+        // Anything but a hit (no template over the lowered threshold) ends the list
+        if (ZKFPM_DBIdentify(cache, const_cast<unsigned char*>(tpl), size, &fid, &score) != ZKFP_ERR_OK) break;
+        auto id = identityOf.find(fid);
+        if (id == identityOf.end() || (int)score < options.shortlistScore) break;
+        shortlist.push_back({ id->second.personId, fid, (int)score, id->second.finger });
+        // A clear winner needs no third person to prove it
+        if (shortlist.size() == 2 && shortlist[0].score >= options.conclusiveScore &&
+            shortlist[0].score - shortlist[1].score >= options.conclusiveMargin)
+            break;
+        if (shortlist.size() < rounds) hidePerson(id->second.personId, hidden);
+    }
+    return unhide(hidden);
+}
+
+bool CascadeIdentifier::firstStageTopK(const unsigned char* tpl, unsigned int size, std::vector<Shortlisted>& shortlist) {
+    // Extra room in K because one person's other fingers can also score
+    TopKOptions first;
+    first.k = options.shortlist * 4;
+    std::vector<Candidate> hits;
+    if (!topk.identify(gallery, tpl, size, first, hits)) {
+        lastError = topk.getLastError();
+        return false;
+    }
+    for (const Candidate& c : hits) {
+        if (c.score < options.shortlistScore || shortlist.size() >= options.shortlist) break;
+        auto id = identityOf.find(c.fid);
+        if (id == identityOf.end()) continue;
+        bool listed = std::any_of(shortlist.begin(), shortlist.end(),
+                                  [&](const Shortlisted& s) { return s.personId == id->second.personId; });
+        if (!listed) shortlist.push_back({ id->second.personId, c.fid, c.score, id->second.finger });
+    }
+    return true;
+}
+
+bool CascadeIdentifier::identify(const unsigned char* tpl, unsigned int size, const SecondCapture& captureSecond,
+                                 CascadeResult& result) {
+    result = CascadeResult();
+    if (!cache) {
+        lastError = "Cascade identifier not initialized.";
+        return false;
+    }
+
+    // ===== First finger: 1:N, low bar =====
+    std::vector<Shortlisted> shortlist;
+    bool ok = options.firstStage == CascadeFirstStage::TopK ? firstStageTopK(tpl, size, shortlist)
+                                                             : firstStageIdentify(tpl, size, shortlist);
+    if (!ok) return false;
+    result.candidates = shortlist.size();
+    if (shortlist.empty()) return true;
+
+    const Shortlisted& best = shortlist[0];
+    result.personId = best.personId;
+    result.firstFid = best.fid;
+    result.firstScore = best.score;
+    result.fusedScore = best.score;
+    int runnerUp = shortlist.size() > 1 ? shortlist[1].score : 0;
+    if (best.score >= options.conclusiveScore && best.score - runnerUp >= options.conclusiveMargin) {
+        result.identified = true;
+        return true;
+    }
+
+    // ===== Second finger: 1:1 against the shortlist's other fingers only =====
+    std::vector<unsigned char> second;
+    if (!captureSecond || !captureSecond(second) || second.empty()) return true;
+    result.secondCaptured = true;
+
+    int bestFused = -1, runnerUpFused = 0;
+    for (const Shortlisted& s : shortlist) {
+        int secondScore = 0;
+        unsigned int secondFid = 0;
+        for (size_t i : templatesOf.at(s.personId)) {
+            const GalleryEntry& e = gallery[i];
+            // Another impression of the first finger would count one finger twice
+            uint8_t finger = identityOf.at(e.fid).finger;
+            if (finger == 0xFF || s.finger == 0xFF || finger == s.finger) continue;
+            int score = ZKFPM_DBMatch(cache, second.data(), (unsigned int)second.size(),
+                                      const_cast<unsigned char*>(e.data), e.size);
+            result.secondMatches++;
+            if (score > secondScore) {
+                secondScore = score;
+                secondFid = e.fid;
+            }
+        }
+        int fused = s.score + secondScore;
+        if (fused > bestFused) {
+            runnerUpFused = std::max(bestFused, 0);
+            bestFused = fused;
+            result.personId = s.personId;
+            result.firstFid = s.fid;
+            result.firstScore = s.score;
+            result.secondFid = secondFid;
+            result.secondScore = secondScore;
+        } else {
+            runnerUpFused = std::max(runnerUpFused, fused);
+        }
+    }
+    result.fusedScore = bestFused;
+    result.identified = result.secondFid != 0 && bestFused >= options.fusedThreshold &&
+                        bestFused - runnerUpFused >= options.fusedMargin;
+    return true;
+}
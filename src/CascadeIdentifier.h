@@ -0,0 +1,98 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "IdentityIndex.h"
+#include "TopKIdentifier.h"
+#include "WorkerPool.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// How the first finger finds its candidates
+enum class CascadeFirstStage {
+    Identify, // repeated ZKFPM_DBIdentify, each found person hidden from the next: a short list of persons
+    TopK      // TopKIdentifier scan of every template: a shortlist of persons, at DBMatch cost
+};
+
+struct CascadeOptions {
+    CascadeFirstStage firstStage = CascadeFirstStage::Identify;
+    size_t shortlist = 10;      // persons kept from the first finger
+    size_t identifyRounds = 3;  // DBIdentify calls the Identify stage makes at most, one person each
+    int shortlistScore = 30;    // first-finger score to make the list, well under the 1:1 threshold
+    int conclusiveScore = 90;   // the first finger decides alone at or above this...
+    int conclusiveMargin = 20;  // ...when the runner-up person scores at least this much lower
+    int fusedThreshold = 110;   // minimum sum of both fingers' scores
+    int fusedMargin = 20;       // over the runner-up's fused score
+};
+
+struct CascadeResult {
+    bool identified = false;
+    uint32_t personId = 0;
+    unsigned int firstFid = 0;  // the template each finger matched
+    unsigned int secondFid = 0; // 0 when the second finger was not needed
+    int firstScore = 0;
+    int secondScore = 0;
+    int fusedScore = 0;
+    bool secondCaptured = false;
+    size_t candidates = 0;      // persons on the shortlist
+    size_t secondMatches = 0;   // 1:1 comparisons for the second finger
+};
+
+// Two-finger identification at roughly the cost of one. The first finger goes
+// through a low-bar 1:N search against the cascade's own DB cache (1:N
+// threshold lowered to shortlistScore). By default that is ZKFPM_DBIdentify
+// repeated: each hit's person has their templates taken out of the cache so
+// the next call finds the runner-up, up to identifyRounds persons, and they
+// are put back afterwards. With CascadeFirstStage::TopK every template is
+// scored and the hits are collapsed into a shortlist of persons. If the best
+// person is clear of the runner-up, that is the answer and the second finger
+// is never captured. Otherwise the second finger is matched 1:1
+// (ZKFPM_DBMatch) against the shortlisted persons' templates of a different
+// finger only, and the two scores are summed.
+//
+// Persons and fingers come from the identity index; templates without an
+// identity are left out of the shortlist, and templates whose finger is
+// unknown never count as the second finger. setGallery() must be called again
+// after the gallery changes, as GalleryEntry pointers are held.
+class CascadeIdentifier {
+public:
+    // Fills the template with the second finger; false aborts (no capture)
+    using SecondCapture = std::function<bool(std::vector<unsigned char>& tpl)>;
+
+    explicit CascadeIdentifier(WorkerPool& pool = WorkerPool::shared());
+    ~CascadeIdentifier();
+
+    bool initialize();
+    void release();
+    std::string getLastError() const { return lastError; }
+
+    void setOptions(const CascadeOptions& value);
+    const CascadeOptions& getOptions() const { return options; }
+    void setGallery(const std::vector<GalleryEntry>& gallery, const IdentityIndex& identities);
+
+    // Returns false on errors; a probe nobody matches is a successful call with identified == false
+    bool identify(const unsigned char* tpl, unsigned int size, const SecondCapture& captureSecond, CascadeResult& result);
+
+private:
+    struct Shortlisted {
+        uint32_t personId;
+        unsigned int fid;
+        int score;
+        uint8_t finger;
+    };
+
+    bool firstStageIdentify(const unsigned char* tpl, unsigned int size, std::vector<Shortlisted>& shortlist);
+    bool firstStageTopK(const unsigned char* tpl, unsigned int size, std::vector<Shortlisted>& shortlist);
+    void hidePerson(uint32_t personId, std::vector<size_t>& hidden);
+    bool unhide(std::vector<size_t>& hidden);
+    void clearCache();
+
+    TopKIdentifier topk;
+    HANDLE cache = nullptr; // the gallery, for the first-finger DBIdentify; also does the 1:1 matches
+    size_t cached = 0;
+    CascadeOptions options;
+    std::vector<GalleryEntry> gallery;
+    std::unordered_map<unsigned int, Identity> identityOf;
+    std::unordered_map<uint32_t, std::vector<size_t>> templatesOf; // person -> indices into gallery
+    std::string lastError;
+};
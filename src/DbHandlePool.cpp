@@ -0,0 +1,301 @@
+#include "DbHandlePool.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+// Last handle each thread checked out, per pool
+struct Affinity {
+    const DbHandlePool* owner = nullptr;
+    int slot = -1;
+};
+thread_local Affinity threadAffinity;
+
+} // namespace
+
+std::string HandlePoolStats::summary() const {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%zu handles, %llu checkouts (%llu affinity, %llu free list, %llu waited %.3f s, max %.2f ms), "
+                  "gallery version %llu, %llu ops synced, %llu sync errors, %llu rebuilds",
+                  handles, (unsigned long long)checkouts, (unsigned long long)affinityHits,
+                  (unsigned long long)freeListHits, (unsigned long long)waits, waitSeconds, maxWaitMs,
+                  (unsigned long long)version, (unsigned long long)syncedOps, (unsigned long long)syncErrors,
+                  (unsigned long long)rebuilds);
+    return line;
+}
+
+// ===== Lease =====
+
+DbHandlePool::Lease::Lease(Lease&& other) noexcept
+    : owner(other.owner), slot(other.slot), handle(other.handle) {
+    other.owner = nullptr;
+    other.handle = nullptr;
+}
+
+DbHandlePool::Lease& DbHandlePool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        reset();
+        owner = other.owner;
+        slot = other.slot;
+        handle = other.handle;
+        other.owner = nullptr;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+DbHandlePool::Lease::~Lease() {
+    reset();
+}
+
+void DbHandlePool::Lease::reset() {
+    if (owner) owner->checkin(slot);
+    owner = nullptr;
+    handle = nullptr;
+}
+
+// ===== Pool =====
+
+DbHandlePool::DbHandlePool(WorkerPool& pool) : pool(pool) {}
+
+DbHandlePool::~DbHandlePool() {
+    release();
+}
+
+bool DbHandlePool::initialize(size_t count, const std::vector<GalleryEntry>& gallery) {
+    release();
+    count = std::clamp<size_t>(count ? count : pool.size(), 1, MaxHandles);
+    for (size_t i = 0; i < count; ++i) {
+        HANDLE h = ZKFPM_DBInit();
+        if (!h) {
+            setError("Failed to create DB cache " + std::to_string(i) + " for the handle pool.");
+            release();
+            return false;
+        }
+        slots.push_back(std::make_unique<Slot>());
+        slots.back()->handle = h;
+    }
+
+    // Each handle is loaded by one task; the handles load in parallel
+    std::atomic<uint64_t> failed{ 0 };
+    pool.parallelFor(slots.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            for (const GalleryEntry& e : gallery)
+                if (ZKFPM_DBAdd(slots[i]->handle, e.fid, const_cast<unsigned char*>(e.data), e.size) != ZKFP_ERR_OK)
+                    failed++;
+    }, TaskPriority::Normal);
+    if (failed) {
+        setError(std::to_string(failed.load()) + " templates could not be loaded into the handle pool.");
+        release();
+        return false;
+    }
+
+    for (auto& slot : slots) slot->templates = gallery.size();
+    MemoryAccounting::sdkTemplatesAdded(gallery.size() * slots.size());
+    version = 0;
+    logBase = 0;
+    log.clear();
+    for (const GalleryEntry& e : gallery) image[e.fid].assign(e.data, e.data + e.size);
+    freeMask = count == 64 ? ~0ull : (1ull << count) - 1;
+    return true;
+}
+
+void DbHandlePool::release() {
+    for (auto& slot : slots) {
+        MemoryAccounting::sdkTemplatesRemoved(slot->templates);
+        ZKFPM_DBFree(slot->handle);
+    }
+    slots.clear();
+    freeMask = 0;
+    std::lock_guard<std::mutex> lock(logMutex);
+    log.clear();
+    image.clear();
+}
+
+DbHandlePool::Lease DbHandlePool::checkout() {
+    if (slots.empty()) return Lease();
+    checkouts++;
+    int slot = -1;
+
+    Affinity& affinity = threadAffinity;
+    if (affinity.owner == this) {
+        uint64_t bit = 1ull << affinity.slot;
+        if (freeMask.fetch_and(~bit, std::memory_order_acquire) & bit) {
+            slot = affinity.slot;
+            affinityHits++;
+        }
+    }
+
+    std::chrono::steady_clock::time_point waitStart;
+    bool waited = false;
+    while (slot < 0) {
+        uint64_t mask = freeMask.load(std::memory_order_acquire);
+        while (mask) {
+            int candidate = std::countr_zero(mask);
+            if (freeMask.compare_exchange_weak(mask, mask & ~(1ull << candidate), std::memory_order_acquire)) {
+                slot = candidate;
+                freeListHits++;
+                break;
+            }
+        }
+        if (slot >= 0) break;
+        if (!waited) {
+            waited = true;
+            waitStart = std::chrono::steady_clock::now();
+        }
+        freeMask.wait(0, std::memory_order_acquire); // every handle is out
+    }
+    if (waited) {
+        uint64_t nanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - waitStart).count();
+        waits++;
+        waitNanos += nanos;
+        uint64_t seen = maxWaitNanos.load();
+        while (nanos > seen && !maxWaitNanos.compare_exchange_weak(seen, nanos)) {}
+    }
+    affinity = { this, slot };
+
+    catchUp(slot);
+    return Lease(this, slot, slots[slot]->handle);
+}
+
+void DbHandlePool::checkin(int slot) {
+    freeMask.fetch_or(1ull << slot, std::memory_order_release);
+    freeMask.notify_one();
+}
+
+// ===== Gallery sync =====
+
+void DbHandlePool::catchUp(int index) {
+    Slot& slot = *slots[index];
+    if (slot.applied.load(std::memory_order_acquire) == version.load(std::memory_order_acquire)) return;
+
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (slot.applied.load() < logBase) {
+        rebuild(slot);
+        slot.applied.store(logBase + log.size(), std::memory_order_release);
+        return;
+    }
+    for (uint64_t v = slot.applied.load(); v < logBase + log.size(); ++v) {
+        Op& op = log[v - logBase];
+        int res = ZKFP_ERR_OK;
+        switch (op.type) {
+        case OpType::Add: res = ZKFPM_DBAdd(slot.handle, op.fid, op.tpl.data(), (unsigned int)op.tpl.size()); break;
+        case OpType::Remove: res = ZKFPM_DBDel(slot.handle, op.fid); break;
+        case OpType::Clear: res = ZKFPM_DBClear(slot.handle); break;
+        }
+        syncedOps++;
+        if (res != ZKFP_ERR_OK) {
+            syncErrors++;
+        } else if (op.type == OpType::Add) {
+            ++slot.templates;
+            MemoryAccounting::sdkTemplatesAdded(1);
+        } else if (op.type == OpType::Remove) {
+            --slot.templates;
+            MemoryAccounting::sdkTemplatesRemoved(1);
+        } else {
+            MemoryAccounting::sdkTemplatesRemoved(slot.templates);
+            slot.templates = 0;
+        }
+    }
+    slot.applied.store(logBase + log.size(), std::memory_order_release);
+}
+
+// Caller holds logMutex. The handle missed changes that are no longer in the
+// log, so it is reloaded from the image (which is at the end of the log).
+void DbHandlePool::rebuild(Slot& slot) {
+    ZKFPM_DBClear(slot.handle);
+    MemoryAccounting::sdkTemplatesRemoved(slot.templates);
+    slot.templates = 0;
+    for (auto& [fid, tpl] : image) {
+        if (ZKFPM_DBAdd(slot.handle, fid, tpl.data(), (unsigned int)tpl.size()) == ZKFP_ERR_OK) ++slot.templates;
+        else syncErrors++;
+    }
+    MemoryAccounting::sdkTemplatesAdded(slot.templates);
+    rebuilds++;
+}
+
+void DbHandlePool::record(Op op) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    switch (op.type) {
+    case OpType::Add: image[op.fid] = op.tpl; break;
+    case OpType::Remove: image.erase(op.fid); break;
+    case OpType::Clear: image.clear(); break;
+    }
+    log.push_back(std::move(op));
+    uint64_t end = logBase + log.size();
+    version.store(end, std::memory_order_release);
+
+    // Drop what every handle has already replayed, and past MaxLogOps also
+    // what an idle handle has not: it will be rebuilt from the image instead
+    uint64_t oldest = end;
+    for (const auto& slot : slots) oldest = std::min(oldest, slot->applied.load());
+    uint64_t keepFrom = std::max<uint64_t>(oldest, end > MaxLogOps ? end - MaxLogOps : 0);
+    if (keepFrom > logBase) {
+        log.erase(log.begin(), log.begin() + (ptrdiff_t)(keepFrom - logBase));
+        logBase = keepFrom;
+    }
+}
+
+void DbHandlePool::add(unsigned int fid, const unsigned char* tpl, unsigned int size) {
+    record({ OpType::Add, fid, TrackedVector<MemoryTag::Gallery, unsigned char>(tpl, tpl + size) });
+}
+
+void DbHandlePool::remove(unsigned int fid) {
+    record({ OpType::Remove, fid, {} });
+}
+
+void DbHandlePool::clear() {
+    record({ OpType::Clear, 0, {} });
+}
+
+// ===== Matching =====
+
+bool DbHandlePool::identify(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score) {
+    Lease lease = checkout();
+    if (!lease) {
+        setError("Handle pool not initialized.");
+        return false;
+    }
+    int res = ZKFPM_DBIdentify(lease.get(), const_cast<unsigned char*>(tpl), size, &fid, &score);
+    if (res != ZKFP_ERR_OK) {
+        setError("No match found. Error code: " + std::to_string(res));
+        return false;
+    }
+    return true;
+}
+
+int DbHandlePool::match(const unsigned char* a, unsigned int sizeA, const unsigned char* b, unsigned int sizeB) {
+    Lease lease = checkout();
+    if (!lease) return ZKFP_ERR_INVALID_HANDLE;
+    return ZKFPM_DBMatch(lease.get(), const_cast<unsigned char*>(a), sizeA, const_cast<unsigned char*>(b), sizeB);
+}
+
+HandlePoolStats DbHandlePool::stats() const {
+    HandlePoolStats s;
+    s.handles = slots.size();
+    s.checkouts = checkouts.load();
+    s.affinityHits = affinityHits.load();
+    s.freeListHits = freeListHits.load();
+    s.waits = waits.load();
+    s.waitSeconds = waitNanos.load() / 1e9;
+    s.maxWaitMs = maxWaitNanos.load() / 1e6;
+    s.version = version.load();
+    s.syncedOps = syncedOps.load();
+    s.syncErrors = syncErrors.load();
+    s.rebuilds = rebuilds.load();
+    return s;
+}
+
+void DbHandlePool::setError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    lastError = error;
+}
+
+std::string DbHandlePool::getLastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return lastError;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct HandlePoolStats {
+    size_t handles = 0;
+    uint64_t checkouts = 0;
+    uint64_t affinityHits = 0;  // got the handle this thread used last time
+    uint64_t freeListHits = 0;  // took another free handle
+    uint64_t waits = 0;         // every handle was checked out
+    double waitSeconds = 0.0;
+    double maxWaitMs = 0.0;
+    uint64_t version = 0;       // gallery changes recorded so far
+    uint64_t syncedOps = 0;     // changes replayed into individual handles
+    uint64_t syncErrors = 0;
+    uint64_t rebuilds = 0;      // handles reloaded from the gallery image after falling off the log
+
+    std::string summary() const;
+};
+
+// Several ZKFPM_DBInit caches holding the same gallery, so any thread can
+// match, identify or extract without serializing on one SDK handle.
+//
+// Checkout is lock-free: a thread first tries the handle it used last
+// (thread-local affinity), then takes any set bit of a global free mask;
+// only when every handle is out does it wait. Gallery changes go into a
+// short versioned log instead of touching handles other threads may be
+// using; each handle replays what it missed when it is next checked out.
+// The log holds at most MaxLogOps changes: a handle left idle for longer is
+// reloaded from the pool's own image of the gallery instead.
+class DbHandlePool : public GalleryListener {
+public:
+    static constexpr size_t MaxHandles = 64;
+    static constexpr size_t MaxLogOps = 4096;
+
+    // Exclusive use of one handle until destroyed
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        HANDLE get() const { return handle; }
+        explicit operator bool() const { return handle != nullptr; }
+
+    private:
+        friend class DbHandlePool;
+        Lease(DbHandlePool* owner, int slot, HANDLE handle) : owner(owner), slot(slot), handle(handle) {}
+        void reset();
+
+        DbHandlePool* owner = nullptr;
+        int slot = -1;
+        HANDLE handle = nullptr;
+    };
+
+    explicit DbHandlePool(WorkerPool& pool = WorkerPool::shared());
+    ~DbHandlePool();
+    DbHandlePool(const DbHandlePool&) = delete;
+    DbHandlePool& operator=(const DbHandlePool&) = delete;
+
+    // count = 0 uses one handle per pool worker; every handle is loaded with the gallery
+    bool initialize(size_t count = 0, const std::vector<GalleryEntry>& gallery = {});
+    // No lease may be outstanding
+    void release();
+    size_t size() const { return slots.size(); }
+
+    // Blocks while every handle is checked out
+    Lease checkout();
+
+    // Recorded once, applied to each handle before its next use
+    void add(unsigned int fid, const unsigned char* tpl, unsigned int size);
+    void remove(unsigned int fid);
+    void clear();
+
+    // Mirrors a FingerprintDevice gallery (FingerprintDevice::addGalleryListener)
+    void onTemplateAdded(unsigned int fid, const unsigned char* tpl, unsigned int size) override { add(fid, tpl, size); }
+    void onTemplateRemoved(unsigned int fid) override { remove(fid); }
+    void onGalleryCleared() override { clear(); }
+
+    bool identify(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score);
+    int match(const unsigned char* a, unsigned int sizeA, const unsigned char* b, unsigned int sizeB);
+
+    HandlePoolStats stats() const;
+    std::string getLastError() const;
+
+private:
+    using TemplateBytes = TrackedVector<MemoryTag::Gallery, unsigned char>;
+    enum class OpType { Add, Remove, Clear };
+    struct Op {
+        OpType type;
+        unsigned int fid;
+        TemplateBytes tpl;
+    };
+    struct Slot {
+        HANDLE handle = nullptr;
+        std::atomic<uint64_t> applied{ 0 }; // log version this handle has caught up to
+        size_t templates = 0;               // held in this handle's cache (memory accounting)
+    };
+
+    void checkin(int slot);
+    void catchUp(int slot);
+    void rebuild(Slot& slot);
+    void record(Op op);
+    void setError(const std::string& error);
+
+    WorkerPool& pool;
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::atomic<uint64_t> freeMask{ 0 };
+
+    std::atomic<uint64_t> version{ 0 };
+    std::mutex logMutex;  // appends and replays; checkout takes it only when its handle is behind
+    std::deque<Op> log;   // ops logBase .. version-1
+    uint64_t logBase = 0;
+    // The gallery as of `version`, for handles that fell off the log
+    std::map<unsigned int, TemplateBytes, std::less<unsigned int>,
+             TrackingAllocator<std::pair<const unsigned int, TemplateBytes>, MemoryTag::Gallery>> image;
+
+    std::atomic<uint64_t> checkouts{ 0 };
+    std::atomic<uint64_t> affinityHits{ 0 };
+    std::atomic<uint64_t> freeListHits{ 0 };
+    std::atomic<uint64_t> waits{ 0 };
+    std::atomic<uint64_t> waitNanos{ 0 };
+    std::atomic<uint64_t> maxWaitNanos{ 0 };
+    std::atomic<uint64_t> syncedOps{ 0 };
+    std::atomic<uint64_t> syncErrors{ 0 };
+    std::atomic<uint64_t> rebuilds{ 0 };
+
+    mutable std::mutex errorMutex;
+    std::string lastError;
+};
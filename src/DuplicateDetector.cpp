@@ -0,0 +1,238 @@
+#include "DuplicateDetector.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+DuplicateDetector::DuplicateDetector(WorkerPool& pool) : pool(pool) {}
+
+DuplicateDetector::~DuplicateDetector() {
+    release();
+}
+
+bool DuplicateDetector::initialize() {
+    release();
+    for (size_t i = 0; i < pool.size(); ++i) {
+        HANDLE h = ZKFPM_DBInit();
+        if (!h) {
+            lastError = "Failed to create DB cache for duplicate worker " + std::to_string(i) + ".";
+            release();
+            return false;
+        }
+        matchHandles.push_back(h);
+    }
+    int sdkThreshold = 0;
+    if (ZKFPM_DBGetParameter(matchHandles[0], FP_THRESHOLD_CODE, &sdkThreshold) == ZKFP_ERR_OK && sdkThreshold > 0)
+        threshold = sdkThreshold;
+    return true;
+}
+
+void DuplicateDetector::release() {
+    for (HANDLE h : matchHandles) ZKFPM_DBFree(h);
+    matchHandles.clear();
+}
+
+// ===== 1:N at enrollment =====
+
+bool DuplicateDetector::findDuplicate(const std::vector<GalleryEntry>& gallery, const unsigned char* tpl,
+                                      unsigned int size, DuplicateMatch& match) {
+    if (matchHandles.empty() || gallery.empty()) return false;
+
+    std::atomic<bool> found{ false };
+    std::mutex resultMutex;
+
+    pool.parallelFor(gallery.size(), [&](size_t begin, size_t end) {
+        HANDLE h = matchHandles[pool.currentWorker()];
+        for (size_t i = begin; i < end && !found.load(std::memory_order_relaxed); ++i) {
+            const GalleryEntry& e = gallery[i];
+            int score = ZKFPM_DBMatch(h, const_cast<unsigned char*>(tpl), size,
+                                      const_cast<unsigned char*>(e.data), e.size);
+            if (score >= threshold) {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (!found.exchange(true)) match = { e.fid, score };
+                return;
+            }
+        }
+    }, TaskPriority::High, 64);
+    return found.load();
+}
+
+// ===== All-pairs audit =====
+
+namespace {
+
+uint64_t galleryFingerprint(const std::vector<GalleryEntry>& gallery) {
+    uint64_t h = 1469598103934665603ull;
+    for (const auto& e : gallery) {
+        h = (h ^ e.fid) * 1099511628211ull;
+        h = (h ^ TemplateArena::hashBytes(e.data, e.size)) * 1099511628211ull;
+    }
+    return h;
+}
+
+std::string checkpointHeader(size_t count, size_t tileSize, int threshold, uint64_t fingerprint) {
+    std::ostringstream oss;
+    oss << "DEDUP 1 " << count << " " << tileSize << " " << threshold << " " << fingerprint;
+    return oss.str();
+}
+
+} // namespace
+
+bool DuplicateDetector::audit(const std::vector<GalleryEntry>& gallery, const std::string& checkpointPath,
+                              std::vector<DuplicateCluster>& clusters, std::vector<DuplicatePair>* pairsOut) {
+    if (matchHandles.empty()) {
+        lastError = "Duplicate detector not initialized.";
+        return false;
+    }
+
+    // Upper-triangular list of tiles (row block <= column block)
+    size_t blocks = (gallery.size() + tileSize - 1) / tileSize;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t bi = 0; bi < blocks; ++bi)
+        for (size_t bj = bi; bj < blocks; ++bj) tiles.emplace_back(bi, bj);
+
+    std::vector<char> done(tiles.size(), 0);
+    std::vector<DuplicatePair> pairs;
+    std::string header = checkpointHeader(gallery.size(), tileSize, threshold, galleryFingerprint(gallery));
+
+    // ---- Resume from a matching checkpoint ----
+    bool resume = false;
+    if (!checkpointPath.empty()) {
+        std::ifstream in(checkpointPath);
+        std::string line;
+        if (in && std::getline(in, line) && line == header) {
+            resume = true;
+            while (std::getline(in, line)) {
+                std::istringstream ls(line);
+                char kind = 0;
+                ls >> kind;
+                if (kind == 'T') {
+                    size_t idx;
+                    if (ls >> idx && idx < done.size()) done[idx] = 1;
+                } else if (kind == 'P') {
+                    DuplicatePair p;
+                    if (ls >> p.fidA >> p.fidB >> p.score) pairs.push_back(p);
+                }
+            }
+        }
+    }
+
+    std::ofstream checkpoint;
+    if (!checkpointPath.empty()) {
+        checkpoint.open(checkpointPath, resume ? std::ios::app : std::ios::trunc);
+        if (!checkpoint) {
+            lastError = "Cannot write checkpoint file: " + checkpointPath;
+            return false;
+        }
+        if (!resume) checkpoint << header << "\n" << std::flush;
+    }
+
+    // Tiles run as short strips of rows, so Low-priority audit work never holds a
+    // worker for long and High or pinned tasks get in between strips. A tile's
+    // pairs are recorded before its 'T' line once its last strip is done, so a
+    // crash mid-tile only repeats that tile.
+    struct Strip {
+        size_t tile, rowBegin, rowEnd;
+    };
+    size_t stripRows = std::max<size_t>(1, StripComparisons / tileSize);
+    std::vector<size_t> stripsLeft(tiles.size(), 0);
+    std::vector<std::vector<DuplicatePair>> tilePairs(tiles.size());
+    std::mutex outMutex;
+
+    size_t tileCursor = 0, rowCursor = 0;
+    auto nextStrip = [&](Strip& strip) {
+        for (; tileCursor < tiles.size(); ++tileCursor, rowCursor = 0) {
+            if (done[tileCursor]) continue;
+            size_t iBegin = tiles[tileCursor].first * tileSize, iEnd = std::min(gallery.size(), iBegin + tileSize);
+            if (rowCursor == 0) {
+                rowCursor = iBegin;
+                stripsLeft[tileCursor] = (iEnd - iBegin + stripRows - 1) / stripRows;
+            }
+            if (rowCursor < iEnd) {
+                strip = { tileCursor, rowCursor, std::min(iEnd, rowCursor + stripRows) };
+                rowCursor = strip.rowEnd;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<Strip> round;
+    for (;;) {
+        // One strip per task; a round is just enough to keep every worker busy
+        round.clear();
+        Strip strip;
+        while (round.size() < pool.size() * 4 && nextStrip(strip)) round.push_back(strip);
+        if (round.empty()) break;
+
+        pool.parallelFor(round.size(), [&](size_t begin, size_t end) {
+            HANDLE h = matchHandles[pool.currentWorker()];
+            std::vector<DuplicatePair> local;
+            for (size_t r = begin; r < end; ++r) {
+                const Strip& s = round[r];
+                size_t jBegin = tiles[s.tile].second * tileSize, jEnd = std::min(gallery.size(), jBegin + tileSize);
+                local.clear();
+                for (size_t i = s.rowBegin; i < s.rowEnd; ++i) {
+                    const GalleryEntry& a = gallery[i];
+                    for (size_t j = std::max(jBegin, i + 1); j < jEnd; ++j) {
+                        const GalleryEntry& b = gallery[j];
+                        int score = ZKFPM_DBMatch(h, const_cast<unsigned char*>(a.data), a.size,
+                                                  const_cast<unsigned char*>(b.data), b.size);
+                        if (score >= threshold) local.push_back({ a.fid, b.fid, score });
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(outMutex);
+                std::vector<DuplicatePair>& found = tilePairs[s.tile];
+                found.insert(found.end(), local.begin(), local.end());
+                if (--stripsLeft[s.tile] > 0) continue;
+                pairs.insert(pairs.end(), found.begin(), found.end());
+                if (checkpoint.is_open()) {
+                    for (const auto& p : found) checkpoint << "P " << p.fidA << " " << p.fidB << " " << p.score << "\n";
+                    checkpoint << "T " << s.tile << "\n" << std::flush;
+                }
+                std::vector<DuplicatePair>().swap(found);
+            }
+        }, TaskPriority::Low, 1);
+    }
+
+    // Drop repeats from a tile that was re-run after an interrupted checkpoint
+    std::sort(pairs.begin(), pairs.end(), [](const DuplicatePair& a, const DuplicatePair& b) {
+        return a.fidA != b.fidA ? a.fidA < b.fidA : a.fidB < b.fidB;
+    });
+    pairs.erase(std::unique(pairs.begin(), pairs.end(), [](const DuplicatePair& a, const DuplicatePair& b) {
+        return a.fidA == b.fidA && a.fidB == b.fidB;
+    }), pairs.end());
+
+    clusters = buildClusters(pairs);
+    if (pairsOut) *pairsOut = std::move(pairs);
+    return true;
+}
+
+std::vector<DuplicateCluster> DuplicateDetector::buildClusters(const std::vector<DuplicatePair>& pairs) {
+    // Union-find keyed by FID
+    std::map<unsigned int, unsigned int> parent;
+    auto find = [&](unsigned int x) {
+        auto it = parent.emplace(x, x).first;
+        while (it->second != it->first) {
+            auto up = parent.find(it->second);
+            it->second = parent[up->second]; // path halving
+            it = parent.find(it->second);
+        }
+        return it->first;
+    };
+    for (const auto& p : pairs) {
+        unsigned int a = find(p.fidA), b = find(p.fidB);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    std::map<unsigned int, DuplicateCluster> byRoot;
+    for (const auto& kv : parent) byRoot[find(kv.first)].fids.push_back(kv.first);
+
+    std::vector<DuplicateCluster> clusters;
+    for (auto& kv : byRoot)
+        if (kv.second.fids.size() > 1) clusters.push_back(std::move(kv.second));
+    return clusters;
+}
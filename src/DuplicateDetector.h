@@ -0,0 +1,63 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "WorkerPool.h"
+#include <string>
+#include <vector>
+
+struct DuplicateMatch {
+    unsigned int fid = 0;
+    int score = 0;
+};
+
+struct DuplicatePair {
+    unsigned int fidA;
+    unsigned int fidB;
+    int score;
+};
+
+// FIDs that all (transitively) match each other
+struct DuplicateCluster {
+    std::vector<unsigned int> fids;
+};
+
+// Finds templates enrolled more than once. Work runs on the shared
+// WorkerPool; each pool worker gets its own SDK DB cache handle and only
+// calls ZKFPM_DBMatch on it, so workers never share SDK state. The SDK must
+// already be initialized (ZKFPM_Init).
+class DuplicateDetector {
+public:
+    explicit DuplicateDetector(WorkerPool& pool = WorkerPool::shared());
+    ~DuplicateDetector();
+
+    bool initialize();
+    void release();
+    std::string getLastError() const { return lastError; }
+
+    // Minimum DBMatch score treated as "same finger" (defaults to the SDK's 1:1 threshold)
+    void setThreshold(int score) { threshold = score; }
+    int getThreshold() const { return threshold; }
+    void setTileSize(size_t size) { tileSize = size ? size : 1; }
+
+    // Parallel 1:N check of one template against the gallery; stops at the first hit
+    bool findDuplicate(const std::vector<GalleryEntry>& gallery, const unsigned char* tpl,
+                       unsigned int size, DuplicateMatch& match);
+
+    // Gallery-wide all-pairs audit in square tiles, run as short Low-priority
+    // tasks across all workers. Finished tiles and their hits are appended to
+    // checkpointPath, so an interrupted run picks up where it stopped. Pass an
+    // empty path to disable checkpoints.
+    bool audit(const std::vector<GalleryEntry>& gallery, const std::string& checkpointPath,
+               std::vector<DuplicateCluster>& clusters, std::vector<DuplicatePair>* pairs = nullptr);
+
+    static std::vector<DuplicateCluster> buildClusters(const std::vector<DuplicatePair>& pairs);
+
+private:
+    // Audit work per pool task, in DBMatch calls
+    static constexpr size_t StripComparisons = 4096;
+
+    WorkerPool& pool;
+    std::vector<HANDLE> matchHandles; // indexed by pool worker
+    int threshold = 55;
+    size_t tileSize = 256;
+    std::string lastError;
+};
@@ -0,0 +1,77 @@
+#include "FingerprintDevice.h"
+#include "MatchEvaluator.h"
+#include "WorkerPool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Offline FAR/FRR evaluation over a labelled image corpus.
+//
+//   eval_tool --manifest <file> [--det <csv>] [--checkpoint <file>]
+//             [--tile N] [--dpi N] [--threads N]
+
+static void printUsage() {
+    std::printf("Usage: eval_tool --manifest <file> [--det <csv>] [--checkpoint <file>]\n"
+                "                 [--tile N] [--dpi N] [--threads N]\n");
+}
+
+int main(int argc, char** argv) {
+    std::string manifestPath, detPath, checkpointPath;
+    size_t threads = 0, tile = 0;
+    unsigned int dpi = 500;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--manifest") manifestPath = next();
+        else if (arg == "--det") detPath = next();
+        else if (arg == "--checkpoint") checkpointPath = next();
+        else if (arg == "--tile") tile = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--dpi") dpi = (unsigned int)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--threads") threads = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (manifestPath.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<CorpusSample> corpus;
+    std::string error;
+    if (!MatchEvaluator::loadManifest(manifestPath, corpus, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    WorkerPool& pool = WorkerPool::shared(threads);
+
+    FingerprintDevice fp;
+    if (!fp.initialize()) {
+        std::fprintf(stderr, "%s\n", fp.getLastError().c_str());
+        return 1;
+    }
+
+    MatchEvaluator eval(pool);
+    if (tile) eval.setTileSize(tile);
+    eval.setDpi(dpi);
+    if (!eval.initialize() || !eval.extract(corpus) || !eval.score(checkpointPath)) {
+        std::fprintf(stderr, "Evaluation failed: %s\n", eval.getLastError().c_str());
+        eval.release();
+        fp.terminate();
+        return 1;
+    }
+
+    std::printf("%s", eval.report().c_str());
+    if (!detPath.empty()) {
+        if (eval.writeDetCsv(detPath)) std::printf("DET curve written to %s\n", detPath.c_str());
+        else std::fprintf(stderr, "Cannot write %s\n", detPath.c_str());
+    }
+
+    std::printf("Scheduler:\n%s", pool.statsSummary().c_str());
+    eval.release();
+    fp.terminate();
+    return 0;
+}
@@ -1,4 +1,8 @@
 #include "FingerprintDevice.h"
+#include "DuplicateDetector.h"
+#include "CaptureFile.h"
+#include "CaptureArchive.h"
+#include <algorithm>
 #include <iostream>
 
 FingerprintDevice::FingerprintDevice() = default;
@@ -9,14 +13,17 @@ FingerprintDevice::~FingerprintDevice() {
 }
 
 bool FingerprintDevice::initialize() {
+    lastErrorCode = ZKFP_ERR_OK;
     int result = ZKFPM_Init();
     if (result != ZKFP_ERR_OK) {
+        lastErrorCode = result;
         lastError = "Failed to initialize SDK. Error code: " + std::to_string(result);
         return false;
     }
     initialized = true;
     dbCache = ZKFPM_DBInit();
     if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INITLIB;
         lastError = "Failed to create fingerprint DB cache.";
         return false;
     }
@@ -25,6 +32,7 @@ bool FingerprintDevice::initialize() {
 
 void FingerprintDevice::terminate() {
     if (dbCache) {
+        MemoryAccounting::sdkTemplatesRemoved(enrolled.size());
         ZKFPM_DBFree(dbCache);
         dbCache = nullptr;
     }
@@ -40,13 +48,16 @@ int FingerprintDevice::getDeviceCount() const {
 }
 
 bool FingerprintDevice::openDevice(int index) {
+    lastErrorCode = ZKFP_ERR_OK;
     if (!initialized) {
+        lastErrorCode = ZKFP_ERR_INIT;
         lastError = "SDK not initialized.";
         return false;
     }
 
     deviceHandle = ZKFPM_OpenDevice(index);
     if (!deviceHandle) {
+        lastErrorCode = ZKFP_ERR_OPEN;
         lastError = "Failed to open device.";
         return false;
     }
@@ -67,74 +78,267 @@ std::string FingerprintDevice::getLastError() const {
 // ===== Extended SDK operations =====
 
 bool FingerprintDevice::registerFingerprint() {
+    lastErrorCode = ZKFP_ERR_OK;
     if (!deviceHandle) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
         lastError = "Device not opened.";
         return false;
     }
+    lastErrorCode = ZKFP_ERR_NOT_SUPPORT;
     lastError = "Register() not implemented yet.";
     return false;
 }
 
 bool FingerprintDevice::clearFingerprints() {
+    lastErrorCode = ZKFP_ERR_OK;
     if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
         lastError = "DB cache not available.";
         return false;
     }
     int res = ZKFPM_DBClear(dbCache);
     if (res != ZKFP_ERR_OK) {
+        lastErrorCode = res;
         lastError = "Failed to clear fingerprints. Error code: " + std::to_string(res);
         return false;
     }
+    MemoryAccounting::sdkTemplatesRemoved(enrolled.size());
+    enrolled.clear();
+    templates.clear();
+    for (GalleryListener* listener : galleryListeners) listener->onGalleryCleared();
     return true;
 }
 
 bool FingerprintDevice::verifyFingerprint() {
+    lastErrorCode = ZKFP_ERR_OK;
     if (!deviceHandle) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
         lastError = "Device not opened.";
         return false;
     }
+    lastErrorCode = ZKFP_ERR_NOT_SUPPORT;
     lastError = "Verify() not implemented yet.";
     return false;
 }
 
 bool FingerprintDevice::identifyFingerprint() {
+    lastErrorCode = ZKFP_ERR_OK;
     if (!deviceHandle) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
         lastError = "Device not opened.";
         return false;
     }
+    lastErrorCode = ZKFP_ERR_NOT_SUPPORT;
     lastError = "Identify() not implemented yet.";
     return false;
 }
 
+bool FingerprintDevice::extractFromImage(const std::string& imagePath) {
+    lastErrorCode = ZKFP_ERR_OK;
+    unsigned int templateSize = static_cast<unsigned int>(scratchTemplate.size());
+    int res = ZKFPM_ExtractFromImage(dbCache, imagePath.c_str(), 500, scratchTemplate.data(), &templateSize);
+    if (res != ZKFP_ERR_OK) {
+        lastErrorCode = res;
+        lastError = "Failed to extract fingerprint from image. Error code: " + std::to_string(res);
+        return false;
+    }
+    lastTemplate.assign(scratchTemplate.begin(), scratchTemplate.begin() + templateSize);
+    return true;
+}
+
 bool FingerprintDevice::registerByImage(const std::string& imagePath) {
+    lastErrorCode = ZKFP_ERR_OK;
+    if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
+        lastError = "DB cache not available.";
+        return false;
+    }
+    if (!extractFromImage(imagePath)) {
+        lastError = "Failed to register by image. " + lastError;
+        return false;
+    }
+    unsigned int fid = 0;
+    return enrollTemplate(lastTemplate.data(), static_cast<unsigned int>(lastTemplate.size()), fid);
+}
+
+bool FingerprintDevice::identifyByImage(const std::string& imagePath) {
+    lastErrorCode = ZKFP_ERR_OK;
+    if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
+        lastError = "DB cache not available.";
+        return false;
+    }
+    if (!extractFromImage(imagePath)) {
+        lastError = "Failed to extract fingerprint image for identification.";
+        return false;
+    }
+    unsigned int fid = 0, score = 0;
+    return identifyTemplate(lastTemplate.data(), static_cast<unsigned int>(lastTemplate.size()), fid, score);
+}
+
+// ===== Gallery management =====
+
+bool FingerprintDevice::enrollTemplate(const unsigned char* tpl, unsigned int size, unsigned int& fid) {
+    while (enrolled.count(nextFid)) nextFid++;
+    fid = nextFid;
+    return enrollTemplateAs(fid, tpl, size);
+}
+
+bool FingerprintDevice::enrollTemplateAs(unsigned int fid, const unsigned char* tpl, unsigned int size) {
+    lastErrorCode = ZKFP_ERR_OK;
     if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
         lastError = "DB cache not available.";
         return false;
     }
-    unsigned char templateBuf[2048];
-    unsigned int templateSize = sizeof(templateBuf);
-    int res = ZKFPM_ExtractFromImage(dbCache, imagePath.c_str(), 500, templateBuf, &templateSize);
+    if (!tpl || size == 0 || size > MAX_TEMPLATE_SIZE) {
+        lastErrorCode = ZKFP_ERR_INVALID_PARAM;
+        lastError = "Invalid template.";
+        return false;
+    }
+    if (enrolled.count(fid)) {
+        lastErrorCode = ZKFP_ERR_ADD_FINGER;
+        lastError = "FID " + std::to_string(fid) + " is already enrolled.";
+        return false;
+    }
+
+    if (duplicateDetector) {
+        DuplicateMatch dup;
+        if (duplicateDetector->findDuplicate(sharedGallery(), tpl, size, dup)) {
+            lastErrorCode = ZKFP_ERR_ADD_FINGER;
+            lastError = "Fingerprint already enrolled as FID " + std::to_string(dup.fid) +
+                        " (score " + std::to_string(dup.score) + ").";
+            return false;
+        }
+    }
+
+    TemplateArena::Handle handle = templates.add(tpl, size);
+    const unsigned char* stored = nullptr;
+    unsigned int storedSize = 0;
+    templates.get(handle, stored, storedSize);
+
+    int res = ZKFPM_DBAdd(dbCache, fid, const_cast<unsigned char*>(stored), storedSize);
     if (res != ZKFP_ERR_OK) {
-        lastError = "Failed to register by image. Error code: " + std::to_string(res);
+        templates.release(handle);
+        lastErrorCode = res;
+        lastError = "Failed to add template to DB cache. Error code: " + std::to_string(res);
         return false;
     }
+    MemoryAccounting::sdkTemplatesAdded(1);
+    if (fid >= nextFid) nextFid = fid + 1;
+    enrolled[fid] = handle;
+    if (galleryViewValid && galleryViewLayout == templates.layoutVersion()) {
+        auto at = std::lower_bound(galleryView.begin(), galleryView.end(), fid,
+                                   [](const GalleryEntry& e, unsigned int f) { return e.fid < f; });
+        galleryView.insert(at, { fid, stored, storedSize });
+    }
+    for (GalleryListener* listener : galleryListeners) listener->onTemplateAdded(fid, stored, storedSize);
     return true;
 }
 
-bool FingerprintDevice::identifyByImage(const std::string& imagePath) {
+bool FingerprintDevice::removeTemplate(unsigned int fid) {
+    lastErrorCode = ZKFP_ERR_OK;
     if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
         lastError = "DB cache not available.";
         return false;
     }
-    unsigned char templateBuf[2048];
-    unsigned int templateSize = sizeof(templateBuf);
-    int res = ZKFPM_ExtractFromImage(dbCache, imagePath.c_str(), 500, templateBuf, &templateSize);
+    auto it = enrolled.find(fid);
+    if (it == enrolled.end()) {
+        lastErrorCode = ZKFP_ERR_DEL_FINGER;
+        lastError = "FID " + std::to_string(fid) + " is not enrolled.";
+        return false;
+    }
+    int res = ZKFPM_DBDel(dbCache, fid);
     if (res != ZKFP_ERR_OK) {
-        lastError = "Failed to extract fingerprint image for identification.";
+        lastErrorCode = res;
+        lastError = "Failed to delete template. Error code: " + std::to_string(res);
         return false;
     }
-    lastError = "IdentifyByImage() not implemented yet.";
-    return false;
+    MemoryAccounting::sdkTemplatesRemoved(1);
+    templates.release(it->second);
+    enrolled.erase(it);
+    if (galleryViewValid && galleryViewLayout == templates.layoutVersion()) {
+        auto at = std::lower_bound(galleryView.begin(), galleryView.end(), fid,
+                                   [](const GalleryEntry& e, unsigned int f) { return e.fid < f; });
+        if (at != galleryView.end() && at->fid == fid) galleryView.erase(at);
+    }
+    for (GalleryListener* listener : galleryListeners) listener->onTemplateRemoved(fid);
+    return true;
+}
+
+void FingerprintDevice::addGalleryListener(GalleryListener* listener) {
+    if (std::find(galleryListeners.begin(), galleryListeners.end(), listener) == galleryListeners.end())
+        galleryListeners.push_back(listener);
+}
+
+void FingerprintDevice::removeGalleryListener(GalleryListener* listener) {
+    galleryListeners.erase(std::remove(galleryListeners.begin(), galleryListeners.end(), listener), galleryListeners.end());
+}
+
+std::vector<GalleryEntry> FingerprintDevice::snapshotGallery() const {
+    std::vector<GalleryEntry> entries;
+    entries.reserve(enrolled.size());
+    for (const auto& kv : enrolled) {
+        GalleryEntry e{ kv.first, nullptr, 0 };
+        if (templates.get(kv.second, e.data, e.size)) entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const GalleryEntry& a, const GalleryEntry& b) { return a.fid < b.fid; });
+    return entries;
+}
+
+const std::vector<GalleryEntry>& FingerprintDevice::sharedGallery() const {
+    if (!galleryViewValid || galleryViewLayout != templates.layoutVersion()) {
+        galleryView = snapshotGallery();
+        galleryViewLayout = templates.layoutVersion();
+        galleryViewValid = true;
+    }
+    return galleryView;
+}
+
+// ===== Matching =====
+
+bool FingerprintDevice::identifyTemplate(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score) {
+    lastErrorCode = ZKFP_ERR_OK;
+    if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
+        lastError = "DB cache not available.";
+        return false;
+    }
+    int res = ZKFPM_DBIdentify(dbCache, const_cast<unsigned char*>(tpl), size, &fid, &score);
+    if (res != ZKFP_ERR_OK) {
+        lastErrorCode = res;
+        lastError = "No matching fingerprint found. Error code: " + std::to_string(res);
+        return false;
+    }
+    return true;
+}
+
+bool FingerprintDevice::verifyTemplate(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score) {
+    lastErrorCode = ZKFP_ERR_OK;
+    if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
+        lastError = "DB cache not available.";
+        return false;
+    }
+    score = ZKFPM_VerifyByID(dbCache, fid, const_cast<unsigned char*>(tpl), size);
+    if (score <= 0) {
+        lastErrorCode = score;
+        lastError = "Fingerprint does not match FID " + std::to_string(fid) + ". Result: " + std::to_string(score);
+        return false;
+    }
+    return true;
+}
+
+int FingerprintDevice::matchTemplates(const unsigned char* a, unsigned int sizeA, const unsigned char* b, unsigned int sizeB) {
+    lastErrorCode = ZKFP_ERR_OK;
+    if (!dbCache) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
+        lastError = "DB cache not available.";
+        return ZKFP_ERR_INVALID_HANDLE;
+    }
+    return ZKFPM_DBMatch(dbCache, const_cast<unsigned char*>(a), sizeA, const_cast<unsigned char*>(b), sizeB);
 }
 
 // ===== Live Fingerprint Capture =====
@@ -171,8 +375,11 @@ bool FingerprintDevice::identifyByImage(const std::string& imagePath) {
 
 //     return true;
 // }
-bool FingerprintDevice::acquireLiveFingerprint(std::vector<unsigned char>& imageBuffer, int& width, int& height) {
+bool FingerprintDevice::acquireLiveFingerprint(CaptureBuffer& imageBuffer, int& width, int& height) {
+    lastErrorCode = ZKFP_ERR_OK;
+    if (replay) return acquireReplayFrame(imageBuffer, width, height);
     if (!deviceHandle) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
         lastError = "Device not opened.";
         return false;
     }
@@ -180,13 +387,17 @@ bool FingerprintDevice::acquireLiveFingerprint(std::vector<unsigned char>& image
     unsigned char paramBuf[4];
     unsigned int size = 4;
 
-    if (ZKFPM_GetParameters(deviceHandle, 1, paramBuf, &size) != ZKFP_ERR_OK) {
+    int res = ZKFPM_GetParameters(deviceHandle, 1, paramBuf, &size);
+    if (res != ZKFP_ERR_OK) {
+        lastErrorCode = res;
         lastError = "Failed to get image width.";
         return false;
     }
     width = *(int*)paramBuf;
 
-    if (ZKFPM_GetParameters(deviceHandle, 2, paramBuf, &size) != ZKFP_ERR_OK) {
+    res = ZKFPM_GetParameters(deviceHandle, 2, paramBuf, &size);
+    if (res != ZKFP_ERR_OK) {
+        lastErrorCode = res;
         lastError = "Failed to get image height.";
         return false;
     }
@@ -195,26 +406,78 @@ bool FingerprintDevice::acquireLiveFingerprint(std::vector<unsigned char>& image
     unsigned int imgSize = width * height;
     imageBuffer.resize(imgSize);
 
-    unsigned char fpTemplate[2048];
-    unsigned int templateSize = sizeof(fpTemplate);
+    unsigned int templateSize = static_cast<unsigned int>(scratchTemplate.size());
 
-    int res = ZKFPM_AcquireFingerprint(deviceHandle, imageBuffer.data(), imgSize, fpTemplate, &templateSize);
+    res = ZKFPM_AcquireFingerprint(deviceHandle, imageBuffer.data(), imgSize, scratchTemplate.data(), &templateSize);
     if (res != ZKFP_ERR_OK) {
+        lastErrorCode = res;
         lastError = "Failed to acquire fingerprint. Error code: " + std::to_string(res);
         return false;
     }
+    lastTemplate.assign(scratchTemplate.begin(), scratchTemplate.begin() + templateSize);
+    keepCapture(imageBuffer.data(), width, height);
+    return true;
+}
+
+void FingerprintDevice::acceptCapture(const unsigned char* image, int width, int height,
+                                      const unsigned char* tpl, unsigned int templateSize) {
+    lastTemplate.assign(tpl, tpl + templateSize);
+    keepCapture(image, width, height);
+}
+
+void FingerprintDevice::keepCapture(const unsigned char* image, int width, int height) {
+    unsigned int templateSize = static_cast<unsigned int>(lastTemplate.size());
+    if (recorder && !recorder->record(image, width, height, lastTemplate.data(), templateSize)) {
+        // A failing recorder must not break live capture; stop recording instead
+        recorder = nullptr;
+    }
+    if (archiver) archiver->submit(image, width, height, lastTemplate.data(), templateSize);
+    updateHexTemplate();
+}
+
+bool FingerprintDevice::getCaptureParams(int& width, int& height, int& dpi) {
+    lastErrorCode = ZKFP_ERR_OK;
+    if (!deviceHandle) {
+        lastErrorCode = ZKFP_ERR_INVALID_HANDLE;
+        lastError = "Device not opened.";
+        return false;
+    }
+    int res = ZKFPM_GetCaptureParamsEx(deviceHandle, &width, &height, &dpi);
+    if (res != ZKFP_ERR_OK) {
+        lastErrorCode = res;
+        lastError = "Failed to read capture parameters. Error code: " + std::to_string(res);
+        return false;
+    }
+    return true;
+}
 
+bool FingerprintDevice::acquireReplayFrame(CaptureBuffer& imageBuffer, int& width, int& height) {
+    const CaptureFrame* frame = nullptr;
+    if (!replay->next(frame)) {
+        // ZKFP_ERR_CAPTURE is what the sensor reports with no finger on it; a
+        // finished replay has no frames left at all, like a missing device
+        bool finished = replay->finished();
+        lastErrorCode = finished ? ZKFP_ERR_NO_DEVICE : ZKFP_ERR_CAPTURE;
+        lastError = finished ? "Replay finished." : "No finger (replay frame not due yet).";
+        return false;
+    }
+    width = frame->width;
+    height = frame->height;
+    imageBuffer.assign(frame->image, frame->image + frame->imageSize);
+    lastTemplate.assign(frame->fpTemplate, frame->fpTemplate + frame->templateSize);
+    updateHexTemplate();
+    return true;
+}
+
+void FingerprintDevice::updateHexTemplate() {
     // 🟣 Convert fingerprint template to HEX string
     std::string hexTemplate;
+    hexTemplate.reserve(lastTemplate.size() * 2);
     char buf[3];
-    for (unsigned int i = 0; i < templateSize; ++i) {
-        sprintf(buf, "%02X", fpTemplate[i]);
+    for (unsigned char byte : lastTemplate) {
+        sprintf(buf, "%02X", byte);
         hexTemplate += buf;
     }
-
-// Inside acquireLiveFingerprint after converting to HEX:
-lastHexTemplate = hexTemplate;
-
-
-    return true;
+    lastHexTemplate = hexTemplate;
+    hexCharge.set(lastHexTemplate.capacity());
 }
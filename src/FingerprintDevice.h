@@ -44,8 +44,33 @@
 #include <windows.h>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include "libzkfp.h"
 #include "libzkfperrdef.h"
+#include "MemoryAccounting.h"
+#include "TemplateArena.h"
+
+class DuplicateDetector;
+class CaptureRecorder;
+class CaptureReplay;
+class CaptureArchiver;
+
+// One enrolled template as seen by batch jobs (points into the gallery arena)
+struct GalleryEntry {
+    unsigned int fid;
+    const unsigned char* data;
+    unsigned int size;
+};
+
+// Told about every successful gallery change, on the thread that made it
+// (DB-handle pool mirroring, replication)
+class GalleryListener {
+public:
+    virtual ~GalleryListener() = default;
+    virtual void onTemplateAdded(unsigned int fid, const unsigned char* tpl, unsigned int size) = 0;
+    virtual void onTemplateRemoved(unsigned int fid) = 0;
+    virtual void onGalleryCleared() = 0;
+};
 
 class FingerprintDevice {
 public:
@@ -59,6 +84,7 @@ public:
     bool openDevice(int index = 0);
     void closeDevice();
     std::string getLastError() const;
+    int getLastErrorCode() const { return lastErrorCode; }
 
     // Extended operations
     bool registerFingerprint();
@@ -68,17 +94,79 @@ public:
     bool registerByImage(const std::string& imagePath);
     bool identifyByImage(const std::string& imagePath);
 
+    // Gallery management (DB cache + our own packed copy of each template)
+    bool enrollTemplate(const unsigned char* tpl, unsigned int size, unsigned int& fid);
+    // Enroll under a caller-chosen FID (imports, replication); fails if the FID is taken
+    bool enrollTemplateAs(unsigned int fid, const unsigned char* tpl, unsigned int size);
+    bool isEnrolled(unsigned int fid) const { return enrolled.count(fid) != 0; }
+    bool removeTemplate(unsigned int fid);
+    size_t getEnrolledCount() const { return enrolled.size(); }
+    // Sorted by FID; pointers stay valid until the gallery is next modified
+    std::vector<GalleryEntry> snapshotGallery() const;
+    // The same, but one shared copy: kept current in place on enroll/remove and
+    // rebuilt only after the arena moves its records. Valid until the next change.
+    const std::vector<GalleryEntry>& sharedGallery() const;
+    // When set, enrollTemplate() rejects templates that match an enrolled one
+    void setDuplicateDetector(DuplicateDetector* detector) { duplicateDetector = detector; }
+    void addGalleryListener(GalleryListener* listener);
+    void removeGalleryListener(GalleryListener* listener);
+
+    // Matching against the DB cache
+    bool identifyTemplate(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score);
+    bool verifyTemplate(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score);
+    int matchTemplates(const unsigned char* a, unsigned int sizeA, const unsigned char* b, unsigned int sizeB);
+
     // Live fingerprint capture
-    bool acquireLiveFingerprint(std::vector<unsigned char>& imageBuffer, int& width, int& height);
+    bool acquireLiveFingerprint(CaptureBuffer& imageBuffer, int& width, int& height);
+    // Every successful live capture is also appended to the recorder
+    void setRecorder(CaptureRecorder* captureRecorder) { recorder = captureRecorder; }
+    // Every successful live capture is also handed to the audit archive (never blocks)
+    void setArchiver(CaptureArchiver* captureArchiver) { archiver = captureArchiver; }
+    // When set, captures come from the recording instead of the sensor (no device needed)
+    void setReplay(CaptureReplay* captureReplay) { replay = captureReplay; }
+    bool canCapture() const { return deviceHandle != nullptr || replay != nullptr; }
+    // Sensor image geometry and resolution
+    bool getCaptureParams(int& width, int& height, int& dpi);
+    // Adopt a capture made outside acquireLiveFingerprint() (CapturePipeline): it
+    // becomes the last template and goes to the recorder/archiver like a live one
+    void acceptCapture(const unsigned char* image, int width, int height,
+                       const unsigned char* tpl, unsigned int templateSize);
 
     // Accessors
     inline HANDLE getHandle() const { return deviceHandle; }
     inline std::string getLastHexTemplate() const { return lastHexTemplate; }
+    inline const TemplateBuffer& getLastTemplate() const { return lastTemplate; }
+    inline const TemplateArena& getTemplates() const { return templates; }
 
 private:
+    bool extractFromImage(const std::string& imagePath);
+    bool acquireReplayFrame(CaptureBuffer& imageBuffer, int& width, int& height);
+    void updateHexTemplate();
+    void keepCapture(const unsigned char* image, int width, int height);
+
     HANDLE deviceHandle = nullptr;
     HANDLE dbCache = nullptr;
     bool initialized = false;
     std::string lastError;
+    int lastErrorCode = ZKFP_ERR_OK; // SDK code behind lastError, when there is one
     std::string lastHexTemplate; // 🟣 Stores HEX fingerprint data from last successful capture
+    MemoryCharge hexCharge{ MemoryTag::Templates };
+
+    // Single scratch buffer the SDK writes into; results are trimmed to their real size
+    TemplateBuffer scratchTemplate = TemplateBuffer(MAX_TEMPLATE_SIZE);
+    TemplateBuffer lastTemplate;
+
+    TemplateArena templates;
+    std::unordered_map<unsigned int, TemplateArena::Handle, std::hash<unsigned int>, std::equal_to<unsigned int>,
+                       TrackingAllocator<std::pair<const unsigned int, TemplateArena::Handle>, MemoryTag::Gallery>>
+        enrolled; // FID -> arena handle
+    mutable std::vector<GalleryEntry> galleryView; // sharedGallery()
+    mutable bool galleryViewValid = false;
+    mutable uint64_t galleryViewLayout = 0;        // arena layout the view's pointers belong to
+    unsigned int nextFid = 1;
+    DuplicateDetector* duplicateDetector = nullptr;
+    std::vector<GalleryListener*> galleryListeners;
+    CaptureRecorder* recorder = nullptr;
+    CaptureReplay* replay = nullptr;
+    CaptureArchiver* archiver = nullptr;
 };
@@ -0,0 +1,245 @@
+#include "FrameBus.h"
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace {
+
+uint64_t nowMs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t slotStride(uint32_t slotBytes) {
+    return (sizeof(FrameSlotHeader) + slotBytes + 63) & ~size_t(63);
+}
+
+size_t headerStride() {
+    return (sizeof(FrameBusHeader) + 63) & ~size_t(63);
+}
+
+} // namespace
+
+// ===== Publisher =====
+
+FrameBusPublisher::~FrameBusPublisher() {
+    close();
+}
+
+bool FrameBusPublisher::create(const std::string& name, uint32_t slotCount, uint32_t slotBytes) {
+    close();
+    if (slotCount == 0 || slotBytes == 0) {
+        lastError = "Frame bus needs at least one slot.";
+        return false;
+    }
+    uint64_t total = headerStride() + (uint64_t)slotCount * slotStride(slotBytes);
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(total >> 32),
+                                 (DWORD)(total & 0xFFFFFFFF), name.c_str());
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (size_t)total) : nullptr;
+    if (!view) {
+        lastError = "Cannot create frame bus " + name + ".";
+        close();
+        return false;
+    }
+
+    header = new (view) FrameBusHeader();
+    header->slotCount = slotCount;
+    header->slotBytes = slotBytes;
+    header->width = 0;
+    header->height = 0;
+    header->dpi = 0;
+    header->published = 0;
+    for (auto& r : header->readers) {
+        r.active = 0;
+        r.generation = 0;
+        r.pid = 0;
+        r.position = 0;
+        r.dropped = 0;
+        r.heartbeat = 0;
+    }
+    slots = static_cast<unsigned char*>(view) + headerStride();
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        auto* s = new (slots + i * slotStride(slotBytes)) FrameSlotHeader();
+        s->sequence = 0;
+    }
+    header->version = FrameBusHeader::Version;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = FrameBusHeader::Magic; // readers check this last
+    return true;
+}
+
+void FrameBusPublisher::close() {
+    if (header) UnmapViewOfFile(header);
+    if (mapping) CloseHandle(mapping);
+    header = nullptr;
+    slots = nullptr;
+    mapping = nullptr;
+}
+
+void FrameBusPublisher::setGeometry(int width, int height, int dpi) {
+    if (!header) return;
+    header->width = width;
+    header->height = height;
+    header->dpi = dpi;
+}
+
+bool FrameBusPublisher::publish(const unsigned char* pixels, unsigned int size, int width, int height) {
+    if (!header) return false;
+    if (size > header->slotBytes) {
+        lastError = "Frame of " + std::to_string(size) + " bytes does not fit a bus slot.";
+        return false;
+    }
+    uint64_t n = header->published.load(std::memory_order_relaxed);
+    auto* s = reinterpret_cast<FrameSlotHeader*>(slots + (n % header->slotCount) * slotStride(header->slotBytes));
+
+    // Seqlock: odd while writing so a reader still holding this slot can tell
+    s->sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s->timestampUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    s->width = width;
+    s->height = height;
+    s->size = size;
+    std::memcpy(reinterpret_cast<unsigned char*>(s) + sizeof(FrameSlotHeader), pixels, size);
+    s->sequence.store(2 * n + 2, std::memory_order_release);
+    header->published.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+std::vector<FrameBusReaderInfo> FrameBusPublisher::readers(double staleSeconds) {
+    std::vector<FrameBusReaderInfo> out;
+    if (!header) return out;
+    uint64_t published = header->published.load();
+    uint64_t now = nowMs();
+    for (auto& r : header->readers) {
+        // Entries still being claimed have no heartbeat of their own yet
+        if (r.active.load() != 1) continue;
+        double idle = (now - r.heartbeat.load()) / 1000.0;
+        if (idle > staleSeconds) {
+            // Crashed or hung reader: free its entry (a live one claims another on its next poll)
+            uint32_t taken = 1;
+            r.active.compare_exchange_strong(taken, 0);
+            continue;
+        }
+        uint64_t pos = r.position.load();
+        out.push_back({ r.pid.load(), published > pos ? published - pos : 0, r.dropped.load(), idle });
+    }
+    return out;
+}
+
+// ===== Reader =====
+
+FrameBusReader::~FrameBusReader() {
+    close();
+}
+
+bool FrameBusReader::open(const std::string& name) {
+    close();
+    mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+    if (!view) {
+        lastError = "Frame bus " + name + " is not running.";
+        close();
+        return false;
+    }
+    header = static_cast<FrameBusHeader*>(view);
+    if (header->magic != FrameBusHeader::Magic || header->version != FrameBusHeader::Version) {
+        lastError = "Frame bus " + name + " has an unknown layout.";
+        close();
+        return false;
+    }
+    slots = static_cast<unsigned char*>(view) + headerStride();
+    position = header->published.load(); // start with the next live frame
+    droppedFrames = 0;
+    if (claim()) return true;
+    lastError = "Frame bus " + name + " already has the maximum number of readers.";
+    close();
+    return false;
+}
+
+bool FrameBusReader::claim() {
+    for (uint32_t i = 0; i < FrameBusHeader::MaxReaders; ++i) {
+        uint32_t expected = 0;
+        auto& r = header->readers[i];
+        if (r.active.compare_exchange_strong(expected, 2)) {
+            generation = r.generation.fetch_add(1) + 1;
+            r.pid = GetCurrentProcessId();
+            r.dropped = droppedFrames;
+            r.heartbeat = nowMs();
+            r.position = position;
+            // Only now visible to readers(), so it never sees the previous owner's heartbeat
+            r.active.store(1);
+            slot = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FrameBusReader::ownsEntry() const {
+    const auto& r = header->readers[slot];
+    return r.active.load() == 1 && r.generation.load() == generation;
+}
+
+void FrameBusReader::close() {
+    uint32_t taken = 1;
+    if (header && ownsEntry()) header->readers[slot].active.compare_exchange_strong(taken, 0);
+    if (header) UnmapViewOfFile(header);
+    if (mapping) CloseHandle(mapping);
+    header = nullptr;
+    slots = nullptr;
+    mapping = nullptr;
+    slot = 0;
+    generation = 0;
+}
+
+const FrameSlotHeader* FrameBusReader::slotAt(uint64_t frame) const {
+    return reinterpret_cast<const FrameSlotHeader*>(slots + (frame % header->slotCount) * slotStride(header->slotBytes));
+}
+
+bool FrameBusReader::next(FrameView& view) {
+    if (!header) return false;
+    // Reclaimed as stale (and maybe handed to another reader) while we were slow
+    if (!ownsEntry() && !claim()) {
+        lastError = "Frame bus reader entry was reclaimed and no entry is free.";
+        return false;
+    }
+    auto& me = header->readers[slot];
+    me.heartbeat.store(nowMs(), std::memory_order_relaxed);
+
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    bool found = false;
+    while (!found && position < published) {
+        if (published - position > header->slotCount) {
+            // Lapped: everything older than one ring is gone
+            uint64_t oldest = published - header->slotCount;
+            droppedFrames += oldest - position;
+            position = oldest;
+        }
+        const FrameSlotHeader* s = slotAt(position);
+        if (s->sequence.load(std::memory_order_acquire) != 2 * position + 2) {
+            // Overwritten since we looked at 'published'; re-read and skip ahead
+            published = header->published.load(std::memory_order_acquire);
+            droppedFrames++;
+            position++;
+            continue;
+        }
+        view.frame = position;
+        view.timestampUs = s->timestampUs;
+        view.width = s->width;
+        view.height = s->height;
+        view.size = s->size;
+        view.pixels = reinterpret_cast<const unsigned char*>(s) + sizeof(FrameSlotHeader);
+        position++;
+        found = true;
+    }
+    me.position.store(position, std::memory_order_relaxed);
+    me.dropped.store(droppedFrames, std::memory_order_relaxed);
+    return found;
+}
+
+bool FrameBusReader::stillValid(const FrameView& view) const {
+    if (!header) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slotAt(view.frame)->sequence.load(std::memory_order_relaxed) == 2 * view.frame + 2;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Live sensor frames published into a named shared mapping for any local
+// process (preview, liveness check, archiver, monitor). Frames sit in a ring
+// of sequence-numbered slots; readers look at them in place, no per-reader
+// copy. The producer never waits: a reader that falls a full ring behind is
+// skipped forward and its drop count goes up.
+//
+// Mapping layout: FrameBusHeader, then slotCount slots of
+// (FrameSlotHeader + slotBytes of pixels).
+struct FrameBusHeader {
+    static constexpr uint32_t Magic = 0x5346425A; // "ZBFS"
+    static constexpr uint32_t Version = 3;
+    static constexpr uint32_t MaxReaders = 8;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotBytes;
+    // Sensor geometry (from ZKFPM_GetCaptureParamsEx)
+    std::atomic<int32_t> width;
+    std::atomic<int32_t> height;
+    std::atomic<int32_t> dpi;
+    std::atomic<uint64_t> published; // frames published so far; frame n lives in slot n % slotCount
+
+    struct Reader {
+        std::atomic<uint32_t> active;    // 0 free, 2 being claimed, 1 taken (fields below are valid)
+        std::atomic<uint32_t> generation; // bumped on every claim, so a reclaimed owner can tell
+        std::atomic<uint32_t> pid;
+        std::atomic<uint64_t> position;  // next frame number it will read
+        std::atomic<uint64_t> dropped;   // frames it missed by falling behind
+        std::atomic<uint64_t> heartbeat; // ms timestamp of its last poll
+    } readers[MaxReaders];
+};
+
+struct FrameSlotHeader {
+    std::atomic<uint64_t> sequence; // 2n+1 while frame n is written, 2n+2 once complete
+    uint64_t timestampUs;
+    int32_t width;
+    int32_t height;
+    uint32_t size;
+    uint32_t reserved;
+};
+
+// A frame as seen by a reader: points straight into the mapping. Check
+// FrameBusReader::stillValid() after using it; the producer may have reused
+// the slot if the reader took longer than a full ring.
+struct FrameView {
+    uint64_t frame = 0;
+    uint64_t timestampUs = 0;
+    int width = 0;
+    int height = 0;
+    const unsigned char* pixels = nullptr;
+    unsigned int size = 0;
+};
+
+struct FrameBusReaderInfo {
+    uint32_t pid;
+    uint64_t lag;     // frames published but not yet read
+    uint64_t dropped;
+    double idleSeconds;
+};
+
+class FrameBusPublisher {
+public:
+    FrameBusPublisher() = default;
+    ~FrameBusPublisher();
+
+    bool create(const std::string& name, uint32_t slotCount = 8, uint32_t slotBytes = 1024 * 1024);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    void setGeometry(int width, int height, int dpi);
+    bool publish(const unsigned char* pixels, unsigned int size, int width, int height);
+
+    // Readers that haven't polled for staleSeconds are treated as crashed and
+    // unregistered; one that was only slow registers again on its next poll
+    std::vector<FrameBusReaderInfo> readers(double staleSeconds = 5.0);
+    std::string getLastError() const { return lastError; }
+
+private:
+    HANDLE mapping = nullptr;
+    FrameBusHeader* header = nullptr;
+    unsigned char* slots = nullptr;
+    std::string lastError;
+};
+
+class FrameBusReader {
+public:
+    FrameBusReader() = default;
+    ~FrameBusReader();
+
+    bool open(const std::string& name);
+    void close();
+
+    // Next unread frame, if any. Skips ahead (counting drops) when lapped.
+    bool next(FrameView& view);
+    bool stillValid(const FrameView& view) const;
+
+    int width() const { return header ? header->width.load() : 0; }
+    int height() const { return header ? header->height.load() : 0; }
+    int dpi() const { return header ? header->dpi.load() : 0; }
+    uint64_t dropped() const { return droppedFrames; }
+    std::string getLastError() const { return lastError; }
+
+private:
+    const FrameSlotHeader* slotAt(uint64_t frame) const;
+    bool claim();
+    bool ownsEntry() const;
+
+    HANDLE mapping = nullptr;
+    FrameBusHeader* header = nullptr;
+    unsigned char* slots = nullptr;
+    uint32_t slot = 0;
+    uint32_t generation = 0; // of our entry when we claimed it
+    // Kept here and only mirrored into the entry, which the publisher may
+    // hand to another reader if we stall past its stale limit
+    uint64_t position = 0;
+    uint64_t droppedFrames = 0;
+    std::string lastError;
+};
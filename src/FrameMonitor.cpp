@@ -0,0 +1,79 @@
+#include "FrameBus.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+// Reads live frames off the shared-memory frame bus published by the demo
+// (ZKFP_FRAME_BUS=<name>) and prints rate, geometry and drops once a second.
+//
+//   frame_monitor --bus <name> [--seconds N]
+
+static void printUsage() {
+    std::printf("Usage: frame_monitor --bus <name> [--seconds N]\n");
+}
+
+int main(int argc, char** argv) {
+    std::string busName;
+    double runSeconds = 0.0; // 0 = until killed
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--bus") busName = next();
+        else if (arg == "--seconds") runSeconds = std::strtod(next().c_str(), nullptr);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (busName.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    FrameBusReader reader;
+    if (!reader.open(busName)) {
+        std::fprintf(stderr, "%s\n", reader.getLastError().c_str());
+        return 1;
+    }
+    std::printf("Sensor %dx%d @ %d dpi\n", reader.width(), reader.height(), reader.dpi());
+
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+    auto windowStart = started;
+    uint64_t frames = 0, torn = 0;
+    FrameView view;
+    double meanLevel = 0.0;
+
+    for (;;) {
+        bool got = false;
+        while (reader.next(view)) {
+            got = true;
+            // Mean grey level: a cheap "is anything on the glass" signal
+            uint64_t sum = 0;
+            for (unsigned int i = 0; i < view.size; ++i) sum += view.pixels[i];
+            if (!reader.stillValid(view)) {
+                torn++; // overwritten while we were reading it
+                continue;
+            }
+            meanLevel = view.size ? (double)sum / view.size : 0.0;
+            frames++;
+        }
+
+        auto now = Clock::now();
+        double window = std::chrono::duration<double>(now - windowStart).count();
+        if (window >= 1.0) {
+            std::printf("%.1f frames/s, last %dx%d, mean level %.1f, dropped %llu, torn %llu\n",
+                        frames / window, view.width, view.height, meanLevel,
+                        (unsigned long long)reader.dropped(), (unsigned long long)torn);
+            std::fflush(stdout);
+            frames = 0;
+            windowStart = now;
+        }
+        if (runSeconds > 0.0 && std::chrono::duration<double>(now - started).count() >= runSeconds) break;
+        if (!got) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "FrameQuality.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAME_QUALITY_SSE2 1
+#endif
+
+namespace {
+
+const int BlockSize = 16;
+const double MinRidgeDeviation = 10.0; // below this a block is background or smudge
+const double FullContrast = 40.0;      // mean deviation of a well-inked block
+
+} // namespace
+
+double FrameQuality::meanAbsDiff(const unsigned char* a, const unsigned char* b, size_t size) {
+    if (size == 0) return 0.0;
+    uint64_t total = 0;
+    size_t i = 0;
+#if FRAME_QUALITY_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb)); // two 64-bit partial sums
+    }
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    total = lanes[0] + lanes[1];
+#endif
+    for (; i < size; ++i) total += (uint64_t)std::abs((int)a[i] - (int)b[i]);
+    return (double)total / size;
+}
+
+int FrameQuality::score(const unsigned char* pixels, int width, int height) {
+    int blocksX = width / BlockSize, blocksY = height / BlockSize;
+    if (blocksX == 0 || blocksY == 0) return 0;
+    int ridgeBlocks = 0;
+    double contrast = 0.0;
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const unsigned char* block = pixels + (size_t)by * BlockSize * width + bx * BlockSize;
+            unsigned sum = 0;
+            for (int y = 0; y < BlockSize; ++y)
+                for (int x = 0; x < BlockSize; ++x) sum += block[(size_t)y * width + x];
+            int mean = (int)(sum / (BlockSize * BlockSize));
+            unsigned deviation = 0;
+            for (int y = 0; y < BlockSize; ++y)
+                for (int x = 0; x < BlockSize; ++x) deviation += (unsigned)std::abs(block[(size_t)y * width + x] - mean);
+            double d = (double)deviation / (BlockSize * BlockSize);
+            if (d >= MinRidgeDeviation) {
+                ridgeBlocks++;
+                contrast += std::min(1.0, d / FullContrast);
+            }
+        }
+    }
+    if (ridgeBlocks == 0) return 0;
+    double coverage = (double)ridgeBlocks / (blocksX * blocksY);
+    return (int)(100.0 * coverage * (contrast / ridgeBlocks) + 0.5);
+}
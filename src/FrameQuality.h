@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+// Cheap per-frame checks used to pick the best frame of a touch before any
+// template extraction is spent on it.
+namespace FrameQuality {
+
+// Mean absolute pixel difference between two equally sized frames (SSE2 SAD
+// where available). Near zero means the sensor returned the same image again.
+double meanAbsDiff(const unsigned char* a, const unsigned char* b, size_t size);
+
+// 0-100: fraction of 16x16 blocks that show ridge texture, weighted by how
+// strong that texture is. Partial contacts and smudges score low.
+int score(const unsigned char* pixels, int width, int height);
+
+} // namespace FrameQuality
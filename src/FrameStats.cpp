@@ -0,0 +1,56 @@
+#include "FrameStats.h"
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+#include <chrono>
+#include <cstdio>
+
+FrameStats::FrameStats() {
+    lastWall = wallClockSeconds();
+    lastCpu = processCpuSeconds();
+}
+
+double FrameStats::wallClockSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+double FrameStats::processCpuSeconds() {
+    FILETIME creation, exitTime, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user)) return 0.0;
+    auto toSeconds = [](const FILETIME& ft) {
+        unsigned long long ticks = ((unsigned long long)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+        return ticks * 1e-7; // 100ns units
+    };
+    return toSeconds(kernel) + toSeconds(user);
+}
+
+void FrameStats::endFrame(bool isActive) {
+    double wall = wallClockSeconds();
+    double cpu = processCpuSeconds();
+    Bucket& b = isActive ? active : idle;
+    double frame = wall - lastWall;
+    b.frames++;
+    b.wallSeconds += frame;
+    b.cpuSeconds += cpu - lastCpu;
+    if (frame > b.maxFrameSeconds) b.maxFrameSeconds = frame;
+    lastWall = wall;
+    lastCpu = cpu;
+}
+
+std::string FrameStats::describe(const char* name, const Bucket& b) {
+    char buf[160];
+    if (b.frames == 0 || b.wallSeconds <= 0.0) {
+        std::snprintf(buf, sizeof(buf), "%s: no frames", name);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%s: %llu frames, avg %.2f ms, max %.2f ms, CPU %.1f%%",
+                      name, b.frames, 1000.0 * b.wallSeconds / b.frames,
+                      1000.0 * b.maxFrameSeconds, 100.0 * b.cpuSeconds / b.wallSeconds);
+    }
+    return buf;
+}
+
+std::string FrameStats::summary() const {
+    return describe("Idle", idle) + " | " + describe("Active", active);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+
+// Frame time / process CPU accounting for the GUI loop, split by whether the
+// UI was idle (event-driven, nothing dirty) or active (capturing, redrawing).
+class FrameStats {
+public:
+    FrameStats();
+
+    // Call once per loop iteration, after EndDrawing()
+    void endFrame(bool active);
+
+    std::string summary() const;
+
+private:
+    struct Bucket {
+        unsigned long long frames = 0;
+        double wallSeconds = 0.0;
+        double cpuSeconds = 0.0;
+        double maxFrameSeconds = 0.0;
+    };
+
+    static double processCpuSeconds();
+    static double wallClockSeconds();
+    static std::string describe(const char* name, const Bucket& b);
+
+    Bucket idle;
+    Bucket active;
+    double lastWall = 0.0;
+    double lastCpu = 0.0;
+};
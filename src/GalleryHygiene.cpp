@@ -0,0 +1,221 @@
+#include "GalleryHygiene.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <sstream>
+
+// ===== QualityHistogram =====
+
+void QualityHistogram::add(int quality) {
+    bins[std::clamp(quality, 0, 100)]++;
+    total++;
+}
+
+int QualityHistogram::percentile(double q) const {
+    if (total == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q / 100.0 * (double)total + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i <= 100; ++i) {
+        seen += bins[i];
+        if (seen >= rank) return i;
+    }
+    return 100;
+}
+
+std::string QualityHistogram::render(int binWidth) const {
+    binWidth = std::max(binWidth, 1);
+    // 100 goes into the top band rather than a band of its own
+    std::vector<uint64_t> bands((size_t)((100 + binWidth - 1) / binWidth), 0);
+    for (int q = 0; q <= 100; ++q) bands[std::min((size_t)(q / binWidth), bands.size() - 1)] += bins[q];
+    uint64_t widest = std::max<uint64_t>(1, *std::max_element(bands.begin(), bands.end()));
+    std::ostringstream oss;
+    for (size_t b = 0; b < bands.size(); ++b) {
+        int lo = (int)b * binWidth;
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %3d-%-3d %8llu ", lo, b + 1 == bands.size() ? 100 : lo + binWidth - 1, (unsigned long long)bands[b]);
+        oss << line << std::string((size_t)(40 * bands[b] / widest), '#') << "\n";
+    }
+    return oss.str();
+}
+
+// ===== HygieneReport =====
+
+size_t HygieneReport::count(HygieneReason reason) const {
+    return (size_t)std::count_if(flags.begin(), flags.end(), [&](const HygieneFlag& f) { return f.reason == reason; });
+}
+
+std::string HygieneReport::summary() const {
+    size_t reenroll = (size_t)std::count_if(flags.begin(), flags.end(), [](const HygieneFlag& f) { return f.reenroll; });
+    char line[320];
+    std::snprintf(line, sizeof(line),
+                  "%zu templates in %.2f s (%zu unscored), quality p10 %d / p50 %d / p90 %d; "
+                  "%zu low quality (%zu to re-enroll), %zu redundant across %zu of %zu persons, %zu quarantined",
+                  scanned, seconds, unscored, quality.percentile(10.0), quality.percentile(50.0), quality.percentile(90.0),
+                  count(HygieneReason::LowQuality), reenroll, count(HygieneReason::Redundant), personsWithRedundancy,
+                  persons, quarantined);
+    return line;
+}
+
+// ===== GalleryHygiene =====
+
+GalleryHygiene::GalleryHygiene(WorkerPool& pool) : pool(pool) {}
+
+GalleryHygiene::~GalleryHygiene() {
+    release();
+}
+
+bool GalleryHygiene::initialize() {
+    release();
+    for (size_t i = 0; i < pool.size(); ++i) {
+        HANDLE h = ZKFPM_DBInit();
+        if (!h) {
+            lastError = "Failed to create DB cache for hygiene worker " + std::to_string(i) + ".";
+            release();
+            return false;
+        }
+        matchHandles.push_back(h);
+    }
+    int sdkThreshold = 0;
+    if (ZKFPM_DBGetParameter(matchHandles[0], FP_THRESHOLD_CODE, &sdkThreshold) == ZKFP_ERR_OK && sdkThreshold > 0)
+        matchThreshold = sdkThreshold;
+    return true;
+}
+
+void GalleryHygiene::release() {
+    for (HANDLE h : matchHandles) ZKFPM_DBFree(h);
+    matchHandles.clear();
+}
+
+bool GalleryHygiene::scan(const std::vector<GalleryEntry>& gallery, HygieneReport& report) {
+    if (matchHandles.empty()) {
+        lastError = "Hygiene job not initialized.";
+        return false;
+    }
+    if (!deviceHandle) {
+        lastError = "Quality scoring needs an open device handle.";
+        return false;
+    }
+    auto started = std::chrono::steady_clock::now();
+    report = HygieneReport();
+    report.scanned = gallery.size();
+
+    // Negative = the SDK's error code for that template
+    std::vector<int> scores(gallery.size(), -1);
+    pool.parallelFor(gallery.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int q = ZKFPM_GetTemplateQuality(deviceHandle, const_cast<unsigned char*>(gallery[i].data), gallery[i].size);
+            scores[i] = std::min(q, 100);
+        }
+    }, TaskPriority::Low, 256);
+
+    std::map<int, size_t> errors;
+    for (int q : scores) {
+        if (q < 0) {
+            report.unscored++;
+            errors[q]++;
+        } else {
+            report.quality.add(q);
+        }
+    }
+    // A systematic failure (wrong handle, unsupported SDK) would otherwise pass as a clean gallery
+    if (report.unscored * 2 > gallery.size()) {
+        auto common = std::max_element(errors.begin(), errors.end(),
+                                       [](const auto& a, const auto& b) { return a.second < b.second; });
+        lastError = "Quality scoring failed for " + std::to_string(report.unscored) + " of " +
+                    std::to_string(gallery.size()) + " templates (most often error " + std::to_string(common->first) + ").";
+        return false;
+    }
+    flagTemplates(gallery, scores, report);
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+// Groups templates by person and finger, best quality first. Each template is
+// matched against the ones already kept in its group; a hit means it is
+// redundant. Low-quality templates are flagged afterwards, except the best of a
+// group whose kept templates are all low quality.
+void GalleryHygiene::flagTemplates(const std::vector<GalleryEntry>& gallery, const std::vector<int>& scores,
+                                   HygieneReport& report) {
+    std::vector<unsigned int> coveredBy(gallery.size(), 0);
+    std::vector<char> sole(gallery.size(), 0); // written from several workers, so not vector<bool>
+
+    if (identities) {
+        std::map<uint64_t, std::vector<size_t>> groups; // personId << 8 | finger
+        std::set<uint32_t> persons;
+        for (size_t i = 0; i < gallery.size(); ++i) {
+            Identity id;
+            if (!identities->find(gallery[i].fid, id)) continue;
+            groups[(uint64_t)id.personId << 8 | id.finger].push_back(i);
+            persons.insert(id.personId);
+        }
+        report.persons = persons.size();
+
+        std::vector<std::vector<size_t>*> work;
+        for (auto& [key, members] : groups) work.push_back(&members);
+        pool.parallelFor(work.size(), [&](size_t begin, size_t end) {
+            HANDLE h = matchHandles[pool.currentWorker()];
+            for (size_t g = begin; g < end; ++g) {
+                std::vector<size_t>& members = *work[g];
+                std::stable_sort(members.begin(), members.end(), [&](size_t a, size_t b) { return scores[a] > scores[b]; });
+                std::vector<size_t> kept;
+                for (size_t i : members) {
+                    const GalleryEntry& e = gallery[i];
+                    for (size_t k : kept) {
+                        const GalleryEntry& keeper = gallery[k];
+                        int score = ZKFPM_DBMatch(h, const_cast<unsigned char*>(e.data), e.size,
+                                                  const_cast<unsigned char*>(keeper.data), keeper.size);
+                        if (score >= matchThreshold) {
+                            coveredBy[i] = keeper.fid;
+                            break;
+                        }
+                    }
+                    if (!coveredBy[i]) kept.push_back(i);
+                }
+                // kept[0] has the best score, so if it is low quality every kept template is
+                if (scores[kept[0]] < minQuality) sole[kept[0]] = 1;
+            }
+        }, TaskPriority::Low, 1);
+
+        std::set<uint32_t> redundantPersons;
+        for (size_t i = 0; i < gallery.size(); ++i) {
+            Identity id;
+            if (coveredBy[i] && identities->find(gallery[i].fid, id)) redundantPersons.insert(id.personId);
+        }
+        report.personsWithRedundancy = redundantPersons.size();
+    }
+
+    for (size_t i = 0; i < gallery.size(); ++i) {
+        bool stays = true;
+        if (coveredBy[i]) {
+            report.flags.push_back({ gallery[i].fid, std::max(scores[i], 0), HygieneReason::Redundant, coveredBy[i], false });
+            stays = false;
+        } else if (scores[i] >= 0 && scores[i] < minQuality) {
+            report.flags.push_back({ gallery[i].fid, scores[i], HygieneReason::LowQuality, 0, sole[i] != 0 });
+            stays = sole[i] != 0;
+        }
+        if (stays && scores[i] >= 0) report.keptQuality.add(scores[i]);
+    }
+    std::sort(report.flags.begin(), report.flags.end(), [](const HygieneFlag& a, const HygieneFlag& b) { return a.fid < b.fid; });
+}
+
+bool GalleryHygiene::quarantine(FingerprintDevice& device, HygieneReport& report, const std::string& path,
+                                GalleryFormat format) {
+    std::vector<unsigned int> leaving;
+    for (const HygieneFlag& f : report.flags)
+        if (!f.reenroll) leaving.push_back(f.fid);
+    if (leaving.empty()) return true;
+
+    // Written first, so nothing leaves the gallery without a copy on disk
+    GalleryExporter exporter(device, pool);
+    exporter.setFidFilter([&](unsigned int fid) { return std::binary_search(leaving.begin(), leaving.end(), fid); });
+    TransferStats stats;
+    if (!exporter.run(path, format, stats)) {
+        lastError = exporter.getLastError();
+        return false;
+    }
+    for (unsigned int fid : leaving) report.quarantined += device.removeTemplate(fid);
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "GalleryTransfer.h"
+#include "IdentityIndex.h"
+#include "WorkerPool.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ZKFPM_GetTemplateQuality scores, 0-100
+struct QualityHistogram {
+    std::array<uint64_t, 101> bins{};
+    uint64_t total = 0;
+
+    void add(int quality);
+    int percentile(double q) const; // q in [0, 100]
+    // One text bar per binWidth-point band
+    std::string render(int binWidth = 10) const;
+};
+
+enum class HygieneReason {
+    LowQuality, // scored below the minimum
+    Redundant   // same person and finger as a better template it matches
+};
+
+struct HygieneFlag {
+    unsigned int fid = 0;
+    int quality = 0;
+    HygieneReason reason = HygieneReason::LowQuality;
+    unsigned int coveredBy = 0; // Redundant: the template that stays
+    bool reenroll = false;      // LowQuality but the person's only template for that finger; not quarantined
+};
+
+struct HygieneReport {
+    size_t scanned = 0;
+    size_t unscored = 0;            // the SDK returned an error (scan fails if that is most of them)
+    QualityHistogram quality;       // every scored template
+    QualityHistogram keptQuality;   // what stays active once the flags are quarantined
+    std::vector<HygieneFlag> flags; // sorted by FID
+    size_t persons = 0;             // with an identity index
+    size_t personsWithRedundancy = 0;
+    size_t quarantined = 0;
+    double seconds = 0.0;
+
+    size_t count(HygieneReason reason) const;
+    std::string summary() const;
+};
+
+// Batch clean-up of the enrolled gallery. Every template is scored with
+// ZKFPM_GetTemplateQuality across the shared pool (this needs an open device;
+// scan() fails if most templates cannot be scored). Templates below the minimum
+// are flagged. With an identity index, each person's templates are also grouped
+// by finger, and any template that matches a better one on the same finger is
+// flagged as redundant: it costs an identify comparison and adds no coverage.
+//
+// quarantine() writes the flagged templates to a dump that GalleryImporter can
+// read back, then removes them from the device. Low-quality templates a person
+// cannot lose are kept and marked for re-enrollment instead.
+class GalleryHygiene {
+public:
+    explicit GalleryHygiene(WorkerPool& pool = WorkerPool::shared());
+    ~GalleryHygiene();
+
+    bool initialize();
+    void release();
+    std::string getLastError() const { return lastError; }
+
+    void setMinQuality(int quality) { minQuality = quality; }
+    // Minimum DBMatch score for two templates to count as the same finger
+    void setMatchThreshold(int score) { matchThreshold = score; }
+    // Person and finger per FID; without it only the quality pass runs
+    void setIdentityIndex(const IdentityIndex* index) { identities = index; }
+    // ZKFPM_GetTemplateQuality rejects anything but an open device handle
+    void setDeviceHandle(HANDLE handle) { deviceHandle = handle; }
+
+    bool scan(const std::vector<GalleryEntry>& gallery, HygieneReport& report);
+    bool quarantine(FingerprintDevice& device, HygieneReport& report, const std::string& path, GalleryFormat format);
+
+private:
+    void flagTemplates(const std::vector<GalleryEntry>& gallery, const std::vector<int>& scores, HygieneReport& report);
+
+    WorkerPool& pool;
+    std::vector<HANDLE> matchHandles; // indexed by pool worker
+    const IdentityIndex* identities = nullptr;
+    HANDLE deviceHandle = nullptr;
+    int minQuality = 40;
+    int matchThreshold = 55;
+    std::string lastError;
+};
@@ -0,0 +1,316 @@
+#include "GalleryManager.h"
+#include <algorithm>
+#include <chrono>
+
+GalleryManager::GalleryManager(WorkerPool& pool) : pool(pool) {}
+
+GalleryManager::~GalleryManager() {
+    shutdown();
+}
+
+void GalleryManager::shutdown() {
+    {
+        std::unique_lock<std::mutex> lock(asyncMutex);
+        asyncIdle.wait(lock, [this] { return asyncPending == 0; });
+    }
+    {
+        std::lock_guard<std::mutex> lock(swapMutex);
+        live.reset();
+    }
+    // Any generation a call still holds is freed when that call returns
+    std::unique_lock<std::mutex> lock(generations->mutex);
+    generations->none.wait(lock, [this] { return generations->alive == 0; });
+}
+
+GalleryManager::GenerationPtr GalleryManager::current() const {
+    std::lock_guard<std::mutex> lock(swapMutex);
+    return live;
+}
+
+void GalleryManager::setError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    lastError = error;
+}
+
+std::string GalleryManager::getLastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return lastError;
+}
+
+// ===== Publishing =====
+
+uint64_t GalleryManager::beginBuild() {
+    std::lock_guard<std::mutex> lock(changeMutex);
+    builders++;
+    return changeSeq;
+}
+
+void GalleryManager::endBuild() {
+    std::lock_guard<std::mutex> lock(changeMutex);
+    if (--builders == 0) journal.clear();
+}
+
+// `since` is the change sequence when the snapshot was taken; later changes are
+// replayed onto the new cache under changeMutex, so none lands between the
+// replay and the swap
+bool GalleryManager::build(const std::vector<GalleryEntry>& entries, uint64_t since) {
+    auto started = std::chrono::steady_clock::now();
+    HANDLE cache = ZKFPM_DBInit();
+    if (!cache) {
+        setError("Failed to create DB cache for the new gallery.");
+        return false;
+    }
+    std::vector<unsigned int> fids;
+    fids.reserve(entries.size());
+    for (const GalleryEntry& e : entries) {
+        int res = ZKFPM_DBAdd(cache, e.fid, const_cast<unsigned char*>(e.data), e.size);
+        if (res != ZKFP_ERR_OK) {
+            ZKFPM_DBFree(cache);
+            setError("Failed to add FID " + std::to_string(e.fid) + " to the new gallery. Error code: " + std::to_string(res));
+            return false;
+        }
+        fids.push_back(e.fid);
+    }
+    std::sort(fids.begin(), fids.end());
+    MemoryAccounting::sdkTemplatesAdded(fids.size());
+
+    // The old cache goes when its last reader drops it; DBFree runs on the pool
+    // so that reader's identify never pays for it
+    WorkerPool* freePool = &pool;
+    std::shared_ptr<GenerationCount> count = generations;
+    {
+        std::lock_guard<std::mutex> lock(count->mutex);
+        count->alive++;
+    }
+    GenerationPtr next(new Generation, [freePool, count](Generation* g) {
+        freePool->post([g, count] {
+            if (g->cache) {
+                ZKFPM_DBFree(g->cache);
+                MemoryAccounting::sdkTemplatesRemoved(g->fids.size());
+            }
+            delete g;
+            std::lock_guard<std::mutex> lock(count->mutex);
+            if (--count->alive == 0) count->none.notify_all();
+        }, TaskPriority::Low);
+    });
+    next->cache = cache;
+    next->id = nextId.fetch_add(1);
+    next->fids = std::move(fids);
+
+    GenerationPtr old;
+    {
+        std::lock_guard<std::mutex> changeLock(changeMutex);
+        for (const Change& c : journal)
+            if (c.seq > since) apply(*next, c.kind, c.fid, c.tpl.data(), (unsigned int)c.tpl.size());
+        std::lock_guard<std::mutex> lock(swapMutex);
+        old = std::move(live);
+        live = std::move(next);
+    }
+    old.reset(); // drops our reference outside the swap lock
+    published++;
+    lastBuildNanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+bool GalleryManager::publish(const std::vector<GalleryEntry>& entries) {
+    uint64_t since = beginBuild();
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(buildMutex);
+        ok = build(entries, since);
+    }
+    endBuild();
+    return ok;
+}
+
+void GalleryManager::publishAsync(const std::vector<GalleryEntry>& entries, std::function<void(bool)> done) {
+    // Snapshot pointers die with the next gallery change, so pack a private copy now
+    struct Packed {
+        std::vector<unsigned char> bytes;
+        std::vector<GalleryEntry> entries;
+    };
+    auto packed = std::make_shared<Packed>();
+    size_t total = 0;
+    for (const GalleryEntry& e : entries) total += e.size;
+    packed->bytes.resize(total);
+    packed->entries.reserve(entries.size());
+    size_t offset = 0;
+    for (const GalleryEntry& e : entries) {
+        std::copy(e.data, e.data + e.size, packed->bytes.begin() + offset);
+        packed->entries.push_back({ e.fid, nullptr, e.size });
+        offset += e.size;
+    }
+    offset = 0;
+    for (GalleryEntry& e : packed->entries) {
+        e.data = packed->bytes.data() + offset;
+        offset += e.size;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex);
+        asyncPending++;
+    }
+    // Changes from here on are journaled until this job has swapped
+    uint64_t since = beginBuild();
+    auto finish = [this, done = std::move(done)](bool ok) {
+        endBuild();
+        if (done) done(ok);
+        std::lock_guard<std::mutex> lock(asyncMutex);
+        if (--asyncPending == 0) asyncIdle.notify_all();
+    };
+    auto job = [this, packed, since, finish] {
+        bool ok;
+        {
+            std::lock_guard<std::mutex> lock(buildMutex);
+            ok = build(packed->entries, since);
+        }
+        finish(ok);
+    };
+    if (!admission) {
+        pool.post(std::move(job), TaskPriority::Low);
+        return;
+    }
+    admission->submit(Lane::Bulk, std::move(job), [this, finish](Admission result) {
+        if (result == Admission::Completed) return;
+        admitted(result, Lane::Bulk);
+        finish(false);
+    });
+}
+
+// ===== In-place changes =====
+
+void GalleryManager::onTemplateAdded(unsigned int fid, const unsigned char* tpl, unsigned int size) {
+    change(ChangeKind::Add, fid, tpl, size);
+}
+
+void GalleryManager::onTemplateRemoved(unsigned int fid) {
+    change(ChangeKind::Remove, fid, nullptr, 0);
+}
+
+void GalleryManager::onGalleryCleared() {
+    change(ChangeKind::Clear, 0, nullptr, 0);
+}
+
+void GalleryManager::change(ChangeKind kind, unsigned int fid, const unsigned char* tpl, unsigned int size) {
+    std::lock_guard<std::mutex> lock(changeMutex);
+    uint64_t seq = ++changeSeq;
+    if (builders > 0) journal.push_back({ seq, kind, fid, std::vector<unsigned char>(tpl, tpl + size) });
+    // Nothing published yet: the first publish carries it
+    if (GenerationPtr g = current()) {
+        if (apply(*g, kind, fid, tpl, size)) applied++;
+    }
+}
+
+bool GalleryManager::apply(Generation& g, ChangeKind kind, unsigned int fid, const unsigned char* tpl, unsigned int size) {
+    std::lock_guard<std::mutex> lock(g.callMutex);
+    auto at = std::lower_bound(g.fids.begin(), g.fids.end(), fid);
+    bool present = at != g.fids.end() && *at == fid;
+    switch (kind) {
+    case ChangeKind::Add: {
+        if (present) return true; // already in the snapshot this generation was built from
+        int res = ZKFPM_DBAdd(g.cache, fid, const_cast<unsigned char*>(tpl), size);
+        if (res != ZKFP_ERR_OK) {
+            setError("Failed to add FID " + std::to_string(fid) + " to gallery generation " + std::to_string(g.id) +
+                     ". Error code: " + std::to_string(res));
+            return false;
+        }
+        g.fids.insert(at, fid);
+        MemoryAccounting::sdkTemplatesAdded(1);
+        return true;
+    }
+    case ChangeKind::Remove:
+        if (!present) return true;
+        ZKFPM_DBDel(g.cache, fid);
+        g.fids.erase(at);
+        MemoryAccounting::sdkTemplatesRemoved(1);
+        return true;
+    case ChangeKind::Clear:
+        ZKFPM_DBClear(g.cache);
+        MemoryAccounting::sdkTemplatesRemoved(g.fids.size());
+        g.fids.clear();
+        return true;
+    }
+    return false;
+}
+
+// ===== Read side =====
+
+// Records why a request never ran
+bool GalleryManager::admitted(Admission result, Lane lane) {
+    if (result == Admission::Completed) return true;
+    setError(std::string("The ") + toString(lane) + " lane " +
+             (result == Admission::Rejected ? "is full" : "shed the request past its deadline") + ".");
+    return false;
+}
+
+bool GalleryManager::identify(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score) {
+    if (!admission) return identifyLive(tpl, size, fid, score);
+    bool ok = false;
+    Admission result = admission->run(Lane::Identify, [&] { ok = identifyLive(tpl, size, fid, score); });
+    return admitted(result, Lane::Identify) && ok;
+}
+
+bool GalleryManager::verify(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score) {
+    if (!admission) return verifyLive(fid, tpl, size, score);
+    bool ok = false;
+    Admission result = admission->run(Lane::Verify, [&] { ok = verifyLive(fid, tpl, size, score); });
+    return admitted(result, Lane::Verify) && ok;
+}
+
+bool GalleryManager::identifyLive(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score) {
+    GenerationPtr g = current();
+    if (!g) {
+        setError("No gallery published yet.");
+        return false;
+    }
+    int res;
+    {
+        std::lock_guard<std::mutex> lock(g->callMutex);
+        res = ZKFPM_DBIdentify(g->cache, const_cast<unsigned char*>(tpl), size, &fid, &score);
+    }
+    if (res != ZKFP_ERR_OK) {
+        setError("No matching fingerprint found. Error code: " + std::to_string(res));
+        return false;
+    }
+    return true;
+}
+
+bool GalleryManager::verifyLive(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score) {
+    GenerationPtr g = current();
+    if (!g) {
+        setError("No gallery published yet.");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g->callMutex);
+        if (!std::binary_search(g->fids.begin(), g->fids.end(), fid)) {
+            setError("FID " + std::to_string(fid) + " is not in gallery generation " + std::to_string(g->id) + ".");
+            return false;
+        }
+        score = ZKFPM_VerifyByID(g->cache, fid, const_cast<unsigned char*>(tpl), size);
+    }
+    if (score <= 0) {
+        setError("Fingerprint does not match FID " + std::to_string(fid) + ". Result: " + std::to_string(score));
+        return false;
+    }
+    return true;
+}
+
+GalleryManager::Stats GalleryManager::stats() const {
+    Stats s;
+    GenerationPtr g = current();
+    if (g) {
+        std::lock_guard<std::mutex> lock(g->callMutex);
+        s.generation = g->id;
+        s.templates = g->fids.size();
+    }
+    s.published = published.load();
+    s.applied = applied.load();
+    {
+        std::lock_guard<std::mutex> lock(generations->mutex);
+        s.retiredPending = generations->alive - (g ? 1 : 0);
+    }
+    s.lastBuildSeconds = lastBuildNanos.load() / 1e9;
+    return s;
+}
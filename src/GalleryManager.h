@@ -0,0 +1,122 @@
+#pragma once
+#include "AdmissionController.h"
+#include "FingerprintDevice.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves identify/verify from a versioned DB cache so the gallery can be
+// replaced without downtime (RCU style):
+//   - publish() builds a fresh ZKFPM DB cache from a snapshot off to the side
+//   - the new generation is swapped in with a pointer exchange
+//   - calls already running keep their reference to the old generation; its
+//     cache is freed (on the pool) only after the last of them returns
+//
+// Single enrollments do not need a new generation: as a GalleryListener the
+// manager applies adds, removals and clears to the live cache in place. A
+// change made while a publish is still building is also replayed onto the new
+// cache before it is swapped in, so it is not lost with the old generation.
+//
+// With an AdmissionController, identify and verify go through its Identify and
+// Verify lanes and publishAsync() rebuilds through the Bulk lane, so a rebuild
+// or other bulk work on the same controller cannot hold up the door.
+class GalleryManager : public GalleryListener {
+public:
+    struct Stats {
+        uint64_t generation = 0;  // 0 = nothing published yet
+        size_t templates = 0;
+        uint64_t published = 0;
+        uint64_t applied = 0;        // changes applied in place
+        uint64_t retiredPending = 0; // old generations not freed yet (held by in-flight calls, or queued)
+        double lastBuildSeconds = 0.0;
+    };
+
+    explicit GalleryManager(WorkerPool& pool = WorkerPool::shared());
+    ~GalleryManager();
+
+    // Set before serving starts; nullptr (the default) runs every call directly
+    void setAdmission(AdmissionController* controller) { admission = controller; }
+
+    // Build and swap in synchronously (call from any thread but the UI)
+    bool publish(const std::vector<GalleryEntry>& entries);
+    // Templates are copied before returning; the cache is built on the pool
+    void publishAsync(const std::vector<GalleryEntry>& entries, std::function<void(bool)> done = nullptr);
+
+    // Drop the live generation and wait until every generation, including any
+    // an in-flight call still holds, has been freed (call before ZKFPM_Terminate)
+    void shutdown();
+
+    // Mirrors a FingerprintDevice gallery (FingerprintDevice::addGalleryListener)
+    void onTemplateAdded(unsigned int fid, const unsigned char* tpl, unsigned int size) override;
+    void onTemplateRemoved(unsigned int fid) override;
+    void onGalleryCleared() override;
+
+    bool ready() const { return current() != nullptr; }
+    // Blocking; with admission control, not for use from inside the pool
+    bool identify(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score);
+    bool verify(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score);
+
+    Stats stats() const;
+    std::string getLastError() const;
+
+private:
+    struct Generation {
+        HANDLE cache = nullptr;
+        uint64_t id = 0;
+        std::vector<unsigned int> fids; // sorted; guarded by callMutex once published
+        std::mutex callMutex;           // the SDK does not document concurrent calls on one cache
+    };
+    using GenerationPtr = std::shared_ptr<Generation>;
+
+    // Counts generations from creation until their cache is freed
+    struct GenerationCount {
+        std::mutex mutex;
+        std::condition_variable none;
+        uint64_t alive = 0;
+    };
+
+    enum class ChangeKind { Add, Remove, Clear };
+    struct Change {
+        uint64_t seq;
+        ChangeKind kind;
+        unsigned int fid;
+        std::vector<unsigned char> tpl; // Add only
+    };
+
+    GenerationPtr current() const;
+    bool identifyLive(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score);
+    bool verifyLive(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score);
+    bool admitted(Admission admission, Lane lane);
+    uint64_t beginBuild();
+    bool build(const std::vector<GalleryEntry>& entries, uint64_t since);
+    void endBuild();
+    void change(ChangeKind kind, unsigned int fid, const unsigned char* tpl, unsigned int size);
+    bool apply(Generation& g, ChangeKind kind, unsigned int fid, const unsigned char* tpl, unsigned int size);
+    void setError(const std::string& error);
+
+    WorkerPool& pool;
+    AdmissionController* admission = nullptr;
+    mutable std::mutex swapMutex;     // guards live (held only to copy/replace the pointer)
+    GenerationPtr live;
+    std::atomic<uint64_t> nextId{ 1 };
+    std::atomic<uint64_t> published{ 0 };
+    std::atomic<uint64_t> applied{ 0 };
+    std::shared_ptr<GenerationCount> generations = std::make_shared<GenerationCount>();
+    std::atomic<uint64_t> lastBuildNanos{ 0 };
+    std::mutex buildMutex;            // one rebuild at a time
+    std::mutex changeMutex;           // orders in-place changes against swaps; guards the fields below
+    uint64_t changeSeq = 0;
+    int builders = 0;                 // publishes whose snapshot may miss journaled changes
+    std::vector<Change> journal;      // changes made while builders > 0
+    std::mutex asyncMutex;
+    std::condition_variable asyncIdle;
+    int asyncPending = 0;             // publishAsync jobs not finished yet
+    mutable std::mutex errorMutex;
+    std::string lastError;
+};
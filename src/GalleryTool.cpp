@@ -0,0 +1,893 @@
+#include "FingerprintDevice.h"
+#include "AdmissionController.h"
+#include "CascadeIdentifier.h"
+#include "DbHandlePool.h"
+#include "DuplicateDetector.h"
+#include "GalleryHygiene.h"
+#include "GalleryTransfer.h"
+#include "IdentityIndex.h"
+#include "MemoryAccounting.h"
+#include "TopKIdentifier.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Offline gallery jobs: bulk import/export between sites, duplicate audits,
+// quality hygiene and identify and memory benchmarks (top-K, DB-handle pool,
+// admission control, identity index, bytes per template, two-finger cascade).
+//
+//   gallery_tool --import <file> [--format jsonl|csv|bin] [--progress <file>]
+//                [--export <file> [--export-format jsonl|csv|bin]]
+//                [--dedupe <checkpoint>] [--topk-bench <probes> --identities <zkid>]
+//                [--pool-bench <callers>] [--admission-demo <seconds>]
+//                [--identity-bench <entries>] [--memory-bench <templates>]
+//                [--hygiene <min quality> [--identities <zkid>] [--quarantine <dump>]]
+//                [--cascade-bench <probes> --identities <zkid>] [--threads N]
+
+static void printUsage() {
+    std::printf("Usage: gallery_tool --import <file> [--format jsonl|csv|bin] [--progress <file>]\n"
+                "                    [--export <file>] [--export-format jsonl|csv|bin]\n"
+                "                    [--dedupe <checkpoint>] [--topk-bench <probes> --identities <zkid>]\n"
+                "                    [--pool-bench <callers>] [--admission-demo <seconds>]\n"
+                "                    [--identity-bench <entries>] [--memory-bench <templates>]\n"
+                "                    [--hygiene <min quality> [--identities <zkid>] [--quarantine <dump>]]\n"
+                "                    [--cascade-bench <probes> --identities <zkid>] [--threads N]\n");
+}
+
+// Latency of a full-gallery top-K scan against K and gallery size. One
+// impression of each finger that has two or more is held out of the gallery
+// and used as a probe, so a hit has to come from another impression of the
+// same finger rather than the probe's own template.
+static bool runTopKBench(TopKIdentifier& topk, const std::vector<GalleryEntry>& all, const IdentityIndex& identities,
+                         size_t probes) {
+    struct Probe {
+        GalleryEntry entry;
+        Identity id;
+    };
+    std::vector<Probe> held;
+    std::vector<GalleryEntry> gallery;
+    {
+        std::map<uint64_t, std::vector<size_t>> impressions; // personId << 8 | finger -> indices into all
+        for (size_t i = 0; i < all.size(); ++i) {
+            Identity id;
+            if (identities.find(all[i].fid, id) && id.finger != 0xFF)
+                impressions[(uint64_t)id.personId << 8 | id.finger].push_back(i);
+        }
+        std::vector<char> out(all.size(), 0);
+        for (const auto& [key, members] : impressions) {
+            if (members.size() < 2) continue;
+            size_t i = members.back();
+            out[i] = 1;
+            held.push_back({ all[i], Identity() });
+            identities.find(all[i].fid, held.back().id);
+        }
+        for (size_t i = 0; i < all.size(); ++i)
+            if (!out[i]) gallery.push_back(all[i]);
+    }
+    if (held.empty()) {
+        std::fprintf(stderr, "Top-K bench needs fingers with at least two impressions in the identity index.\n");
+        return false;
+    }
+    // Position in the gallery of each held-out finger's first remaining impression
+    std::map<uint64_t, size_t> firstMate;
+    for (size_t i = 0; i < gallery.size(); ++i) {
+        Identity id;
+        if (identities.find(gallery[i].fid, id) && id.finger != 0xFF)
+            firstMate.emplace((uint64_t)id.personId << 8 | id.finger, i);
+    }
+
+    std::vector<size_t> sizes;
+    for (size_t n = 1000; n < gallery.size(); n *= 10) sizes.push_back(n);
+    sizes.push_back(gallery.size());
+    probes = std::max<size_t>(1, probes);
+
+    std::printf("Top-K bench (up to %zu held-out probes per cell from %zu fingers, ms):\n", probes, held.size());
+    std::printf("  %10s %5s %8s %10s %10s %10s\n", "gallery", "K", "probes", "median", "p95", "hit@1");
+    for (size_t n : sizes) {
+        std::vector<GalleryEntry> prefix(gallery.begin(), gallery.begin() + n);
+        // Only probes with a genuine mate inside this prefix
+        std::vector<const Probe*> eligible;
+        for (const Probe& probe : held)
+            if (firstMate.at((uint64_t)probe.id.personId << 8 | probe.id.finger) < n) eligible.push_back(&probe);
+        if (eligible.empty()) continue;
+        size_t count = std::min(probes, eligible.size());
+        for (size_t k : { 1, 5, 10, 50 }) {
+            TopKOptions options;
+            options.k = k;
+            std::vector<double> ms;
+            size_t hits = 0;
+            std::vector<Candidate> candidates;
+            for (size_t p = 0; p < count; ++p) {
+                const Probe& probe = *eligible[(p * eligible.size()) / count];
+                auto t0 = std::chrono::steady_clock::now();
+                if (!topk.identify(prefix, probe.entry.data, probe.entry.size, options, candidates)) {
+                    std::fprintf(stderr, "Top-K failed: %s\n", topk.getLastError().c_str());
+                    return false;
+                }
+                ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+                Identity top;
+                if (!candidates.empty() && identities.find(candidates[0].fid, top) &&
+                    top.personId == probe.id.personId && top.finger == probe.id.finger)
+                    hits++;
+            }
+            std::sort(ms.begin(), ms.end());
+            std::printf("  %10zu %5zu %8zu %10.3f %10.3f %9.1f%%\n", n, k, count, ms[ms.size() / 2],
+                        ms[std::min(ms.size() - 1, ms.size() * 95 / 100)], 100.0 * hits / count);
+        }
+    }
+    return true;
+}
+
+// Identify throughput from plain threads: one shared DB cache behind a mutex
+// versus a DbHandlePool, with the gallery changing while the callers run.
+static bool runPoolBench(FingerprintDevice& fp, WorkerPool& pool, size_t callers) {
+    std::vector<GalleryEntry> gallery = fp.snapshotGallery();
+    callers = std::max<size_t>(1, callers);
+    const auto duration = std::chrono::seconds(2);
+
+    auto run = [&](const std::function<bool(const GalleryEntry&)>& identify, const std::function<void()>& mutate) {
+        std::atomic<bool> done{ false };
+        std::atomic<uint64_t> calls{ 0 }, misses{ 0 };
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < callers; ++t) {
+            threads.emplace_back([&, t] {
+                for (size_t i = t; !done.load(std::memory_order_relaxed); i += callers) {
+                    if (!identify(gallery[(i * 7919) % gallery.size()])) misses++;
+                    calls++;
+                }
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < duration) {
+            if (mutate) mutate();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        done = true;
+        for (auto& thread : threads) thread.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("  %.0f identify/s, %llu misses\n", calls.load() / seconds, (unsigned long long)misses.load());
+    };
+
+    // The same enrollment churn for both runs
+    unsigned int churnFid = 0;
+    auto churn = [&] {
+        if (churnFid && fp.removeTemplate(churnFid)) churnFid = 0;
+        else if (!churnFid) fp.enrollTemplate(gallery[0].data, gallery[0].size, churnFid);
+    };
+
+    std::printf("Pool bench (%zu caller threads, %zu templates, enrolling and removing a template every 50 ms):\n",
+                callers, gallery.size());
+    std::printf(" single DB cache + mutex:\n");
+    std::mutex cacheMutex;
+    run([&](const GalleryEntry& probe) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        unsigned int fid = 0, score = 0;
+        return fp.identifyTemplate(probe.data, probe.size, fid, score);
+    }, [&] {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        churn();
+    });
+    if (churnFid && fp.removeTemplate(churnFid)) churnFid = 0;
+
+    DbHandlePool handles(pool);
+    if (!handles.initialize(callers, gallery)) {
+        std::fprintf(stderr, "%s\n", handles.getLastError().c_str());
+        return false;
+    }
+    fp.addGalleryListener(&handles);
+    std::printf(" handle pool:\n");
+    run([&](const GalleryEntry& probe) {
+        unsigned int fid = 0, score = 0;
+        return handles.identify(probe.data, probe.size, fid, score);
+    }, churn);
+    if (churnFid) fp.removeTemplate(churnFid);
+    fp.removeGalleryListener(&handles);
+    std::printf("  %s\n", handles.stats().summary().c_str());
+    return true;
+}
+
+// Door latency while a dedupe-style bulk job saturates every DB handle: first
+// with the bulk job fanned straight out on the pool, then with both going
+// through the admission controller's lanes. Fails when the door p99 with
+// admission lanes under bulk load is more than AdmissionP99Factor times the
+// idle p99 plus AdmissionP99SlackMs (the slack covers one bulk slice already
+// running, and keeps sub-millisecond idle runs from failing on jitter).
+static const double AdmissionP99Factor = 3.0;
+static const double AdmissionP99SlackMs = 2.0;
+
+static bool runAdmissionDemo(FingerprintDevice& fp, WorkerPool& pool, double seconds) {
+    std::vector<GalleryEntry> gallery = fp.snapshotGallery();
+    DbHandlePool handles(pool);
+    if (!handles.initialize(pool.size(), gallery)) {
+        std::fprintf(stderr, "%s\n", handles.getLastError().c_str());
+        return false;
+    }
+    const size_t n = gallery.size();
+    auto bulkSlice = [&](size_t begin, size_t end) {
+        DbHandlePool::Lease lease = handles.checkout();
+        for (size_t i = begin; i < end; ++i)
+            for (size_t j = 1; j <= 64; ++j) {
+                const GalleryEntry& a = gallery[i % n];
+                const GalleryEntry& b = gallery[(i + j) % n];
+                ZKFPM_DBMatch(lease.get(), const_cast<unsigned char*>(a.data), a.size, const_cast<unsigned char*>(b.data), b.size);
+            }
+    };
+    const size_t bulkCount = 1u << 30; // stopped early; the job just needs to outlast the door traffic
+
+    // Returns the p99 in ms
+    auto door = [&](const char* label, const std::function<void(size_t)>& request, std::atomic<bool>& stop) {
+        std::vector<double> ms;
+        auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+        for (size_t i = 0; std::chrono::steady_clock::now() < end; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            request(i);
+            ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        stop = true;
+        std::sort(ms.begin(), ms.end());
+        auto at = [&](double p) { return ms[std::min(ms.size() - 1, (size_t)(p * ms.size()))]; };
+        std::printf("  %-24s %zu requests: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                    label, ms.size(), at(0.50), at(0.95), at(0.99), ms.back());
+        return at(0.99);
+    };
+    auto doorRequest = [&](size_t i) {
+        const GalleryEntry& probe = gallery[(i * 7919) % n];
+        if (i % 2) {
+            handles.match(probe.data, probe.size, probe.data, probe.size);
+        } else {
+            unsigned int fid = 0, score = 0;
+            handles.identify(probe.data, probe.size, fid, score);
+        }
+    };
+
+    std::printf("Admission demo (%zu DB handles, %.1f s per phase):\n", handles.size(), seconds);
+    double idleP99, admittedP99;
+    {
+        std::atomic<bool> stop{ false };
+        idleP99 = door("idle", doorRequest, stop);
+    }
+    {
+        std::atomic<bool> stop{ false };
+        std::thread bulk([&] {
+            pool.parallelFor(bulkCount, [&](size_t begin, size_t end) {
+                for (size_t b = begin; b < end && !stop; b += 64) bulkSlice(b, std::min(end, b + 64));
+            }, TaskPriority::Low, 64);
+        });
+        door("bulk, no admission", doorRequest, stop);
+        bulk.join();
+    }
+    {
+        AdmissionController admission(handles.size(), pool);
+        std::atomic<bool> stop{ false };
+        std::thread bulk([&] {
+            admission.runBulk(bulkCount, bulkSlice, 64, &stop);
+        });
+        admittedP99 = door("bulk, admission lanes", [&](size_t i) {
+            admission.run(i % 2 ? Lane::Verify : Lane::Identify, [&] { doorRequest(i); });
+        }, stop);
+        bulk.join();
+        std::printf("%s", admission.summary().c_str());
+    }
+    double bound = idleP99 * AdmissionP99Factor + AdmissionP99SlackMs;
+    if (admittedP99 > bound) {
+        std::fprintf(stderr, "Door p99 under bulk load with admission is %.2f ms, over the %.2f ms bound "
+                             "(%.0fx idle p99 + %.0f ms).\n", admittedP99, bound, AdmissionP99Factor, AdmissionP99SlackMs);
+        return false;
+    }
+    std::printf("  door p99 under bulk load %.2f ms, within %.2f ms (%.0fx idle p99 + %.0f ms)\n",
+                admittedP99, bound, AdmissionP99Factor, AdmissionP99SlackMs);
+    return true;
+}
+
+// FID -> identity resolution: the flat index against std::unordered_map at
+// `entries` synthetic identities, its save/load round trip, and the cost of
+// resolving real identify results from the imported gallery.
+static bool runIdentityBench(FingerprintDevice& fp, WorkerPool& pool, size_t entries) {
+    using Clock = std::chrono::steady_clock;
+    auto seconds = [](Clock::time_point since) { return std::chrono::duration<double>(Clock::now() - since).count(); };
+    auto synthetic = [](unsigned int fid) {
+        Identity id;
+        id.personId = fid / 10 + 1;
+        id.finger = (uint8_t)(fid % 10);
+        id.quality = (uint16_t)(fid % 101);
+        id.enrolledAt = 1700000000u + fid;
+        return id;
+    };
+
+    std::printf("Identity bench (%zu identities):\n", entries);
+    IdentityIndex index;
+    auto started = Clock::now();
+    for (size_t i = 0; i < entries; ++i) {
+        unsigned int fid = index.allocateFid();
+        index.put(fid, synthetic(fid));
+    }
+    std::printf("  insert: %.0f ns/identity (table grown from 16 slots)\n", seconds(started) * 1e9 / std::max<size_t>(1, entries));
+
+    std::unordered_map<unsigned int, Identity> baseline;
+    started = Clock::now();
+    for (unsigned int fid = 1; fid <= entries; ++fid) baseline.emplace(fid, synthetic(fid));
+    std::printf("  unordered_map insert: %.0f ns/identity\n", seconds(started) * 1e9 / std::max<size_t>(1, entries));
+
+    const size_t lookups = 4000000;
+    std::vector<unsigned int> probes(lookups);
+    uint32_t x = 2463534242u;
+    for (unsigned int& fid : probes) {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        fid = (unsigned int)(x % entries) + 1;
+    }
+    uint64_t checksum = 0;
+    started = Clock::now();
+    for (unsigned int fid : probes) {
+        Identity id;
+        if (index.find(fid, id)) checksum += id.personId;
+    }
+    double indexNs = seconds(started) * 1e9 / lookups;
+    started = Clock::now();
+    for (unsigned int fid : probes) {
+        auto it = baseline.find(fid);
+        if (it != baseline.end()) checksum -= it->second.personId;
+    }
+    double mapNs = seconds(started) * 1e9 / lookups;
+    std::printf("  lookup, 1 thread: %.1f ns (unordered_map %.1f ns)%s\n", indexNs, mapNs,
+                checksum == 0 ? "" : " [MISMATCH]");
+
+    // Every worker reads while this thread keeps erasing and re-adding identities
+    std::atomic<bool> stop{ false };
+    std::thread writer([&] {
+        for (unsigned int fid = 1; !stop.load(std::memory_order_relaxed); fid = fid % entries + 1) {
+            index.erase(fid);
+            index.put(fid, synthetic(fid));
+        }
+    });
+    std::atomic<uint64_t> found{ 0 };
+    started = Clock::now();
+    pool.parallelFor(lookups, [&](size_t begin, size_t end) {
+        uint64_t hits = 0;
+        for (size_t i = begin; i < end; ++i) {
+            Identity id;
+            hits += index.find(probes[i], id);
+        }
+        found += hits;
+    }, TaskPriority::Normal, 65536);
+    double parallelSeconds = seconds(started);
+    stop = true;
+    writer.join();
+    std::printf("  lookup, %zu workers with a concurrent writer: %.0f M/s (%llu of %zu found)\n", pool.size(),
+                lookups / parallelSeconds / 1e6, (unsigned long long)found.load(), lookups);
+
+    // Freed FIDs come back lowest first
+    for (unsigned int fid = 100; fid < 110 && fid <= entries; ++fid) {
+        index.erase(fid);
+        index.releaseFid(fid);
+    }
+    std::printf("  after releasing 100-109, next FID %u\n", index.allocateFid());
+
+    std::error_code error;
+    std::string path = (std::filesystem::temp_directory_path(error) / "gallery_tool_identities.zkid").string();
+    started = Clock::now();
+    if (!index.save(path)) {
+        std::fprintf(stderr, "%s\n", index.getLastError().c_str());
+        return false;
+    }
+    double saveSeconds = seconds(started);
+    IdentityIndex reloaded;
+    started = Clock::now();
+    if (!reloaded.load(path)) {
+        std::fprintf(stderr, "%s\n", reloaded.getLastError().c_str());
+        return false;
+    }
+    double loadSeconds = seconds(started);
+    std::filesystem::remove(path, error);
+    Identity a, b;
+    bool same = reloaded.size() == index.size() && reloaded.find(1, a) && index.find(1, b) && a.personId == b.personId;
+    std::printf("  save %.1f ms, load %.1f ms, %zu identities%s\n", saveSeconds * 1e3, loadSeconds * 1e3,
+                reloaded.size(), same ? "" : " [MISMATCH]");
+    std::printf("  %s\n", index.stats().summary().c_str());
+
+    // Identify against the imported gallery, then resolve the FID
+    std::vector<GalleryEntry> gallery = fp.snapshotGallery();
+    IdentityIndex people(gallery.size());
+    for (const GalleryEntry& e : gallery) people.put(e.fid, synthetic(e.fid));
+    size_t resolved = 0, calls = std::min<size_t>(gallery.size(), 200);
+    double identifySeconds = 0.0, resolveSeconds = 0.0;
+    for (size_t i = 0; i < calls; ++i) {
+        const GalleryEntry& probe = gallery[(i * 7919) % gallery.size()];
+        unsigned int fid = 0, score = 0;
+        started = Clock::now();
+        bool hit = fp.identifyTemplate(probe.data, probe.size, fid, score);
+        identifySeconds += seconds(started);
+        started = Clock::now();
+        Identity id;
+        if (hit && people.find(fid, id)) ++resolved;
+        resolveSeconds += seconds(started);
+    }
+    if (calls)
+        std::printf("  identify %.1f us + resolve %.0f ns per call, %zu/%zu resolved\n", identifySeconds * 1e6 / calls,
+                    resolveSeconds * 1e9 / calls, resolved, calls);
+    return true;
+}
+
+// Memory per enrolled template at 10k, 100k and 1M templates (up to `limit`).
+// The gallery is refilled with copies of the imported templates, each stamped
+// with its index in its last four bytes so the arena cannot intern them; the
+// imported gallery is restored afterwards. "untracked" is private-byte growth
+// that neither the tags nor the calibrated SDK estimate explain.
+static bool runMemoryBench(FingerprintDevice& fp, size_t limit) {
+    std::vector<std::pair<unsigned int, std::vector<unsigned char>>> saved;
+    std::vector<GalleryEntry> gallery = fp.snapshotGallery();
+    for (const GalleryEntry& e : gallery) saved.emplace_back(e.fid, std::vector<unsigned char>(e.data, e.data + e.size));
+    if (gallery.size() > 2000) gallery.resize(2000);
+    double sdkPerTemplate = MemoryAccounting::calibrateSdkCache(gallery);
+    gallery.clear();
+
+    std::vector<size_t> sizes;
+    for (size_t n = 10000; n <= limit && n <= 1000000; n *= 10) sizes.push_back(n);
+    if (sizes.empty()) sizes.push_back(limit);
+
+    fp.clearFingerprints();
+    MemorySnapshot base = MemoryAccounting::snapshot();
+    std::printf("Memory bench (SDK calibrated at %.0f bytes/template):\n", sdkPerTemplate);
+    std::printf("  %10s %14s %14s %14s %14s %12s\n", "templates", "gallery B/tpl", "sdk est B/tpl", "untracked B/tpl",
+                "private B/tpl", "private MB");
+    std::vector<unsigned char> tpl;
+    size_t failed = 0;
+    for (size_t n : sizes) {
+        for (size_t i = fp.getEnrolledCount() + failed; i < n; ++i) {
+            tpl = saved[i % saved.size()].second;
+            if (tpl.size() >= 8) std::memcpy(tpl.data() + tpl.size() - 4, &i, 4);
+            if (!fp.enrollTemplateAs((unsigned int)i + 1, tpl.data(), (unsigned int)tpl.size())) failed++;
+        }
+        MemorySnapshot now = MemoryAccounting::snapshot();
+        double count = (double)std::max<size_t>(1, fp.getEnrolledCount());
+        double gallery = ((double)now[MemoryTag::Gallery].bytes - base[MemoryTag::Gallery].bytes) / count;
+        double sdk = ((double)now[MemoryTag::SdkCache].bytes - base[MemoryTag::SdkCache].bytes) / count;
+        double privateGrowth = ((double)now.processPrivateBytes - base.processPrivateBytes) / count;
+        double untracked = ((double)now.untrackedBytes() - base.untrackedBytes()) / count;
+        std::printf("  %10zu %14.0f %14.0f %14.0f %14.0f %12.1f\n", fp.getEnrolledCount(), gallery, sdk, untracked,
+                    privateGrowth, now.processPrivateBytes / 1048576.0);
+    }
+    if (failed) std::printf("  %zu templates rejected by the SDK\n", failed);
+    std::printf("%s", MemoryAccounting::snapshot().summary().c_str());
+
+    fp.clearFingerprints();
+    for (const auto& [fid, bytes] : saved) fp.enrollTemplateAs(fid, bytes.data(), (unsigned int)bytes.size());
+    return true;
+}
+
+// Quality hygiene: scores the gallery, flags low-quality and (with an identity
+// index) redundant templates, and with a quarantine path moves them out of the
+// gallery and times identify before and after on the same probes.
+static bool runHygiene(FingerprintDevice& fp, WorkerPool& pool, int minQuality, const std::string& identitiesPath,
+                       const std::string& quarantinePath) {
+    IdentityIndex identities;
+    GalleryHygiene hygiene(pool);
+    if (!hygiene.initialize()) {
+        std::fprintf(stderr, "%s\n", hygiene.getLastError().c_str());
+        return false;
+    }
+    hygiene.setMinQuality(minQuality);
+    if (!fp.getHandle() && !fp.openDevice()) {
+        std::fprintf(stderr, "Quality scoring needs the sensor: %s\n", fp.getLastError().c_str());
+        return false;
+    }
+    hygiene.setDeviceHandle(fp.getHandle());
+    if (!identitiesPath.empty()) {
+        if (!identities.load(identitiesPath)) {
+            std::fprintf(stderr, "%s\n", identities.getLastError().c_str());
+            return false;
+        }
+        hygiene.setIdentityIndex(&identities);
+    }
+
+    HygieneReport report;
+    if (!hygiene.scan(fp.snapshotGallery(), report)) {
+        std::fprintf(stderr, "%s\n", hygiene.getLastError().c_str());
+        return false;
+    }
+    std::printf("Hygiene (min quality %d%s):\n", minQuality, identitiesPath.empty() ? ", no identity index" : "");
+    std::printf("  quality before:\n%s", report.quality.render().c_str());
+    std::printf("  quality after%s:\n%s", quarantinePath.empty() ? " (projected)" : "", report.keptQuality.render().c_str());
+    size_t listed = 0;
+    for (const HygieneFlag& f : report.flags) {
+        if (++listed > 20) {
+            std::printf("  ... %zu more\n", report.flags.size() - 20);
+            break;
+        }
+        if (f.reason == HygieneReason::Redundant)
+            std::printf("  fid %u: quality %d, redundant with fid %u\n", f.fid, f.quality, f.coveredBy);
+        else
+            std::printf("  fid %u: quality %d%s\n", f.fid, f.quality, f.reenroll ? ", only template for the finger: re-enroll" : "");
+    }
+
+    if (!quarantinePath.empty()) {
+        // Probes are templates that stay, so both timings search for the same hits
+        std::vector<std::vector<unsigned char>> probes;
+        size_t flagged = 0;
+        for (const GalleryEntry& e : fp.snapshotGallery()) {
+            while (flagged < report.flags.size() && report.flags[flagged].fid < e.fid) flagged++;
+            bool leaving = flagged < report.flags.size() && report.flags[flagged].fid == e.fid && !report.flags[flagged].reenroll;
+            if (!leaving && probes.size() < 200) probes.emplace_back(e.data, e.data + e.size);
+        }
+        auto identifyMs = [&] {
+            auto started = std::chrono::steady_clock::now();
+            for (const auto& probe : probes) {
+                unsigned int fid = 0, score = 0;
+                fp.identifyTemplate(probe.data(), (unsigned int)probe.size(), fid, score);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+            return probes.empty() ? 0.0 : ms / probes.size();
+        };
+        size_t before = fp.getEnrolledCount();
+        double msBefore = identifyMs();
+        if (!hygiene.quarantine(fp, report, quarantinePath, guessGalleryFormat(quarantinePath))) {
+            std::fprintf(stderr, "Quarantine failed: %s\n", hygiene.getLastError().c_str());
+            return false;
+        }
+        double msAfter = identifyMs();
+        std::printf("  gallery %zu -> %zu templates (quarantined to %s)\n", before, fp.getEnrolledCount(), quarantinePath.c_str());
+        std::printf("  identify %.3f -> %.3f ms/probe (%.2fx)\n", msBefore, msAfter, msAfter > 0.0 ? msBefore / msAfter : 0.0);
+    }
+    std::printf("  %s\n", report.summary().c_str());
+    return true;
+}
+
+// A look-alike the first finger cannot tell apart: the probe's person plus a
+// made-up person who has the same first-finger templates (copied under new
+// FIDs) and someone else's template as a different finger. The first finger
+// ties, so the cascade must capture the second finger and let it decide.
+static bool checkCascadeLookAlike(CascadeIdentifier& cascade, const std::vector<GalleryEntry>& gallery,
+                                  const IdentityIndex& identities, uint32_t person, uint8_t firstFinger,
+                                  const std::vector<unsigned char>& first, const std::vector<unsigned char>& second) {
+    std::vector<GalleryEntry> entries;
+    IdentityIndex lookAlikes;
+    unsigned int nextFid = 1;
+    uint32_t twin = 1;
+    for (const GalleryEntry& e : gallery) {
+        Identity id;
+        if (!identities.find(e.fid, id)) continue;
+        nextFid = std::max(nextFid, e.fid + 1);
+        twin = std::max(twin, id.personId + 1);
+    }
+    const GalleryEntry* stranger = nullptr;
+    for (const GalleryEntry& e : gallery) {
+        Identity id;
+        if (!identities.find(e.fid, id)) continue;
+        if (id.personId == person) {
+            entries.push_back(e);
+            lookAlikes.put(e.fid, id);
+            if (id.finger != firstFinger) continue;
+            Identity copy = id;
+            copy.personId = twin;
+            entries.push_back({ nextFid, e.data, e.size });
+            lookAlikes.put(nextFid++, copy);
+        } else if (!stranger && id.finger != 0xFF) {
+            stranger = &e;
+        }
+    }
+    if (!stranger) {
+        std::fprintf(stderr, "Look-alike check needs a second enrolled person.\n");
+        return false;
+    }
+    Identity strangerAsTwin{ twin, (uint8_t)((firstFinger + 1) % 10), 0, 0, 0 };
+    entries.push_back({ nextFid, stranger->data, stranger->size });
+    lookAlikes.put(nextFid, strangerAsTwin);
+
+    cascade.setGallery(entries, lookAlikes);
+    bool passed = true;
+    for (int stage = 0; stage < 2; ++stage) {
+        CascadeOptions options;
+        options.firstStage = stage == 0 ? CascadeFirstStage::Identify : CascadeFirstStage::TopK;
+        cascade.setOptions(options);
+        CascadeResult result;
+        auto captureSecond = [&](std::vector<unsigned char>& tpl) {
+            tpl = second;
+            return true;
+        };
+        if (!cascade.identify(first.data(), (unsigned int)first.size(), captureSecond, result)) {
+            std::fprintf(stderr, "Cascade failed: %s\n", cascade.getLastError().c_str());
+            return false;
+        }
+        bool ok = result.candidates >= 2 && result.secondCaptured && result.identified && result.personId == person;
+        std::printf("  look-alike, %-12s %s (candidates %zu, 2nd finger %s, person %u, fused %d)\n",
+                    stage == 0 ? "identify:" : "top-K scan:", ok ? "ok" : "FAILED", result.candidates,
+                    result.secondCaptured ? "captured" : "not captured", result.personId, result.fusedScore);
+        passed = passed && ok;
+    }
+    return passed;
+}
+
+// Two-finger identification three ways: two full DBIdentify calls that must
+// agree, and the cascade with a DBIdentify and with a top-K first stage. The
+// probes are held-out impressions: for persons enrolled with at least two
+// impressions of each of two different fingers, one impression of each finger
+// is taken out of the gallery for the run and put back afterwards. Fails when
+// the cascade gets the look-alike check wrong.
+static bool runCascadeBench(FingerprintDevice& fp, WorkerPool& pool, const std::string& identitiesPath, size_t probes) {
+    IdentityIndex identities;
+    if (!identities.load(identitiesPath)) {
+        std::fprintf(stderr, "%s\n", identities.getLastError().c_str());
+        return false;
+    }
+    struct Probe {
+        uint32_t person;
+        unsigned int fid[2];
+        std::vector<unsigned char> tpl[2];
+    };
+    std::vector<Probe> held;
+    {
+        std::map<uint32_t, std::map<uint8_t, std::vector<GalleryEntry>>> fingersOf; // person -> finger -> impressions
+        for (const GalleryEntry& e : fp.snapshotGallery()) {
+            Identity id;
+            if (identities.find(e.fid, id) && id.finger != 0xFF) fingersOf[id.personId][id.finger].push_back(e);
+        }
+        for (const auto& [person, fingers] : fingersOf) {
+            if (held.size() >= std::max<size_t>(1, probes)) break;
+            Probe probe{ person, { 0, 0 }, {} };
+            int taken = 0;
+            for (const auto& [finger, impressions] : fingers) {
+                if (impressions.size() < 2) continue;
+                const GalleryEntry& e = impressions.back();
+                probe.fid[taken] = e.fid;
+                probe.tpl[taken].assign(e.data, e.data + e.size);
+                if (++taken == 2) break;
+            }
+            if (taken == 2) held.push_back(std::move(probe));
+        }
+    }
+    if (held.empty()) {
+        std::fprintf(stderr, "Cascade bench needs persons with two impressions of each of two fingers.\n");
+        return false;
+    }
+    for (const Probe& probe : held) {
+        Identity first, second;
+        if (!identities.find(probe.fid[0], first) || !identities.find(probe.fid[1], second) || first.finger == second.finger) {
+            std::fprintf(stderr, "Probes for person %u are not two different fingers.\n", probe.person);
+            return false;
+        }
+        fp.removeTemplate(probe.fid[0]);
+        fp.removeTemplate(probe.fid[1]);
+    }
+    auto restore = [&]() {
+        for (const Probe& probe : held)
+            for (int f = 0; f < 2; ++f)
+                fp.enrollTemplateAs(probe.fid[f], probe.tpl[f].data(), (unsigned int)probe.tpl[f].size());
+    };
+
+    std::vector<GalleryEntry> gallery = fp.snapshotGallery();
+    CascadeIdentifier cascade(pool);
+    if (!cascade.initialize()) {
+        std::fprintf(stderr, "%s\n", cascade.getLastError().c_str());
+        restore();
+        return false;
+    }
+    cascade.setGallery(gallery, identities);
+
+    std::printf("Cascade bench (%zu probes from %zu held-out persons, %zu templates):\n", probes, held.size(), gallery.size());
+    std::printf("  %-24s %10s %10s %9s %9s %9s %12s\n", "method", "mean ms", "p95 ms", "correct", "wrong", "no id",
+                "2nd capture");
+    for (int method = 0; method < 3; ++method) {
+        CascadeOptions options;
+        options.firstStage = method == 2 ? CascadeFirstStage::TopK : CascadeFirstStage::Identify;
+        cascade.setOptions(options);
+        std::vector<double> ms;
+        size_t correct = 0, wrong = 0, none = 0, captures = 0;
+        for (size_t p = 0; p < probes; ++p) {
+            const Probe& probe = held[p % held.size()];
+            const std::vector<unsigned char>& first = probe.tpl[0];
+            const std::vector<unsigned char>& second = probe.tpl[1];
+            bool identified = false;
+            uint32_t found = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            if (method == 0) {
+                unsigned int fid1 = 0, fid2 = 0, score = 0;
+                Identity id1, id2;
+                bool hit1 = fp.identifyTemplate(first.data(), (unsigned int)first.size(), fid1, score);
+                bool hit2 = fp.identifyTemplate(second.data(), (unsigned int)second.size(), fid2, score);
+                captures++;
+                if (hit1 && hit2 && identities.find(fid1, id1) && identities.find(fid2, id2) && id1.personId == id2.personId) {
+                    identified = true;
+                    found = id1.personId;
+                }
+            } else {
+                CascadeResult result;
+                auto captureSecond = [&](std::vector<unsigned char>& tpl) {
+                    tpl = second;
+                    return true;
+                };
+                if (!cascade.identify(first.data(), (unsigned int)first.size(), captureSecond, result)) {
+                    std::fprintf(stderr, "Cascade failed: %s\n", cascade.getLastError().c_str());
+                    restore();
+                    return false;
+                }
+                captures += result.secondCaptured;
+                identified = result.identified;
+                found = result.personId;
+            }
+            ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+            if (!identified) none++;
+            else if (found == probe.person) correct++;
+            else wrong++;
+        }
+        double mean = 0.0;
+        for (double v : ms) mean += v;
+        std::sort(ms.begin(), ms.end());
+        static const char* names[] = { "two full identifies", "cascade, identify", "cascade, top-K scan" };
+        std::printf("  %-24s %10.3f %10.3f %9zu %9zu %9zu %11.1f%%\n", names[method], mean / ms.size(),
+                    ms[std::min(ms.size() - 1, ms.size() * 95 / 100)], correct, wrong, none, 100.0 * captures / probes);
+    }
+    Identity firstFinger;
+    identities.find(held[0].fid[0], firstFinger);
+    bool passed = checkCascadeLookAlike(cascade, gallery, identities, held[0].person, firstFinger.finger, held[0].tpl[0],
+                                        held[0].tpl[1]);
+    restore();
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    std::string importPath, exportPath, progressPath, dedupePath;
+    std::string importFormat, exportFormat;
+    size_t threads = 0;
+    size_t topkProbes = 0;
+    size_t poolCallers = 0;
+    double admissionSeconds = 0.0;
+    size_t identityEntries = 0;
+    size_t memoryTemplates = 0;
+    int hygieneQuality = -1;
+    size_t cascadeProbes = 0;
+    std::string identitiesPath, quarantinePath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--import") importPath = next();
+        else if (arg == "--format") importFormat = next();
+        else if (arg == "--progress") progressPath = next();
+        else if (arg == "--export") exportPath = next();
+        else if (arg == "--export-format") exportFormat = next();
+        else if (arg == "--dedupe") dedupePath = next();
+        else if (arg == "--topk-bench") topkProbes = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--pool-bench") poolCallers = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--admission-demo") admissionSeconds = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--identity-bench") identityEntries = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--memory-bench") memoryTemplates = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--hygiene") hygieneQuality = std::atoi(next().c_str());
+        else if (arg == "--cascade-bench") cascadeProbes = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--identities") identitiesPath = next();
+        else if (arg == "--quarantine") quarantinePath = next();
+        else if (arg == "--threads") threads = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (importPath.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    WorkerPool& pool = WorkerPool::shared(threads);
+
+    FingerprintDevice fp;
+    if (!fp.initialize()) {
+        std::fprintf(stderr, "%s\n", fp.getLastError().c_str());
+        return 1;
+    }
+
+    GalleryFormat format = guessGalleryFormat(importPath);
+    if (!importFormat.empty() && !parseGalleryFormat(importFormat, format)) {
+        std::fprintf(stderr, "Unknown format: %s\n", importFormat.c_str());
+        return 1;
+    }
+
+    GalleryImporter importer(fp, pool);
+    TransferStats importStats;
+    if (!importer.run(importPath, format, progressPath, importStats)) {
+        std::fprintf(stderr, "Import failed: %s\n", importer.getLastError().c_str());
+        return 1;
+    }
+    std::printf("Import: %s\n", importStats.summary().c_str());
+
+    if (!dedupePath.empty()) {
+        DuplicateDetector dedupe(pool);
+        if (!dedupe.initialize()) {
+            std::fprintf(stderr, "%s\n", dedupe.getLastError().c_str());
+            return 1;
+        }
+        std::vector<DuplicateCluster> clusters;
+        if (!dedupe.audit(fp.snapshotGallery(), dedupePath, clusters)) {
+            std::fprintf(stderr, "Dedupe failed: %s\n", dedupe.getLastError().c_str());
+            return 1;
+        }
+        std::printf("Dedupe: %zu duplicate clusters\n", clusters.size());
+        for (const auto& c : clusters) {
+            std::printf("  cluster:");
+            for (unsigned int fid : c.fids) std::printf(" %u", fid);
+            std::printf("\n");
+        }
+    }
+
+    if (topkProbes > 0) {
+        TopKIdentifier topk(pool);
+        if (!topk.initialize()) {
+            std::fprintf(stderr, "%s\n", topk.getLastError().c_str());
+            return 1;
+        }
+        if (identitiesPath.empty()) {
+            std::fprintf(stderr, "Top-K bench needs --identities to hold out probe impressions.\n");
+            return 1;
+        }
+        IdentityIndex identities;
+        if (!identities.load(identitiesPath)) {
+            std::fprintf(stderr, "%s\n", identities.getLastError().c_str());
+            return 1;
+        }
+        if (!runTopKBench(topk, fp.snapshotGallery(), identities, topkProbes)) return 1;
+    }
+
+    if (poolCallers > 0) {
+        if (fp.getEnrolledCount() == 0) {
+            std::fprintf(stderr, "Pool bench needs a non-empty gallery.\n");
+            return 1;
+        }
+        if (!runPoolBench(fp, pool, poolCallers)) return 1;
+    }
+
+    if (admissionSeconds > 0.0) {
+        if (fp.getEnrolledCount() == 0) {
+            std::fprintf(stderr, "Admission demo needs a non-empty gallery.\n");
+            return 1;
+        }
+        if (!runAdmissionDemo(fp, pool, admissionSeconds)) return 1;
+    }
+
+    if (identityEntries > 0 && !runIdentityBench(fp, pool, identityEntries)) return 1;
+
+    if (memoryTemplates > 0) {
+        if (fp.getEnrolledCount() == 0) {
+            std::fprintf(stderr, "Memory bench needs a non-empty gallery.\n");
+            return 1;
+        }
+        if (!runMemoryBench(fp, memoryTemplates)) return 1;
+    }
+
+    if (hygieneQuality >= 0 && !runHygiene(fp, pool, hygieneQuality, identitiesPath, quarantinePath)) return 1;
+
+    if (cascadeProbes > 0) {
+        if (identitiesPath.empty()) {
+            std::fprintf(stderr, "Cascade bench needs --identities.\n");
+            return 1;
+        }
+        if (!runCascadeBench(fp, pool, identitiesPath, cascadeProbes)) return 1;
+    }
+
+    if (!exportPath.empty()) {
+        GalleryFormat outFormat = guessGalleryFormat(exportPath);
+        if (!exportFormat.empty() && !parseGalleryFormat(exportFormat, outFormat)) {
+            std::fprintf(stderr, "Unknown format: %s\n", exportFormat.c_str());
+            return 1;
+        }
+        GalleryExporter exporter(fp, pool);
+        TransferStats exportStats;
+        if (!exporter.run(exportPath, outFormat, exportStats)) {
+            std::fprintf(stderr, "Export failed: %s\n", exporter.getLastError().c_str());
+            return 1;
+        }
+        std::printf("Export: %s\n", exportStats.summary().c_str());
+    }
+
+    std::printf("Scheduler:\n%s", pool.statsSummary().c_str());
+    fp.terminate();
+    return 0;
+}
@@ -0,0 +1,356 @@
+#include "GalleryTransfer.h"
+#include "Base64.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+constexpr size_t kReadChunk = 8 * 1024 * 1024;
+constexpr char kBinaryMagic[4] = { 'Z', 'K', 'G', 'B' };
+constexpr uint32_t kBinaryVersion = 1;
+
+int seekTo(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (long long)offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+// Minimal field lookup for our own JSONL lines: "fid": 123, "template": "..."
+bool parseJsonLine(const char* line, size_t length, unsigned int& fid, const char*& tpl, size_t& tplLength) {
+    std::string_view view(line, length);
+    size_t k = view.find("\"fid\"");
+    if (k == std::string_view::npos) return false;
+    k = view.find(':', k);
+    if (k == std::string_view::npos) return false;
+    fid = (unsigned int)std::strtoul(line + k + 1, nullptr, 10);
+
+    k = view.find("\"template\"");
+    if (k == std::string_view::npos) return false;
+    k = view.find('"', view.find(':', k));
+    if (k == std::string_view::npos) return false;
+    size_t end = view.find('"', k + 1);
+    if (end == std::string_view::npos) return false;
+    tpl = line + k + 1;
+    tplLength = end - k - 1;
+    return true;
+}
+
+bool parseCsvLine(const char* line, size_t length, unsigned int& fid, const char*& tpl, size_t& tplLength) {
+    const char* comma = (const char*)std::memchr(line, ',', length);
+    if (!comma || comma == line || *line < '0' || *line > '9') return false; // header or junk
+    fid = (unsigned int)std::strtoul(line, nullptr, 10);
+    tpl = comma + 1;
+    tplLength = length - (comma + 1 - line);
+    while (tplLength && (tpl[tplLength - 1] == '\r' || tpl[tplLength - 1] == '"')) tplLength--;
+    if (tplLength && *tpl == '"') { tpl++; tplLength--; }
+    return true;
+}
+
+// Which dump a progress file belongs to: size, modification time and a hash
+// of the first bytes. A saved offset is only meaningful in the same file.
+struct SourceIdentity {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t headHash = 0;
+
+    bool operator==(const SourceIdentity& other) const {
+        return size == other.size && mtime == other.mtime && headHash == other.headHash;
+    }
+};
+
+constexpr size_t kIdentityHashBytes = 64 * 1024;
+
+SourceIdentity sourceIdentity(const std::string& path, FILE* f) {
+    SourceIdentity id;
+    std::error_code error;
+    id.size = (uint64_t)std::filesystem::file_size(path, error);
+    if (error) id.size = 0;
+    auto written = std::filesystem::last_write_time(path, error);
+    if (!error) id.mtime = (int64_t)written.time_since_epoch().count();
+    // FNV-1a, read through the caller's handle and rewound afterwards
+    std::vector<unsigned char> head(kIdentityHashBytes);
+    size_t got = std::fread(head.data(), 1, head.size(), f);
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < got; ++i) hash = (hash ^ head[i]) * 1099511628211ull;
+    id.headHash = hash;
+    seekTo(f, 0);
+    return id;
+}
+
+bool writeProgress(const std::string& path, uint64_t offset, uint64_t records, const SourceIdentity& source) {
+    std::ofstream out(path, std::ios::trunc);
+    out << offset << " " << records << " " << source.size << " " << source.mtime << " " << source.headHash << "\n";
+    return (bool)out;
+}
+
+// False for a missing or unreadable file, and for one written before the source identity was saved
+bool readProgress(const std::string& path, uint64_t& offset, uint64_t& records, SourceIdentity& source) {
+    std::ifstream in(path);
+    return (bool)(in >> offset >> records >> source.size >> source.mtime >> source.headHash);
+}
+
+} // namespace
+
+bool parseGalleryFormat(const std::string& name, GalleryFormat& format) {
+    if (name == "jsonl" || name == "json") format = GalleryFormat::Jsonl;
+    else if (name == "csv") format = GalleryFormat::Csv;
+    else if (name == "bin" || name == "binary") format = GalleryFormat::Binary;
+    else return false;
+    return true;
+}
+
+GalleryFormat guessGalleryFormat(const std::string& path) {
+    auto endsWith = [&](const char* ext) {
+        size_t n = std::strlen(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (endsWith(".csv")) return GalleryFormat::Csv;
+    if (endsWith(".bin") || endsWith(".zkgb")) return GalleryFormat::Binary;
+    return GalleryFormat::Jsonl;
+}
+
+std::string TransferStats::summary() const {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "%llu records (%llu imported, %llu skipped, %llu failed), %.1f MB in %.2f s: %.0f templates/sec",
+                  (unsigned long long)records, (unsigned long long)imported, (unsigned long long)skipped,
+                  (unsigned long long)failed, bytes / (1024.0 * 1024.0), seconds, templatesPerSecond());
+    return buf;
+}
+
+// ===== Import =====
+
+GalleryImporter::GalleryImporter(FingerprintDevice& device, WorkerPool& pool, size_t batchSize)
+    : device(device), pool(pool), batchSize(batchSize ? batchSize : 1) {}
+
+void GalleryImporter::decodeBatch(std::vector<PendingRecord>& batch, bool raw) {
+    pool.parallelFor(batch.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            PendingRecord& r = batch[i];
+            if (raw) {
+                r.blob.assign((const unsigned char*)r.text, (const unsigned char*)r.text + r.length);
+                r.ok = true;
+            } else {
+                r.ok = base64::decode(r.text, r.length, r.blob);
+            }
+            r.ok = r.ok && !r.blob.empty() && r.blob.size() <= MAX_TEMPLATE_SIZE;
+        }
+    }, TaskPriority::Low, 64);
+}
+
+// DB cache inserts stay on the calling thread: the SDK handle is not shared
+void GalleryImporter::commitBatch(std::vector<PendingRecord>& batch, TransferStats& stats) {
+    for (auto& r : batch) {
+        stats.records++;
+        if (!r.ok) stats.failed++;
+        else if (device.isEnrolled(r.fid)) stats.skipped++;
+        else if (device.enrollTemplateAs(r.fid, r.blob.data(), (unsigned int)r.blob.size())) stats.imported++;
+        else stats.failed++;
+    }
+    batch.clear();
+}
+
+bool GalleryImporter::run(const std::string& path, GalleryFormat format, const std::string& progressPath,
+                          TransferStats& stats) {
+    auto started = std::chrono::steady_clock::now();
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        lastError = "Cannot open gallery file: " + path;
+        return false;
+    }
+    std::setvbuf(f, nullptr, _IONBF, 0); // we already read in large chunks
+    SourceIdentity source;
+    if (!progressPath.empty()) source = sourceIdentity(path, f);
+    std::error_code sizeError;
+    stats.totalBytes = (uint64_t)std::filesystem::file_size(path, sizeError);
+    if (sizeError) stats.totalBytes = 0;
+
+    const bool binary = format == GalleryFormat::Binary;
+    uint64_t offset = 0;
+    if (binary) {
+        char magic[4];
+        uint32_t version = 0;
+        if (std::fread(magic, 1, 4, f) != 4 || std::memcmp(magic, kBinaryMagic, 4) != 0 ||
+            std::fread(&version, 4, 1, f) != 1 || version != kBinaryVersion) {
+            std::fclose(f);
+            lastError = "Not a binary gallery dump: " + path;
+            return false;
+        }
+        offset = 8;
+    }
+
+    // Progress saved for a different (or since modified) dump is ignored and
+    // the import starts over; records already enrolled are skipped
+    uint64_t resumeRecords = 0, resumeOffset = 0;
+    SourceIdentity saved;
+    if (!progressPath.empty() && readProgress(progressPath, resumeOffset, resumeRecords, saved) && saved == source &&
+        resumeOffset > offset) {
+        offset = resumeOffset;
+        if (seekTo(f, offset) != 0) {
+            std::fclose(f);
+            lastError = "Cannot seek to saved progress offset.";
+            return false;
+        }
+    }
+
+    std::vector<char> window;        // carried-over partial record + the latest chunk
+    std::vector<PendingRecord> batch;
+    batch.reserve(batchSize);
+    uint64_t windowOffset = offset;  // file offset of window[0]
+    uint64_t totalRecords = resumeRecords;
+    bool eof = false;
+
+    auto flush = [&](uint64_t committedOffset) {
+        if (batch.empty()) return;
+        decodeBatch(batch, binary);
+        totalRecords += batch.size();
+        if (commitMutex) {
+            std::lock_guard<std::mutex> lock(*commitMutex);
+            commitBatch(batch, stats);
+        } else {
+            commitBatch(batch, stats);
+        }
+        stats.position = committedOffset;
+        if (!progressPath.empty()) writeProgress(progressPath, committedOffset, totalRecords, source);
+        if (onProgress) onProgress(stats);
+    };
+
+    while (!eof) {
+        size_t carry = window.size();
+        window.resize(carry + kReadChunk);
+        size_t got = std::fread(window.data() + carry, 1, kReadChunk, f);
+        window.resize(carry + got);
+        stats.bytes += got;
+        eof = got < kReadChunk;
+
+        size_t pos = 0;
+        while (pos < window.size()) {
+            const char* base = window.data() + pos;
+            size_t avail = window.size() - pos;
+            size_t consumed = 0;
+            PendingRecord r{ 0, nullptr, 0, {}, false };
+            bool have = false;
+
+            if (binary) {
+                if (avail < 8) break;
+                uint32_t fid, size;
+                std::memcpy(&fid, base, 4);
+                std::memcpy(&size, base + 4, 4);
+                if (size == 0 || size > MAX_TEMPLATE_SIZE) {
+                    std::fclose(f);
+                    lastError = "Corrupt record at offset " + std::to_string(windowOffset + pos) + ".";
+                    return false;
+                }
+                if (avail < 8 + (size_t)size) break;
+                r.fid = fid;
+                r.text = base + 8;
+                r.length = size;
+                consumed = 8 + size;
+                have = true;
+            } else {
+                const char* nl = (const char*)std::memchr(base, '\n', avail);
+                if (!nl && !eof) break;
+                size_t lineLength = nl ? (size_t)(nl - base) : avail;
+                consumed = nl ? lineLength + 1 : lineLength;
+                if (lineLength > 0) {
+                    have = format == GalleryFormat::Jsonl
+                        ? parseJsonLine(base, lineLength, r.fid, r.text, r.length)
+                        : parseCsvLine(base, lineLength, r.fid, r.text, r.length);
+                }
+            }
+
+            pos += consumed;
+            if (have && (!fidFilter || fidFilter(r.fid))) batch.push_back(std::move(r));
+            if (batch.size() >= batchSize) flush(windowOffset + pos);
+        }
+
+        // Records in the batch point into the window, so commit before it moves
+        flush(windowOffset + pos);
+        window.erase(window.begin(), window.begin() + pos);
+        windowOffset += pos;
+    }
+
+    std::fclose(f);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (!window.empty() && binary) {
+        lastError = "Gallery dump ends with a truncated record.";
+        return false;
+    }
+    return true;
+}
+
+// ===== Export =====
+
+GalleryExporter::GalleryExporter(const FingerprintDevice& device, WorkerPool& pool, size_t batchSize)
+    : device(device), pool(pool), batchSize(batchSize ? batchSize : 1) {}
+
+bool GalleryExporter::run(const std::string& path, GalleryFormat format, TransferStats& stats) {
+    auto started = std::chrono::steady_clock::now();
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        lastError = "Cannot create gallery file: " + path;
+        return false;
+    }
+    std::vector<char> outBuf(kReadChunk);
+    std::setvbuf(f, outBuf.data(), _IOFBF, outBuf.size());
+
+    std::vector<GalleryEntry> gallery = device.snapshotGallery();
+    if (fidFilter) std::erase_if(gallery, [&](const GalleryEntry& e) { return !fidFilter(e.fid); });
+    bool ok = true;
+
+    if (format == GalleryFormat::Binary) {
+        std::fwrite(kBinaryMagic, 1, 4, f);
+        std::fwrite(&kBinaryVersion, 4, 1, f);
+        stats.bytes += 8;
+        for (const auto& e : gallery) {
+            uint32_t header[2] = { e.fid, e.size };
+            ok = ok && std::fwrite(header, 4, 2, f) == 2 && std::fwrite(e.data, 1, e.size, f) == e.size;
+            stats.bytes += 8 + e.size;
+            stats.records++;
+        }
+    } else {
+        if (format == GalleryFormat::Csv) {
+            const char header[] = "fid,template\n";
+            std::fwrite(header, 1, sizeof(header) - 1, f);
+        }
+        std::vector<std::string> lines;
+        for (size_t begin = 0; begin < gallery.size() && ok; begin += batchSize) {
+            size_t count = std::min(batchSize, gallery.size() - begin);
+            lines.resize(count);
+            pool.parallelFor(count, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const GalleryEntry& e = gallery[begin + i];
+                    std::string& line = lines[i];
+                    line.clear();
+                    if (format == GalleryFormat::Jsonl) {
+                        line += "{\"fid\":" + std::to_string(e.fid) + ",\"template\":\"";
+                        base64::encode(e.data, e.size, line);
+                        line += "\"}\n";
+                    } else {
+                        line += std::to_string(e.fid) + ",";
+                        base64::encode(e.data, e.size, line);
+                        line += "\n";
+                    }
+                }
+            }, TaskPriority::Low, 64);
+            for (const auto& line : lines) {
+                ok = ok && std::fwrite(line.data(), 1, line.size(), f) == line.size();
+                stats.bytes += line.size();
+            }
+            stats.records += count;
+        }
+    }
+
+    ok = (std::fclose(f) == 0) && ok;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (!ok) lastError = "Failed while writing gallery file: " + path;
+    return ok;
+}
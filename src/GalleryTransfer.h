@@ -0,0 +1,90 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "WorkerPool.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Gallery dump formats used between sites:
+//   Jsonl  - one {"fid": N, "template": "<base64>"} object per line
+//   Csv    - "fid,base64" per line (an optional header line is skipped)
+//   Binary - "ZKGB" + u32 version, then [u32 fid][u32 size][size bytes] records
+enum class GalleryFormat { Jsonl, Csv, Binary };
+
+bool parseGalleryFormat(const std::string& name, GalleryFormat& format);
+GalleryFormat guessGalleryFormat(const std::string& path);
+
+struct TransferStats {
+    uint64_t records = 0;   // records read or written
+    uint64_t imported = 0;
+    uint64_t skipped = 0;   // FID already enrolled (e.g. a batch replayed after resume)
+    uint64_t failed = 0;    // bad base64 / rejected by the SDK
+    uint64_t bytes = 0;
+    uint64_t totalBytes = 0; // input size, when known (import progress)
+    uint64_t position = 0;   // file offset just past the last committed record
+    double seconds = 0.0;
+
+    double templatesPerSecond() const { return seconds > 0.0 ? records / seconds : 0.0; }
+    std::string summary() const;
+};
+
+// Streams a dump into the gallery: large buffered reads, base64 decoded in
+// parallel per batch, then fed to ZKFPM_DBAdd. Memory is bounded by the read
+// buffer plus one batch. When progressPath is set, the file offset after each
+// committed batch is saved there, with the dump's size, modification time and
+// a hash of its head, and picked up again on the next run of the same dump.
+class GalleryImporter {
+public:
+    explicit GalleryImporter(FingerprintDevice& device, WorkerPool& pool = WorkerPool::shared(), size_t batchSize = 4096);
+
+    bool run(const std::string& path, GalleryFormat format, const std::string& progressPath, TransferStats& stats);
+    std::string getLastError() const { return lastError; }
+
+    // Held only while a decoded batch is added to the device, so other threads
+    // can keep using the device between batches (background warm-up)
+    void setCommitMutex(std::mutex* mutex) { commitMutex = mutex; }
+    // Called after every committed batch
+    void setProgressCallback(std::function<void(const TransferStats&)> callback) { onProgress = std::move(callback); }
+    // Only records whose FID passes are decoded and imported (gallery shards)
+    void setFidFilter(std::function<bool(unsigned int)> filter) { fidFilter = std::move(filter); }
+
+private:
+    struct PendingRecord {
+        unsigned int fid;
+        const char* text;   // base64 (text formats) or raw bytes (binary)
+        size_t length;
+        std::vector<unsigned char> blob;
+        bool ok;
+    };
+
+    void decodeBatch(std::vector<PendingRecord>& batch, bool raw);
+    void commitBatch(std::vector<PendingRecord>& batch, TransferStats& stats);
+
+    FingerprintDevice& device;
+    WorkerPool& pool;
+    size_t batchSize;
+    std::mutex* commitMutex = nullptr;
+    std::function<void(const TransferStats&)> onProgress;
+    std::function<bool(unsigned int)> fidFilter;
+    std::string lastError;
+};
+
+// Streams the gallery out, encoding base64 in parallel per batch on the pool
+class GalleryExporter {
+public:
+    explicit GalleryExporter(const FingerprintDevice& device, WorkerPool& pool = WorkerPool::shared(), size_t batchSize = 4096);
+
+    bool run(const std::string& path, GalleryFormat format, TransferStats& stats);
+    std::string getLastError() const { return lastError; }
+
+    // Only templates whose FID passes are written (quarantine dumps)
+    void setFidFilter(std::function<bool(unsigned int)> filter) { fidFilter = std::move(filter); }
+
+private:
+    const FingerprintDevice& device;
+    WorkerPool& pool;
+    size_t batchSize;
+    std::function<bool(unsigned int)> fidFilter;
+    std::string lastError;
+};
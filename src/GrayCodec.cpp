@@ -0,0 +1,170 @@
+#include "GrayCodec.h"
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+
+const int ContextCount = 4;
+const unsigned EscapeLength = 24; // unary prefix this long means "8 raw bits follow"
+
+struct Context {
+    unsigned sum = 4; // running sum of mapped residuals
+    unsigned count = 1;
+
+    unsigned k() const {
+        unsigned k = 0;
+        while ((count << k) < sum && k < 7) ++k;
+        return k;
+    }
+    void update(unsigned mapped) {
+        sum += mapped;
+        if (++count == 64) { // halve so the estimate follows the image
+            sum = (sum + 1) / 2;
+            count = 32;
+        }
+    }
+};
+
+int predict(int a, int b, int c) {
+    if (c >= (a > b ? a : b)) return a < b ? a : b;
+    if (c <= (a < b ? a : b)) return a > b ? a : b;
+    return a + b - c;
+}
+
+int contextOf(int a, int b, int c) {
+    int activity = std::abs(a - c) + std::abs(b - c);
+    return activity < 4 ? 0 : activity < 16 ? 1 : activity < 48 ? 2 : 3;
+}
+
+// Neighbours outside the image repeat the nearest edge pixel
+void neighbours(const unsigned char* cur, const unsigned char* prev, int x, int& a, int& b, int& c) {
+    if (!prev) {
+        a = x ? cur[x - 1] : 128;
+        b = c = a;
+    } else {
+        b = prev[x];
+        a = x ? cur[x - 1] : b;
+        c = x ? prev[x - 1] : b;
+    }
+}
+
+// Residual in [-128, 127] folded to 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+unsigned fold(int residual) {
+    residual = (int8_t)(uint8_t)residual;
+    return residual >= 0 ? (unsigned)residual * 2 : (unsigned)(-residual) * 2 - 1;
+}
+int unfold(unsigned mapped) {
+    return (mapped & 1) ? -(int)((mapped + 1) / 2) : (int)(mapped / 2);
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(CaptureBuffer& out) : out(out) {}
+    void put(uint32_t bits, unsigned count) {
+        acc = (acc << count) | (bits & ((1ull << count) - 1));
+        used += count;
+        while (used >= 8) {
+            used -= 8;
+            out.push_back((unsigned char)(acc >> used));
+        }
+    }
+    void ones(unsigned count) {
+        while (count > 16) { put(0xFFFF, 16); count -= 16; }
+        put((1u << count) - 1, count);
+    }
+    void flush() {
+        if (used) out.push_back((unsigned char)(acc << (8 - used)));
+        used = 0;
+    }
+
+private:
+    CaptureBuffer& out;
+    uint64_t acc = 0;
+    unsigned used = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+    bool bit(unsigned& value) {
+        if (pos >= size * 8) return false;
+        value = (data[pos >> 3] >> (7 - (pos & 7))) & 1;
+        ++pos;
+        return true;
+    }
+    bool get(unsigned count, unsigned& value) {
+        value = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            unsigned b;
+            if (!bit(b)) return false;
+            value = (value << 1) | b;
+        }
+        return true;
+    }
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t pos = 0;
+};
+
+} // namespace
+
+void GrayCodec::encode(const unsigned char* pixels, int width, int height, CaptureBuffer& out) {
+    Context contexts[ContextCount];
+    BitWriter writer(out);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* cur = pixels + (size_t)y * width;
+        const unsigned char* prev = y ? cur - width : nullptr;
+        for (int x = 0; x < width; ++x) {
+            int a, b, c;
+            neighbours(cur, prev, x, a, b, c);
+            Context& ctx = contexts[contextOf(a, b, c)];
+            unsigned k = ctx.k();
+            unsigned mapped = fold(cur[x] - predict(a, b, c));
+            unsigned q = mapped >> k;
+            if (q < EscapeLength) {
+                writer.ones(q);
+                writer.put(0, 1);
+                writer.put(mapped, k);
+            } else {
+                writer.ones(EscapeLength);
+                writer.put(mapped, 8);
+            }
+            ctx.update(mapped);
+        }
+    }
+    writer.flush();
+}
+
+bool GrayCodec::decode(const unsigned char* data, size_t size, int width, int height, CaptureBuffer& pixels) {
+    pixels.resize((size_t)width * height);
+    Context contexts[ContextCount];
+    BitReader reader(data, size);
+    for (int y = 0; y < height; ++y) {
+        unsigned char* cur = pixels.data() + (size_t)y * width;
+        const unsigned char* prev = y ? cur - width : nullptr;
+        for (int x = 0; x < width; ++x) {
+            int a, b, c;
+            neighbours(cur, prev, x, a, b, c);
+            Context& ctx = contexts[contextOf(a, b, c)];
+            unsigned k = ctx.k();
+            unsigned q = 0, bit = 1, mapped = 0;
+            while (q < EscapeLength) {
+                if (!reader.bit(bit)) return false;
+                if (!bit) break;
+                ++q;
+            }
+            if (q == EscapeLength) {
+                if (!reader.get(8, mapped)) return false;
+            } else {
+                unsigned low;
+                if (!reader.get(k, low)) return false;
+                mapped = (q << k) | low;
+            }
+            cur[x] = (unsigned char)(predict(a, b, c) + unfold(mapped));
+            ctx.update(mapped);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include "MemoryAccounting.h"
+
+// Lossless codec for 8-bit grayscale sensor images. Each pixel is predicted
+// from its left, upper and upper-left neighbours (the LOCO-I median edge
+// detector) and the residual is Golomb-Rice coded with a parameter adapted
+// per local-gradient context. No external image library, a few ms per frame.
+namespace GrayCodec {
+
+// Appends the encoded pixels to out
+void encode(const unsigned char* pixels, int width, int height, CaptureBuffer& out);
+// False if the stream is truncated or corrupt
+bool decode(const unsigned char* data, size_t size, int width, int height, CaptureBuffer& pixels);
+
+} // namespace GrayCodec
@@ -254,176 +254,458 @@
 // }
 #include "raylib.h"
 #include "FingerprintDevice.h"
+#include "MemoryAccounting.h"
+#include "DuplicateDetector.h"
+#include "CaptureFile.h"
+#include "CaptureArchive.h"
+#include "CapturePipeline.h"
+#include "StartupLoader.h"
+#include "GalleryManager.h"
+#include "FrameBus.h"
+#include "RetainedUi.h"
+#include "FrameStats.h"
+#include "TextViews.h"
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <sstream>
 
-// Utility function for button drawing
-bool DrawButton(const char* text, Rectangle rect, Color color, int fontSize = 20) {
-    DrawRectangleRec(rect, color);
-    DrawText(text, rect.x + 10, rect.y + 10, fontSize, WHITE);
-    return (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), rect));
+struct Button {
+    const char* text;
+    Rectangle rect;
+    Color color;
+};
+
+// Utility functions for button drawing (drawn once into the controls panel)
+void DrawButton(const Button& button, int fontSize = 20) {
+    DrawRectangleRec(button.rect, button.color);
+    DrawText(button.text, button.rect.x + 10, button.rect.y + 10, fontSize, WHITE);
+}
+
+bool ButtonClicked(const Button& button) {
+    return (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(GetMousePosition(), button.rect));
 }
 
 void RunGuiDemo() {
     const int screenWidth = 1000;
-    const int screenHeight = 720;
+    const int screenHeight = 890;
 
     InitWindow(screenWidth, screenHeight, "ZKTeco Fingerprint SDK + Raylib GUI");
     SetTargetFPS(60);
 
     FingerprintDevice fp;
-    std::string statusMessage = "Idle.";
-    std::string errorLog = "";
-    std::string debugInfo = "";
-    std::string lastHexTemplate = "";
+    DuplicateDetector dedupe;
+
+    // Capture record/replay for reproducible benchmarking:
+    //   ZKFP_RECORD=<file>   append every live capture to <file>
+    //   ZKFP_REPLAY=<file>   serve captures from <file> instead of the sensor
+    //   ZKFP_REPLAY_FAST=1   ignore recorded timing; ZKFP_REPLAY_LOOP=1 to loop
+    CaptureRecorder recorder;
+    CaptureReplay replay;
+    const char* recordPath = std::getenv("ZKFP_RECORD");
+    const char* replayPath = std::getenv("ZKFP_REPLAY");
+    const bool replaying = replayPath && *replayPath;
+    // ZKFP_FRAME_BUS=<name> publishes every live frame for other local processes
+    const char* frameBusName = std::getenv("ZKFP_FRAME_BUS");
+    FrameBusPublisher frameBus;
+    // ZKFP_ARCHIVE=<dir> keeps a compressed copy of every live capture for audit
+    const char* archiveDir = std::getenv("ZKFP_ARCHIVE");
+    CaptureArchiver archiver;
+    if (archiveDir && *archiveDir) {
+        ArchiveOptions archiveOptions;
+        archiveOptions.rootDir = archiveDir;
+        if (archiver.start(archiveOptions)) fp.setArchiver(&archiver);
+        else TraceLog(LOG_WARNING, "Capture archive disabled: %s", archiver.getLastError().c_str());
+    }
+    // ZKFP_PIPELINE=1 reads the sensor on its own thread and extracts on the pool;
+    // ZKFP_BEST_OF_N=1 also streams the whole touch and extracts/identifies only its best frame
+    const bool bestOfN = std::getenv("ZKFP_BEST_OF_N") != nullptr;
+    const bool pipelined = bestOfN || std::getenv("ZKFP_PIPELINE") != nullptr;
+    CapturePipeline pipeline(fp);
+    if (bestOfN) {
+        SelectionOptions selection;
+        selection.enabled = true;
+        pipeline.setSelection(selection);
+    }
+    // ZKFP_GALLERY=<dump> is loaded in the background on Connect
+    const char* galleryPath = std::getenv("ZKFP_GALLERY");
+    // Verify checks the last capture against ZKFP_VERIFY_FID=<fid>, or else the FID last identified
+    const char* verifyFidEnv = std::getenv("ZKFP_VERIFY_FID");
+    unsigned int claimedFid = verifyFidEnv ? (unsigned int)std::strtoul(verifyFidEnv, nullptr, 10) : 0;
+
+    StartupLoader startup(fp);
+    // Identify is served from a published copy of the gallery, built in the
+    // background after the bulk load and kept current by in-place adds.
+    // Door calls and rebuilds share the pool through the admission lanes.
+    AdmissionController admission;
+    GalleryManager serving;
+    serving.setAdmission(&admission);
+    bool startupActive = false;
+    StartupProgress reported;       // last progress already reflected in the UI
+    bool reportedFirstMatch = false;
+    CachedLabel statusMessage("Status: ");
+    CachedLabel errorLog("Error: ");
+    LogRing debugInfo;                 // bounded; oldest lines drop off
+    WrappedTextSource hexTemplate(80); // full template, paged 80 hex chars per row
 
     bool deviceOpen = false;
-    Image liveImage = { 0 };
     Texture2D liveTexture = { 0 };
     bool hasLiveImage = false;
+    MemoryCharge liveTextureCharge(MemoryTag::Ui);
 
     // Fingerprint state control
     static bool waitingForFinger = false;
     static bool capturing = false;
     static double captureStartTime = 0;
 
-    while (!WindowShouldClose()) {
-        BeginDrawing();
-        ClearBackground(RAYWHITE);
-
+    const Button connectBtn        = { "Connect",                  {100, 120, 150, 40}, GREEN };
+    const Button disconnectBtn     = { "Disconnect",               {300, 120, 150, 40}, RED };
+    const Button registerBtn       = { "Register",                 {100, 200, 150, 40}, BLUE };
+    const Button clearBtn          = { "Clear",                    {300, 200, 150, 40}, ORANGE };
+    const Button verifyBtn         = { "Verify",                   {100, 280, 150, 40}, DARKBLUE };
+    const Button identifyBtn       = { "Identify",                 {300, 280, 150, 40}, DARKGREEN };
+    const Button registerImageBtn  = { "Register by Image",        {100, 360, 150, 40}, GRAY };
+    const Button identifyImageBtn  = { "Identify by Image",        {300, 360, 150, 40}, DARKGRAY };
+    const Button acquireBtn        = { "Acquire Live Fingerprint", {150, 440, 250, 50}, PURPLE };
+
+    // ==== Retained panels: each is re-rendered only when its state changes ====
+    RetainedUi ui;
+    ui.addPanel({0, 0, 560, 505}, [&] {
         DrawText("ZKTeco Fingerprint Demo", 180, 40, 30, DARKGRAY);
+        for (const Button* b : { &connectBtn, &disconnectBtn, &registerBtn, &clearBtn, &verifyBtn,
+                                 &identifyBtn, &registerImageBtn, &identifyImageBtn, &acquireBtn })
+            DrawButton(*b);
+    });
+
+    int livePanel = ui.addPanel({580, 80, 420, 355}, [&] {
+        DrawRectangleLines(600, 120, 300, 300, GRAY);
+        DrawText("Live Fingerprint", 650, 90, 20, DARKGRAY);
+        if (hasLiveImage) {
+            DrawTextureEx(liveTexture, {610, 130}, 0.0f, 1.5f, WHITE);
+        } else {
+            DrawText("No image captured.", 640, 250, 18, LIGHTGRAY);
+        }
+    });
+
+    int errorPanel = ui.addPanel({580, 440, 420, 60}, [&] {
+        DrawText(errorLog.c_str(), 600, 450, 16, RED);
+    });
+
+    int statusPanel = ui.addPanel({0, 510, screenWidth, 45}, [&] {
+        DrawText(statusMessage.c_str(), 100, 520, 20, BLACK);
+    });
+
+    VirtualTextView debugView({110, 592, 780, 100}, 18, GRAY, true);
+    debugView.setSource(&debugInfo);
+    VirtualTextView hexView({110, 745, 780, 118}, 16, MAROON);
+    hexView.setSource(&hexTemplate);
+
+    int debugPanel = ui.addPanel({90, 555, 820, 150}, [&] {
+        DrawRectangleLines(100, 560, 800, 140, DARKGRAY);
+        DrawText("Debug Info:", 110, 570, 18, DARKGRAY);
+        debugView.draw();
+    });
+
+    int hexPanel = ui.addPanel({90, 705, 820, 170}, [&] {
+        DrawRectangleLines(100, 710, 800, 160, DARKGRAY);
+        DrawText("Captured Template (HEX):", 110, 720, 18, DARKGRAY);
+        if (hexTemplate.rowCount() > 0) {
+            hexView.draw();
+        } else {
+            DrawText("No fingerprint template yet.", 110, 745, 16, LIGHTGRAY);
+        }
+    });
+
+    auto setStatus = [&](const std::string& text) { if (statusMessage.set(text)) ui.markDirty(statusPanel); };
+    auto setError = [&](const std::string& text) { if (errorLog.set(text)) ui.markDirty(errorPanel); };
+    auto clearError = [&] { setError(""); };
+    auto setDebug = [&](const std::string& text) { debugInfo.clear(); debugInfo.append(text); };
+    auto appendDebug = [&](const std::string& text) { debugInfo.append(text); };
+    auto reportFirstMatch = [&] {
+        if (reportedFirstMatch || startup.timeToFirstMatch() < 0.0) return;
+        reportedFirstMatch = true;
+        char line[64];
+        std::snprintf(line, sizeof(line), "Time to first match: %.2f s\n", startup.timeToFirstMatch());
+        appendDebug(line);
+    };
+
+    setStatus("Idle.");
+    FrameStats stats;
+    // Frame bus readers are checked every few seconds: stale entries are freed, lag is logged
+    double busCheckTime = 0.0;
+    size_t busReaders = 0;
+    uint64_t busDropped = 0;
+
+    while (!WindowShouldClose()) {
+        // While the gallery is still loading in the background, the device is
+        // shared with the loader; it only holds the lock per committed batch
+        StartupProgress boot = startupActive ? startup.progress() : StartupProgress();
+        std::unique_lock<std::mutex> deviceLock(startup.deviceMutex(), std::defer_lock);
+        if (startupActive && boot.sdkReady && boot.deviceReady) deviceLock.lock();
 
         // ==== Row 1 ==== CONNECT / DISCONNECT ====
-        if (DrawButton("Connect", {100, 120, 150, 40}, GREEN)) {
-            debugInfo = "Attempting to initialize SDK...\n";
-
-            if (fp.initialize()) {
-                debugInfo += "SDK initialized successfully.\n";
-
-                int count = fp.getDeviceCount();
-                std::ostringstream oss;
-                oss << "Device count: " << count << "\n";
-                debugInfo += oss.str();
-
-                if (count <= 0) {
-                    statusMessage = "No fingerprint devices detected.";
-                    errorLog = "Error: No device found.";
-                    debugInfo += "No devices detected.\n";
-                } else if (fp.openDevice(0)) {
-                    statusMessage = "Device connected successfully.";
-                    deviceOpen = true;
-                    errorLog.clear();
-                    debugInfo += "Device 0 opened successfully.\n";
+        if (ButtonClicked(connectBtn)) {
+            if (deviceOpen || startupActive) {
+                setError("Already connected.");
+            } else {
+                // SDK init, device open and gallery load run on the pool; progress is polled below
+                std::string gallery = galleryPath ? galleryPath : "";
+                setDebug("Starting SDK in the background...\n");
+                if (!gallery.empty()) appendDebug("Loading gallery from " + gallery + "\n");
+                startup.start(replaying ? -1 : 0, gallery, guessGalleryFormat(gallery));
+                startupActive = true;
+                reported = StartupProgress();
+                reportedFirstMatch = false;
+                clearError();
+            }
+        }
+
+        // ==== Background startup: finish each step on the UI thread as it completes ====
+        if (startupActive) {
+            setStatus(boot.summary());
+            if (!boot.sdkError.empty()) {
+                setError(boot.sdkError);
+                appendDebug("SDK initialization failed: " + boot.sdkError + "\n");
+            } else if (boot.sdkReady && !reported.sdkReady) {
+                appendDebug("SDK initialized successfully.\n");
+            }
+
+            if (boot.sdkReady && boot.deviceReady && !deviceOpen) {
+                if (frameBusName && *frameBusName && !frameBus.isOpen()) {
+                    if (frameBus.create(frameBusName)) appendDebug(std::string("Publishing frames on bus ") + frameBusName + "\n");
+                    else appendDebug("Frame bus disabled: " + frameBus.getLastError() + "\n");
+                }
+                if (replaying) {
+                    ReplayPacing pacing = std::getenv("ZKFP_REPLAY_FAST") ? ReplayPacing::AsFastAsPossible
+                                                                          : ReplayPacing::Original;
+                    if (replay.open(replayPath, pacing, std::getenv("ZKFP_REPLAY_LOOP") != nullptr)) {
+                        fp.setReplay(&replay);
+                        deviceOpen = true;
+                        appendDebug("Replaying " + std::to_string(replay.size()) + " frames from " + replayPath + "\n");
+                    } else {
+                        setError(replay.getLastError());
+                    }
                 } else {
-                    statusMessage = "Failed to open device.";
-                    errorLog = fp.getLastError();
-                    debugInfo += "Device open failed: " + errorLog + "\n";
+                    deviceOpen = true;
+                    appendDebug("Device 0 opened successfully.\n");
+                    int sensorWidth = 0, sensorHeight = 0, sensorDpi = 0;
+                    if (frameBus.isOpen() && fp.getCaptureParams(sensorWidth, sensorHeight, sensorDpi))
+                        frameBus.setGeometry(sensorWidth, sensorHeight, sensorDpi);
+                    if (recordPath && *recordPath) {
+                        if (recorder.open(recordPath)) {
+                            fp.setRecorder(&recorder);
+                            appendDebug(std::string("Recording captures to ") + recordPath + "\n");
+                        } else {
+                            appendDebug("Recording disabled: " + recorder.getLastError() + "\n");
+                        }
+                    }
                 }
-            } else {
-                statusMessage = "SDK initialization failed.";
-                errorLog = fp.getLastError();
-                debugInfo += "SDK initialization failed: " + errorLog + "\n";
             }
+            if (!boot.deviceError.empty() && reported.deviceError.empty()) {
+                setError(boot.deviceError);
+                appendDebug("Device open failed: " + boot.deviceError + "\n");
+            }
+            if (!boot.galleryError.empty() && reported.galleryError.empty()) {
+                setError(boot.galleryError);
+                appendDebug("Gallery load failed: " + boot.galleryError + "\n");
+            }
+
+            if (!boot.running) {
+                startupActive = false;
+                if (boot.sdkReady) {
+                    if (galleryPath && *galleryPath) {
+                        appendDebug("Gallery: " + boot.gallery.summary() + "\n");
+                        // Price the SDK's caches from a sample, then report the footprint at this gallery size
+                        std::vector<GalleryEntry> sample = fp.snapshotGallery();
+                        if (sample.size() > 1000) sample.resize(1000);
+                        MemoryAccounting::calibrateSdkCache(sample);
+                        TraceLog(LOG_INFO, "Memory after gallery load:\n%s", MemoryAccounting::snapshot().summary().c_str());
+                    }
+                    // Enrollment-time duplicate checks start once the bulk load is done
+                    if (dedupe.initialize()) fp.setDuplicateDetector(&dedupe);
+                    else appendDebug("Duplicate check disabled: " + dedupe.getLastError() + "\n");
+                    // One full build for the bulk load; later enrollments are applied in place
+                    fp.addGalleryListener(&serving);
+                    serving.publishAsync(fp.snapshotGallery());
+                }
+                char line[64];
+                std::snprintf(line, sizeof(line), "Startup finished in %.2f s\n", boot.elapsedSeconds);
+                appendDebug(line);
+            }
+            reported = boot;
         }
 
-        if (DrawButton("Disconnect", {300, 120, 150, 40}, RED)) {
-            fp.closeDevice();
-            fp.terminate();
-            deviceOpen = false;
-            statusMessage = "Device disconnected.";
-            errorLog.clear();
-            debugInfo += "Device disconnected.\n";
+        if (ButtonClicked(disconnectBtn)) {
+            if (startupActive) {
+                setError("Still connecting.");
+            } else {
+                pipeline.stop();
+                fp.closeDevice();
+                fp.setRecorder(nullptr);
+                fp.setReplay(nullptr);
+                recorder.close();
+                fp.setDuplicateDetector(nullptr);
+                dedupe.release();
+                fp.removeGalleryListener(&serving);
+                serving.shutdown();
+                fp.terminate();
+                deviceOpen = false;
+                setStatus("Device disconnected.");
+                clearError();
+                appendDebug("Device disconnected.\n");
+            }
         }
 
         // ==== Row 2 ====
-        if (DrawButton("Register", {100, 200, 150, 40}, BLUE)) {
-            if (!deviceOpen) errorLog = "Device not connected.";
+        if (ButtonClicked(registerBtn)) {
+            if (!deviceOpen) setError("Device not connected.");
             else {
-                statusMessage = "Registering fingerprint...";
-                if (!fp.registerFingerprint()) errorLog = fp.getLastError();
-                else errorLog.clear();
+                setStatus("Registering fingerprint...");
+                if (!fp.registerFingerprint()) setError(fp.getLastError());
+                else clearError();
             }
         }
 
-        if (DrawButton("Clear", {300, 200, 150, 40}, ORANGE)) {
-            if (!deviceOpen) errorLog = "Device not connected.";
+        if (ButtonClicked(clearBtn)) {
+            if (!deviceOpen) setError("Device not connected.");
             else {
-                statusMessage = "Clearing fingerprints...";
-                if (!fp.clearFingerprints()) errorLog = fp.getLastError();
-                else errorLog.clear();
+                setStatus("Clearing fingerprints...");
+                if (!fp.clearFingerprints()) setError(fp.getLastError());
+                else clearError();
             }
         }
 
         // ==== Row 3 ====
-        if (DrawButton("Verify", {100, 280, 150, 40}, DARKBLUE)) {
-            if (!deviceOpen) errorLog = "Device not connected.";
+        if (ButtonClicked(verifyBtn)) {
+            if (!deviceOpen) setError("Device not connected.");
+            else if (fp.getLastTemplate().empty()) setError("Capture a fingerprint first.");
+            else if (claimedFid == 0) setError("No FID to verify against: set ZKFP_VERIFY_FID or identify first.");
             else {
-                statusMessage = "Verifying fingerprint...";
-                if (!fp.verifyFingerprint()) errorLog = fp.getLastError();
-                else errorLog.clear();
+                // Same routing as Identify: the published gallery once serving, the loader while it warms up
+                const TemplateBuffer& tpl = fp.getLastTemplate();
+                unsigned int tplSize = static_cast<unsigned int>(tpl.size());
+                int score = 0;
+                std::string error;
+                bool matched;
+                if (!startupActive && serving.ready()) {
+                    matched = serving.verify(claimedFid, tpl.data(), tplSize, score);
+                    if (!matched) error = serving.getLastError();
+                } else {
+                    matched = startup.verify(claimedFid, tpl.data(), tplSize, score, error);
+                }
+                if (matched) {
+                    setStatus("Verified FID " + std::to_string(claimedFid) + " (score " + std::to_string(score) + ").");
+                    clearError();
+                    reportFirstMatch();
+                } else {
+                    setError(error);
+                }
             }
         }
 
-        if (DrawButton("Identify", {300, 280, 150, 40}, DARKGREEN)) {
-            if (!deviceOpen) errorLog = "Device not connected.";
-            else {
-                statusMessage = "Identifying fingerprint...";
-                if (!fp.identifyFingerprint()) errorLog = fp.getLastError();
-                else errorLog.clear();
+        if (ButtonClicked(identifyBtn)) {
+            if (!deviceOpen) setError("Device not connected.");
+            else if (!fp.getLastTemplate().empty()) {
+                // Last live capture against whatever part of the gallery is loaded so far
+                const TemplateBuffer& tpl = fp.getLastTemplate();
+                unsigned int tplSize = static_cast<unsigned int>(tpl.size());
+                unsigned int fid = 0, score = 0;
+                std::string error;
+                bool matched;
+                if (!startupActive && serving.ready()) {
+                    matched = serving.identify(tpl.data(), tplSize, fid, score);
+                    if (!matched) error = serving.getLastError();
+                } else {
+                    matched = startup.identify(tpl.data(), tplSize, fid, score, error);
+                }
+                if (matched) {
+                    setStatus("Matched FID " + std::to_string(fid) + " (score " + std::to_string(score) + ").");
+                    clearError();
+                    if (!verifyFidEnv) claimedFid = fid;
+                    reportFirstMatch();
+                } else {
+                    setError(error);
+                }
+            } else {
+                setStatus("Identifying fingerprint...");
+                if (!fp.identifyFingerprint()) setError(fp.getLastError());
+                else clearError();
             }
         }
 
         // ==== Row 4 ====
-        if (DrawButton("Register by Image", {100, 360, 150, 40}, GRAY)) {
-            if (!deviceOpen) errorLog = "Device not connected.";
+        if (ButtonClicked(registerImageBtn)) {
+            if (!deviceOpen) setError("Device not connected.");
             else {
-                statusMessage = "Register by image...";
-                if (!fp.registerByImage("finger.bmp")) errorLog = fp.getLastError();
-                else errorLog.clear();
+                setStatus("Register by image...");
+                if (!fp.registerByImage("finger.bmp")) setError(fp.getLastError());
+                else clearError();
             }
         }
 
-        if (DrawButton("Identify by Image", {300, 360, 150, 40}, DARKGRAY)) {
-            if (!deviceOpen) errorLog = "Device not connected.";
+        if (ButtonClicked(identifyImageBtn)) {
+            if (!deviceOpen) setError("Device not connected.");
             else {
-                statusMessage = "Identify by image...";
-                if (!fp.identifyByImage("finger.bmp")) errorLog = fp.getLastError();
-                else errorLog.clear();
+                setStatus("Identify by image...");
+                if (!fp.identifyByImage("finger.bmp")) setError(fp.getLastError());
+                else clearError();
             }
         }
 
         // ==== Row 5: Acquire Live Fingerprint ====
-        if (DrawButton("Acquire Live Fingerprint", {150, 440, 250, 50}, PURPLE)) {
-            if (!deviceOpen) errorLog = "Device not connected.";
-            else {
+        if (ButtonClicked(acquireBtn)) {
+            if (!deviceOpen) setError("Device not connected.");
+            else if (pipelined && !replaying && !pipeline.isRunning() && !pipeline.start()) {
+                setError(pipeline.getLastError());
+            } else {
                 waitingForFinger = true;
                 capturing = false;
-                statusMessage = "Place your finger on the sensor...";
-                errorLog.clear();
+                setStatus("Place your finger on the sensor...");
+                clearError();
             }
         }
 
         // If waiting for user input, keep checking the sensor
         if (waitingForFinger && deviceOpen) {
-            unsigned char paramBuf[4];
-            unsigned int size = 4;
             int fingerDetected = 1; // Simulated — set manually if SDK lacks param 101
 
             if (fingerDetected) {
                 waitingForFinger = false;
                 capturing = true;
                 captureStartTime = GetTime();
-                statusMessage = "Finger detected. Capturing image...";
+                setStatus("Finger detected. Capturing image...");
             }
         }
 
         // When finger detected, capture image and HEX template
         if (capturing && deviceOpen) {
-            std::vector<unsigned char> img;
+            CaptureBuffer img;
             int width = 0, height = 0;
 
-            if (fp.acquireLiveFingerprint(img, width, height)) {
+            bool captured = false;
+            if (pipeline.isRunning()) {
+                PipelineFrame frame;
+                while (!captured && pipeline.poll(frame)) {
+                    if (!frame.ok()) continue;
+                    fp.acceptCapture(frame.image.data(), frame.width, frame.height,
+                                     frame.fpTemplate.data(), static_cast<unsigned int>(frame.fpTemplate.size()));
+                    img.swap(frame.image);
+                    width = frame.width;
+                    height = frame.height;
+                    captured = true;
+                }
+            } else {
+                captured = fp.acquireLiveFingerprint(img, width, height);
+            }
+            // One capture per click: the sensor goes back to the other buttons afterwards
+            if (pipeline.isRunning() && (captured || GetTime() - captureStartTime > 3.0)) {
+                pipeline.stop();
+                appendDebug("Pipeline: " + pipeline.stats().summary() + "\n");
+            }
+
+            if (captured) {
                 if (hasLiveImage) UnloadTexture(liveTexture);
                 Image liveImage = {
                     .data = img.data(),
@@ -433,56 +715,95 @@ void RunGuiDemo() {
                     .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE
                 };
                 liveTexture = LoadTextureFromImage(liveImage);
+                liveTextureCharge.set((size_t)width * height);
                 hasLiveImage = true;
+                if (frameBus.isOpen()) frameBus.publish(img.data(), static_cast<unsigned int>(img.size()), width, height);
+                ui.markDirty(livePanel);
 
-                statusMessage = "Live fingerprint captured!";
-                lastHexTemplate = fp.getLastHexTemplate(); // <-- Get the HEX value
-                errorLog.clear();
+                setStatus("Live fingerprint captured!");
+                hexTemplate.setText(fp.getLastHexTemplate()); // <-- Get the HEX value
+                clearError();
                 capturing = false;
+                if (bestOfN && !startupActive && serving.ready()) {
+                    // Only the selected frame is ever identified
+                    const TemplateBuffer& tpl = fp.getLastTemplate();
+                    unsigned int fid = 0, score = 0;
+                    if (serving.identify(tpl.data(), static_cast<unsigned int>(tpl.size()), fid, score)) {
+                        setStatus("Matched FID " + std::to_string(fid) + " (score " + std::to_string(score) + ").");
+                        if (!verifyFidEnv) claimedFid = fid;
+                    } else {
+                        setError(serving.getLastError());
+                    }
+                }
             } else {
                 if (GetTime() - captureStartTime > 3.0) {
-                    errorLog = fp.getLastError();
+                    setError(pipelined && !replaying ? "No fingerprint extracted." : fp.getLastError());
                     capturing = false;
                     waitingForFinger = false;
                 }
             }
         }
 
-        // ==== Right Column: Live Image ====
-        DrawRectangleLines(600, 120, 300, 300, GRAY);
-        DrawText("Live Fingerprint", 650, 90, 20, DARKGRAY);
-        if (hasLiveImage) {
-            DrawTextureEx(liveTexture, {610, 130}, 0.0f, 1.5f, WHITE);
-        } else {
-            DrawText("No image captured.", 640, 250, 18, LIGHTGRAY);
+        if (deviceLock.owns_lock()) deviceLock.unlock();
+
+        if (frameBus.isOpen() && GetTime() - busCheckTime > 5.0) {
+            busCheckTime = GetTime();
+            std::vector<FrameBusReaderInfo> readers = frameBus.readers();
+            uint64_t dropped = 0;
+            for (const FrameBusReaderInfo& r : readers) dropped += r.dropped;
+            if (readers.size() != busReaders)
+                TraceLog(LOG_INFO, "Frame bus: %zu readers (was %zu)", readers.size(), busReaders);
+            if (dropped > busDropped) {
+                for (const FrameBusReaderInfo& r : readers)
+                    TraceLog(LOG_WARNING, "Frame bus reader %u: %llu frames behind, %llu dropped, idle %.1f s", r.pid,
+                             (unsigned long long)r.lag, (unsigned long long)r.dropped, r.idleSeconds);
+            }
+            busReaders = readers.size();
+            busDropped = dropped;
         }
 
-        // ==== Status and Logs ====
-        DrawText(("Status: " + statusMessage).c_str(), 100, 520, 20, BLACK);
-        DrawText(("Error: " + errorLog).c_str(), 600, 450, 16, RED);
+        // Scrolling or new content only redraws the panel that owns the view
+        if (debugView.update()) ui.markDirty(debugPanel);
+        if (hexView.update()) ui.markDirty(hexPanel);
 
-        // ==== Debug Info Box ====
-        DrawRectangleLines(100, 560, 800, 140, DARKGRAY);
-        DrawText("Debug Info:", 110, 570, 18, DARKGRAY);
-        DrawText(debugInfo.c_str(), 110, 590, 18, GRAY);
+        // Poll at full rate only while the sensor is in use or something needs
+        // redrawing; otherwise block in EndDrawing() until the next input event
+        bool active = waitingForFinger || capturing || startupActive || ui.anyDirty();
+        if (active) DisableEventWaiting();
+        else EnableEventWaiting();
 
-        // ==== HEX TEMPLATE BOX ====
-        DrawRectangleLines(100, 710, 800, 160, DARKGRAY);
-        DrawText("Captured Template (HEX):", 110, 720, 18, DARKGRAY);
-
-        if (!lastHexTemplate.empty()) {
-            std::string truncated = lastHexTemplate.substr(0, 140) + "...";
-            DrawText(truncated.c_str(), 110, 745, 16, MAROON);
-        } else {
-            DrawText("No fingerprint template yet.", 110, 745, 16, LIGHTGRAY);
-        }
-        DrawText(("HEX: " + fp.getLastHexTemplate()).c_str(), 110, 610, 16, DARKGREEN);
+        ui.update();
 
+        BeginDrawing();
+        ClearBackground(RAYWHITE);
+        ui.composite();
         EndDrawing();
+
+        stats.endFrame(active);
     }
 
+    TraceLog(LOG_INFO, "GUI frame stats: %s", stats.summary().c_str());
+    TraceLog(LOG_INFO, "Memory (peaks cover the whole session):\n%s", MemoryAccounting::snapshot().summary().c_str());
+    if (startup.timeToFirstMatch() >= 0.0)
+        TraceLog(LOG_INFO, "Time to first match: %.3f s", startup.timeToFirstMatch());
+    startup.wait();
+    fp.removeGalleryListener(&serving);
+    serving.shutdown();
+
+    ui.unload();
     if (hasLiveImage) UnloadTexture(liveTexture);
-    if (deviceOpen) fp.closeDevice();
+    liveTextureCharge.set(0);
+    pipeline.stop();
+    fp.closeDevice(); // no-op unless a device was opened
+    fp.setRecorder(nullptr);
+    fp.setReplay(nullptr);
+    fp.setArchiver(nullptr);
+    if (archiver.isRunning()) {
+        archiver.stop();
+        TraceLog(LOG_INFO, "Capture archive: %s", archiver.stats().summary().c_str());
+    }
+    fp.setDuplicateDetector(nullptr);
+    dedupe.release();
     fp.terminate();
     CloseWindow();
 }
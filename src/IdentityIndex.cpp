@@ -0,0 +1,387 @@
+#include "IdentityIndex.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+const char IndexMagic[4] = { 'Z', 'K', 'I', 'D' };
+const uint32_t IndexVersion = 1;
+const size_t HeaderSize = 32; // magic, version, bits, reserved, entries (u64), bitmap words (u64)
+const unsigned int MinBits = 4;
+const unsigned int MaxBits = 40;
+
+uint64_t packKey(unsigned int fid, const Identity& id) {
+    return fid | ((uint64_t)id.personId << 32);
+}
+
+uint64_t packValue(const Identity& id) {
+    return id.finger | ((uint64_t)id.flags << 8) | ((uint64_t)id.quality << 16) | ((uint64_t)id.enrolledAt << 32);
+}
+
+Identity unpack(uint64_t key, uint64_t value) {
+    Identity id;
+    id.personId = (uint32_t)(key >> 32);
+    id.finger = (uint8_t)value;
+    id.flags = (uint8_t)(value >> 8);
+    id.quality = (uint16_t)(value >> 16);
+    id.enrolledAt = (uint32_t)(value >> 32);
+    return id;
+}
+
+// Smallest power-of-two table that holds `entries` under the 70% load limit
+unsigned int bitsFor(size_t entries) {
+    unsigned int bits = MinBits;
+    while (bits < MaxBits && entries * 10 > ((size_t)7 << bits)) ++bits;
+    return bits;
+}
+
+} // namespace
+
+std::string IdentityIndexStats::summary() const {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%zu identities in %zu slots (load %.2f, mean probe %.2f, max %zu), highest FID %u, "
+                  "%.1f MB table + %.1f MB retired + %.1f KB allocator (%.1f bytes/identity)",
+                  entries, capacity, loadFactor, meanProbe, maxProbe, highestFid, tableBytes / 1048576.0,
+                  retiredBytes / 1048576.0, allocatorBytes / 1024.0,
+                  entries ? (double)(tableBytes + allocatorBytes) / entries : 0.0);
+    return line;
+}
+
+IdentityIndex::IdentityIndex(size_t expectedEntries) {
+    tables.push_back(std::make_unique<Table>(bitsFor(expectedEntries)));
+    table.store(tables.back().get(), std::memory_order_release);
+    tableCharge.set(((size_t)1 << tables.back()->bits) * sizeof(Slot));
+}
+
+IdentityIndex::~IdentityIndex() = default;
+
+// ===== Sequence lock =====
+
+void IdentityIndex::beginWrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void IdentityIndex::endWrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool IdentityIndex::find(unsigned int fid, Identity& identity) const {
+    if (fid == 0) return false;
+    for (;;) {
+        uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        const Table* t = table.load(std::memory_order_acquire);
+        uint64_t key = 0, value = 0;
+        size_t i = home(*t, fid);
+        for (size_t probes = 0; probes <= t->mask; ++probes, i = (i + 1) & t->mask) {
+            uint64_t k = t->slots[i].key.load(std::memory_order_relaxed);
+            if (k == 0) break;
+            if ((uint32_t)k == fid) {
+                key = k;
+                value = t->slots[i].value.load(std::memory_order_relaxed);
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before) continue;
+        if (key == 0) return false;
+        identity = unpack(key, value);
+        return true;
+    }
+}
+
+// ===== Writes =====
+
+// Returns false when the FID was already present (its identity is replaced)
+bool IdentityIndex::insert(Table& t, uint64_t key, uint64_t value) {
+    size_t i = home(t, (uint32_t)key);
+    uint64_t k;
+    for (;;) {
+        k = t.slots[i].key.load(std::memory_order_relaxed);
+        if (k == 0 || (uint32_t)k == (uint32_t)key) break;
+        i = (i + 1) & t.mask;
+    }
+    t.slots[i].value.store(value, std::memory_order_relaxed);
+    t.slots[i].key.store(key, std::memory_order_relaxed);
+    return k == 0;
+}
+
+void IdentityIndex::grow() {
+    Table* old = table.load(std::memory_order_relaxed);
+    auto bigger = std::make_unique<Table>(old->bits + 1);
+    for (size_t i = 0; i <= old->mask; ++i) {
+        uint64_t k = old->slots[i].key.load(std::memory_order_relaxed);
+        if (k) insert(*bigger, k, old->slots[i].value.load(std::memory_order_relaxed));
+    }
+    tables.push_back(std::move(bigger));
+    tableCharge.set(tableCharge.bytes() + ((size_t)1 << tables.back()->bits) * sizeof(Slot));
+    beginWrite();
+    table.store(tables.back().get(), std::memory_order_release);
+    endWrite();
+}
+
+bool IdentityIndex::put(unsigned int fid, const Identity& identity) {
+    if (fid == 0) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        lastError = "FID 0 is not a valid FID.";
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(writeMutex);
+    Table* t = table.load(std::memory_order_relaxed);
+    if ((count.load(std::memory_order_relaxed) + 1) * 10 > (t->mask + 1) * 7) {
+        if (t->bits >= MaxBits) {
+            std::lock_guard<std::mutex> errorLock(errorMutex);
+            lastError = "Identity index is full.";
+            return false;
+        }
+        grow();
+        t = table.load(std::memory_order_relaxed);
+    }
+    markFid(fid);
+    beginWrite();
+    bool added = insert(*t, packKey(fid, identity), packValue(identity));
+    endWrite();
+    if (added) count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool IdentityIndex::erase(unsigned int fid) {
+    if (fid == 0) return false;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    Table& t = *table.load(std::memory_order_relaxed);
+    size_t i = home(t, fid);
+    for (;;) {
+        uint64_t k = t.slots[i].key.load(std::memory_order_relaxed);
+        if (k == 0) return false;
+        if ((uint32_t)k == fid) break;
+        i = (i + 1) & t.mask;
+    }
+    // Backward-shift: pull later entries of the run into the hole unless
+    // that would move one in front of its home slot
+    beginWrite();
+    for (size_t j = (i + 1) & t.mask;; j = (j + 1) & t.mask) {
+        uint64_t k = t.slots[j].key.load(std::memory_order_relaxed);
+        if (k == 0) break;
+        size_t h = home(t, (uint32_t)k);
+        if (((j - h) & t.mask) >= ((j - i) & t.mask)) {
+            t.slots[i].value.store(t.slots[j].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            t.slots[i].key.store(k, std::memory_order_relaxed);
+            i = j;
+        }
+    }
+    t.slots[i].key.store(0, std::memory_order_relaxed);
+    t.slots[i].value.store(0, std::memory_order_relaxed);
+    endWrite();
+    count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void IdentityIndex::clear() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    Table& t = *table.load(std::memory_order_relaxed);
+    beginWrite();
+    for (size_t i = 0; i <= t.mask; ++i) {
+        t.slots[i].key.store(0, std::memory_order_relaxed);
+        t.slots[i].value.store(0, std::memory_order_relaxed);
+    }
+    endWrite();
+    count.store(0, std::memory_order_relaxed);
+    fidBits.assign(1, 1);
+    firstFreeWord = 0;
+}
+
+// ===== FID allocator =====
+
+unsigned int IdentityIndex::allocateFid() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    size_t w = firstFreeWord;
+    while (w < fidBits.size() && fidBits[w] == ~0ull) ++w;
+    if (w == fidBits.size()) fidBits.push_back(0);
+    unsigned int bit = (unsigned int)std::countr_one(fidBits[w]);
+    fidBits[w] |= 1ull << bit;
+    firstFreeWord = w;
+    return (unsigned int)(w * 64 + bit);
+}
+
+void IdentityIndex::releaseFid(unsigned int fid) {
+    if (fid == 0) return;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    size_t w = fid / 64;
+    if (w >= fidBits.size()) return;
+    fidBits[w] &= ~(1ull << (fid % 64));
+    firstFreeWord = std::min(firstFreeWord, w);
+}
+
+// Caller holds writeMutex
+void IdentityIndex::markFid(unsigned int fid) {
+    size_t w = fid / 64;
+    if (w >= fidBits.size()) fidBits.resize(w + 1, 0);
+    fidBits[w] |= 1ull << (fid % 64);
+}
+
+// ===== Gallery =====
+
+void IdentityIndex::onTemplateAdded(unsigned int fid, const unsigned char*, unsigned int) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    markFid(fid);
+}
+
+void IdentityIndex::onTemplateRemoved(unsigned int fid) {
+    erase(fid);
+    releaseFid(fid);
+}
+
+void IdentityIndex::onGalleryCleared() {
+    clear();
+}
+
+// ===== Persistence =====
+
+bool IdentityIndex::save(const std::string& path) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::lock_guard<std::mutex> errorLock(errorMutex);
+        lastError = "Cannot create identity index: " + path;
+        return false;
+    }
+    const Table& t = *table.load(std::memory_order_relaxed);
+    uint32_t bits = t.bits, reserved = 0;
+    uint64_t entries = count.load(std::memory_order_relaxed), words = fidBits.size();
+    bool ok = std::fwrite(IndexMagic, 1, 4, file) == 4;
+    ok = ok && std::fwrite(&IndexVersion, 4, 1, file) == 1;
+    ok = ok && std::fwrite(&bits, 4, 1, file) == 1;
+    ok = ok && std::fwrite(&reserved, 4, 1, file) == 1;
+    ok = ok && std::fwrite(&entries, 8, 1, file) == 1;
+    ok = ok && std::fwrite(&words, 8, 1, file) == 1;
+
+    std::vector<uint64_t> chunk;
+    chunk.reserve(8192);
+    for (size_t i = 0; ok && i <= t.mask; ++i) {
+        chunk.push_back(t.slots[i].key.load(std::memory_order_relaxed));
+        chunk.push_back(t.slots[i].value.load(std::memory_order_relaxed));
+        if (chunk.size() == chunk.capacity() || i == t.mask) {
+            ok = std::fwrite(chunk.data(), 8, chunk.size(), file) == chunk.size();
+            chunk.clear();
+        }
+    }
+    ok = ok && std::fwrite(fidBits.data(), 8, fidBits.size(), file) == fidBits.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::lock_guard<std::mutex> errorLock(errorMutex);
+        lastError = "Cannot write identity index: " + path;
+    }
+    return ok;
+}
+
+bool IdentityIndex::load(const std::string& path) {
+    auto fail = [&](const std::string& error) {
+        std::lock_guard<std::mutex> errorLock(errorMutex);
+        lastError = error + ": " + path;
+        return false;
+    };
+    HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return fail("Cannot open identity index");
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    const unsigned char* view = nullptr;
+    if (GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart >= (long long)HeaderSize) {
+        mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        view = mapping ? static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    }
+    auto unmap = [&]() {
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(fileHandle);
+    };
+    if (!view) {
+        unmap();
+        return fail("Cannot map identity index");
+    }
+
+    uint32_t version, bits;
+    uint64_t words;
+    std::memcpy(&version, view + 4, 4);
+    std::memcpy(&bits, view + 8, 4);
+    std::memcpy(&words, view + 24, 8);
+    bool valid = std::memcmp(view, IndexMagic, 4) == 0 && version == IndexVersion && bits >= MinBits &&
+                 bits <= MaxBits && words >= 1 &&
+                 (uint64_t)fileSize.QuadPart == HeaderSize + ((uint64_t)16 << bits) + words * 8;
+    if (!valid) {
+        unmap();
+        return fail("Not an identity index (or wrong version)");
+    }
+
+    // The slot array is the table as saved: copy it in place, no rehash
+    auto loaded = std::make_unique<Table>(bits);
+    const unsigned char* slotData = view + HeaderSize;
+    size_t entries = 0;
+    for (size_t i = 0; i <= loaded->mask; ++i) {
+        uint64_t k, v;
+        std::memcpy(&k, slotData + i * 16, 8);
+        std::memcpy(&v, slotData + i * 16 + 8, 8);
+        loaded->slots[i].key.store(k, std::memory_order_relaxed);
+        loaded->slots[i].value.store(v, std::memory_order_relaxed);
+        entries += k != 0;
+    }
+    TrackedVector<MemoryTag::Gallery, uint64_t> bitmap((size_t)words);
+    std::memcpy(bitmap.data(), slotData + ((size_t)16 << bits), bitmap.size() * 8);
+    bitmap[0] |= 1; // FID 0 stays reserved
+    unmap();
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    tables.push_back(std::move(loaded));
+    tableCharge.set(tableCharge.bytes() + ((size_t)1 << tables.back()->bits) * sizeof(Slot));
+    beginWrite();
+    table.store(tables.back().get(), std::memory_order_release);
+    count.store(entries, std::memory_order_relaxed);
+    endWrite();
+    fidBits = std::move(bitmap);
+    firstFreeWord = 0;
+    return true;
+}
+
+// ===== Stats =====
+
+IdentityIndexStats IdentityIndex::stats() const {
+    IdentityIndexStats s;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Table& t = *table.load(std::memory_order_relaxed);
+    s.capacity = t.mask + 1;
+    s.entries = count.load(std::memory_order_relaxed);
+    s.loadFactor = (double)s.entries / s.capacity;
+    s.tableBytes = s.capacity * sizeof(Slot);
+    for (const auto& other : tables)
+        if (other.get() != &t) s.retiredBytes += (other->mask + 1) * sizeof(Slot);
+    s.allocatorBytes = fidBits.size() * sizeof(uint64_t);
+
+    size_t probeTotal = 0;
+    for (size_t i = 0; i <= t.mask; ++i) {
+        uint64_t k = t.slots[i].key.load(std::memory_order_relaxed);
+        if (!k) continue;
+        size_t probe = ((i - home(t, (uint32_t)k)) & t.mask) + 1;
+        probeTotal += probe;
+        s.maxProbe = std::max(s.maxProbe, probe);
+    }
+    s.meanProbe = s.entries ? (double)probeTotal / s.entries : 0.0;
+    for (size_t w = fidBits.size(); w-- > 0;) {
+        if (fidBits[w]) {
+            s.highestFid = (unsigned int)(w * 64 + 63 - std::countl_zero(fidBits[w]));
+            break;
+        }
+    }
+    return s;
+}
+
+std::string IdentityIndex::getLastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return lastError;
+}
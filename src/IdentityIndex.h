@@ -0,0 +1,107 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Who an enrolled FID belongs to. Packed to 12 bytes; with the FID a table
+// slot is 16.
+struct Identity {
+    uint32_t personId = 0;
+    uint8_t finger = 0xFF;   // 0-9 right thumb..left little (ISO 19794-2 order minus one), 0xFF unknown
+    uint8_t flags = 0;
+    uint16_t quality = 0;
+    uint32_t enrolledAt = 0; // unix seconds
+};
+
+struct IdentityIndexStats {
+    size_t entries = 0;
+    size_t capacity = 0;
+    double loadFactor = 0.0;
+    double meanProbe = 0.0;    // slots visited per successful lookup
+    size_t maxProbe = 0;
+    size_t tableBytes = 0;
+    size_t retiredBytes = 0;   // old tables kept for readers that may still be in them
+    size_t allocatorBytes = 0;
+    unsigned int highestFid = 0;
+
+    std::string summary() const;
+};
+
+// FID -> Identity as one flat open-addressing table (linear probing,
+// backward-shift deletes, so no tombstones), plus a bitmap allocator that
+// hands out the lowest free FID.
+//
+// find() takes no lock: writers are serialized on a mutex and bump a sequence
+// counter around each change, and a reader that saw it move retries. Tables
+// replaced by a resize stay allocated until the index is destroyed, since a
+// reader may still be probing one.
+//
+// As a GalleryListener it keeps FIDs enrolled without an identity out of the
+// allocator, and drops the identity when its template is removed.
+class IdentityIndex : public GalleryListener {
+public:
+    explicit IdentityIndex(size_t expectedEntries = 1024);
+    ~IdentityIndex();
+
+    unsigned int allocateFid();
+    void releaseFid(unsigned int fid);
+
+    // Inserts or replaces; also marks the FID as allocated. FID 0 is invalid.
+    bool put(unsigned int fid, const Identity& identity);
+    bool erase(unsigned int fid);
+    void clear();
+
+    // Lock-free; safe from any thread concurrently with writers
+    bool find(unsigned int fid, Identity& identity) const;
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+    // "ZKID" v1: header, the raw slot array, then the allocator bitmap.
+    // load() maps the file and copies the table in as is (no rehash).
+    bool save(const std::string& path);
+    bool load(const std::string& path);
+
+    void onTemplateAdded(unsigned int fid, const unsigned char* tpl, unsigned int size) override;
+    void onTemplateRemoved(unsigned int fid) override;
+    void onGalleryCleared() override;
+
+    IdentityIndexStats stats() const;
+    std::string getLastError() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> key{ 0 };   // fid | personId << 32; fid 0 = empty
+        std::atomic<uint64_t> value{ 0 }; // finger | flags << 8 | quality << 16 | enrolledAt << 32
+    };
+    struct Table {
+        explicit Table(unsigned int bits) : bits(bits), mask(((size_t)1 << bits) - 1), slots(new Slot[(size_t)1 << bits]) {}
+        unsigned int bits;
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    size_t home(const Table& t, unsigned int fid) const {
+        return (size_t)((fid * 0x9E3779B97F4A7C15ull) >> (64 - t.bits));
+    }
+    void beginWrite();
+    void endWrite();
+    bool insert(Table& t, uint64_t key, uint64_t value);
+    void grow();
+    void markFid(unsigned int fid);
+
+    std::atomic<Table*> table{ nullptr };
+    std::vector<std::unique_ptr<Table>> tables; // current is back(); the rest are retired
+    MemoryCharge tableCharge{ MemoryTag::Gallery };
+    std::atomic<uint64_t> sequence{ 0 };        // odd while a write is in progress
+    std::atomic<size_t> count{ 0 };
+
+    mutable std::mutex writeMutex;
+    TrackedVector<MemoryTag::Gallery, uint64_t> fidBits{ 1 }; // bit set = allocated; FID 0 is reserved
+    size_t firstFreeWord = 0;
+
+    mutable std::mutex errorMutex;
+    std::string lastError;
+};
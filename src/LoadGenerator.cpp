@@ -0,0 +1,459 @@
+#include "LoadGenerator.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <sstream>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t MaxEnrolledByRun = 32;     // older run enrollments are removed untimed
+constexpr auto DrainLimit = std::chrono::seconds(2); // open loop: how long a backlog may run past the end
+
+uint64_t micros(Clock::duration d) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    return us > 0 ? (uint64_t)us : 0;
+}
+
+double exponential(std::mt19937_64& rng, double mean) {
+    return std::exponential_distribution<double>(1.0 / mean)(rng);
+}
+
+void writeHistogram(FILE* out, const char* pad, const char* name, const LatencyHistogram& h, bool last) {
+    std::fprintf(out, "%s\"%s\": { \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f, \"mean\": %.3f }%s\n",
+                 pad, name, h.percentileMs(50.0), h.percentileMs(90.0), h.percentileMs(99.0), h.percentileMs(99.9),
+                 h.maxMs(), h.meanMs(), last ? "" : ",");
+}
+
+void writeOpStats(FILE* out, const std::string& pad, const char* name, const LoadOpStats& s, bool last) {
+    std::string inner = pad + "  ";
+    std::fprintf(out, "%s\"%s\": {\n", pad.c_str(), name);
+    std::fprintf(out, "%s\"completed\": %llu, \"correct\": %llu, \"falseMatches\": %llu, \"falseNonMatches\": %llu, \"errors\": %llu,\n",
+                 inner.c_str(), (unsigned long long)s.completed, (unsigned long long)s.correct,
+                 (unsigned long long)s.falseMatches, (unsigned long long)s.falseNonMatches, (unsigned long long)s.errors);
+    writeHistogram(out, inner.c_str(), "latencyMs", s.latency, false);
+    writeHistogram(out, inner.c_str(), "serviceMs", s.service, true);
+    std::fprintf(out, "%s}%s\n", pad.c_str(), last ? "" : ",");
+}
+
+void mergeStats(LoadOpStats& into, const LoadOpStats& from) {
+    into.completed += from.completed;
+    into.correct += from.correct;
+    into.falseMatches += from.falseMatches;
+    into.falseNonMatches += from.falseNonMatches;
+    into.errors += from.errors;
+    into.latency.merge(from.latency);
+    into.service.merge(from.service);
+}
+
+} // namespace
+
+const char* toString(LoadOp op) {
+    switch (op) {
+    case LoadOp::Identify: return "identify";
+    case LoadOp::Verify: return "verify";
+    case LoadOp::Enroll: return "enroll";
+    default: return "?";
+    }
+}
+
+const char* toString(LoadMode mode) {
+    return mode == LoadMode::Open ? "open" : "closed";
+}
+
+const char* toString(LoadBackend backend) {
+    return backend == LoadBackend::HandlePool ? "pool" : "device";
+}
+
+// ===== LatencyHistogram =====
+
+size_t LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < 128) return (size_t)us;
+    unsigned int shift = (unsigned int)std::bit_width(us) - 7; // us >> shift lands in [64, 128)
+    size_t index = 128 + (size_t)(shift - 1) * 64 + (size_t)((us >> shift) - 64);
+    return std::min(index, BucketCount - 1);
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t index) {
+    if (index < 128) return index;
+    unsigned int shift = (unsigned int)((index - 128) / 64) + 1;
+    uint64_t mantissa = (index - 128) % 64 + 64;
+    return (mantissa << shift) + ((uint64_t)1 << (shift - 1)); // bucket midpoint
+}
+
+void LatencyHistogram::record(uint64_t us) {
+    buckets[bucketOf(us)]++;
+    total++;
+    sumUs += (double)us;
+    maxUs = std::max(maxUs, us);
+}
+
+void LatencyHistogram::recordCorrected(uint64_t us, uint64_t expectedIntervalUs) {
+    record(us);
+    if (expectedIntervalUs == 0) return;
+    for (uint64_t missing = us; missing > expectedIntervalUs;) {
+        missing -= expectedIntervalUs;
+        record(missing);
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BucketCount; ++i) buckets[i] += other.buckets[i];
+    total += other.total;
+    sumUs += other.sumUs;
+    maxUs = std::max(maxUs, other.maxUs);
+}
+
+double LatencyHistogram::percentileMs(double q) const {
+    if (total == 0) return 0.0;
+    uint64_t rank = (uint64_t)std::ceil(std::clamp(q, 0.0, 100.0) / 100.0 * (double)total);
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(bucketValue(i), maxUs) / 1000.0;
+    }
+    return maxMs();
+}
+
+// ===== LoadReport =====
+
+std::string LoadReport::summary() const {
+    std::ostringstream oss;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%s loop, %s backend, %zu clients, gallery %zu, %.1f s measured: %llu requests, %.1f/s",
+                  toString(options.mode), toString(options.backend), options.clients, gallerySize, measuredSeconds,
+                  (unsigned long long)all.completed, throughput());
+    oss << line;
+    if (options.mode == LoadMode::Open) {
+        std::snprintf(line, sizeof(line), " (offered %.1f/s, %llu unfinished)", options.rate, (unsigned long long)unfinished);
+        oss << line;
+    }
+    oss << "\n";
+    for (size_t i = 0; i <= ops.size(); ++i) {
+        const LoadOpStats& s = i < ops.size() ? ops[i] : all;
+        if (s.completed == 0) continue;
+        std::snprintf(line, sizeof(line),
+                      "  %-8s %8llu  p50 %7.2f  p99 %7.2f  p99.9 %7.2f  max %7.2f ms (service p99 %.2f)  wrong %llu, errors %llu\n",
+                      i < ops.size() ? toString((LoadOp)i) : "all", (unsigned long long)s.completed,
+                      s.latency.percentileMs(50.0), s.latency.percentileMs(99.0), s.latency.percentileMs(99.9),
+                      s.latency.maxMs(), s.service.percentileMs(99.0),
+                      (unsigned long long)(s.falseMatches + s.falseNonMatches), (unsigned long long)s.errors);
+        oss << line;
+    }
+    return oss.str();
+}
+
+void LoadReport::writeJson(FILE* out, int indent) const {
+    std::string pad(indent, ' '), inner = pad + "  ";
+    std::fprintf(out, "%s{\n", pad.c_str());
+    std::fprintf(out, "%s\"mode\": \"%s\", \"backend\": \"%s\", \"clients\": %zu,\n", inner.c_str(),
+                 toString(options.mode), toString(options.backend), options.clients);
+    if (options.mode == LoadMode::Open)
+        std::fprintf(out, "%s\"rate\": %.3f, \"offered\": %llu, \"unfinished\": %llu,\n", inner.c_str(), options.rate,
+                     (unsigned long long)offered, (unsigned long long)unfinished);
+    else
+        std::fprintf(out, "%s\"thinkMs\": %.3f,\n", inner.c_str(), options.thinkMs);
+    std::fprintf(out, "%s\"mix\": { \"identify\": %g, \"verify\": %g, \"enroll\": %g }, \"matchRate\": %g,\n", inner.c_str(),
+                 options.mix[(size_t)LoadOp::Identify], options.mix[(size_t)LoadOp::Verify],
+                 options.mix[(size_t)LoadOp::Enroll], options.matchRate);
+    std::fprintf(out, "%s\"gallerySize\": %zu, \"impostorProbes\": %zu, \"seconds\": %.3f, \"throughput\": %.3f,\n",
+                 inner.c_str(), gallerySize, impostorProbes, measuredSeconds, throughput());
+    std::fprintf(out, "%s\"ops\": {\n", inner.c_str());
+    for (size_t i = 0; i < ops.size(); ++i)
+        writeOpStats(out, inner + "  ", toString((LoadOp)i), ops[i], i + 1 == ops.size());
+    std::fprintf(out, "%s},\n", inner.c_str());
+    writeOpStats(out, inner, "all", all, true);
+    std::fprintf(out, "%s}", pad.c_str());
+}
+
+// ===== LoadGenerator =====
+
+LoadGenerator::LoadGenerator(FingerprintDevice& device) : device(device) {}
+
+LoadGenerator::~LoadGenerator() {
+    restore();
+}
+
+bool LoadGenerator::prepare(size_t gallerySize, LoadBackend backend, size_t handleCount) {
+    restore();
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    std::vector<GalleryEntry> gallery = device.snapshotGallery();
+    if (gallery.empty()) {
+        lastError = "The gallery is empty; import one first.";
+        return false;
+    }
+    if (gallerySize == 0) gallerySize = std::max<size_t>(1, gallery.size() - gallery.size() / 10);
+    gallerySize = std::min(gallerySize, gallery.size());
+
+    for (size_t i = 0; i < gallery.size(); ++i) {
+        const GalleryEntry& e = gallery[i];
+        auto& list = i < gallerySize ? genuine : heldOut;
+        list.emplace_back(e.fid, std::vector<unsigned char>(e.data, e.data + e.size));
+        nextFid = std::max(nextFid, e.fid + 1);
+    }
+    // Held-out templates alternate between impostor probes and enroll supply
+    for (size_t i = 0; i < heldOut.size(); ++i) {
+        device.removeTemplate(heldOut[i].first);
+        (i % 2 == 0 ? impostors : enrollPool).push_back(i);
+    }
+
+    if (backend == LoadBackend::HandlePool) {
+        if (!handles.initialize(handleCount, device.snapshotGallery())) {
+            lastError = handles.getLastError();
+            return false;
+        }
+        device.addGalleryListener(&handles);
+        poolAttached = true;
+    }
+    return true;
+}
+
+void LoadGenerator::restore() {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    for (unsigned int fid : enrolledByRun) device.removeTemplate(fid);
+    enrolledByRun.clear();
+    for (const auto& [fid, tpl] : heldOut)
+        if (!device.isEnrolled(fid)) device.enrollTemplateAs(fid, tpl.data(), (unsigned int)tpl.size());
+    if (poolAttached) {
+        device.removeGalleryListener(&handles);
+        handles.release();
+        poolAttached = false;
+    }
+    genuine.clear();
+    heldOut.clear();
+    impostors.clear();
+    enrollPool.clear();
+    nextEnroll = 0;
+}
+
+LoadOp LoadGenerator::pickOp(std::mt19937_64& rng) const {
+    std::discrete_distribution<size_t> pick(options.mix.begin(), options.mix.end());
+    return (LoadOp)pick(rng);
+}
+
+LoadGenerator::Probe LoadGenerator::pickProbe(std::mt19937_64& rng, bool fromGallery) const {
+    if (fromGallery || impostors.empty()) {
+        size_t index = rng() % genuine.size();
+        return { &genuine[index].second, genuine[index].first, index };
+    }
+    return { &heldOut[impostors[rng() % impostors.size()]].second, 0, 0 };
+}
+
+void LoadGenerator::execute(LoadOp op, std::mt19937_64& rng, LoadOpStats& stats) {
+    if (op == LoadOp::Enroll) {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        const std::vector<unsigned char>& tpl = heldOut[enrollPool[nextEnroll++ % enrollPool.size()]].second;
+        while (device.isEnrolled(nextFid)) nextFid++;
+        if (device.enrollTemplateAs(nextFid, tpl.data(), (unsigned int)tpl.size())) {
+            enrolledByRun.push_back(nextFid++);
+            stats.correct++;
+        } else {
+            stats.errors++;
+        }
+        return;
+    }
+
+    bool fromGallery = std::bernoulli_distribution(options.matchRate)(rng);
+    Probe probe = pickProbe(rng, fromGallery);
+    const unsigned char* tpl = probe.tpl->data();
+    unsigned int size = (unsigned int)probe.tpl->size();
+    bool accepted;
+    unsigned int hitFid = 0;
+
+    if (op == LoadOp::Identify) {
+        unsigned int score = 0;
+        if (options.backend == LoadBackend::HandlePool) {
+            accepted = handles.identify(tpl, size, hitFid, score);
+        } else {
+            std::lock_guard<std::mutex> lock(deviceMutex);
+            accepted = device.identifyTemplate(tpl, size, hitFid, score);
+        }
+    } else {
+        // An impostor claims a random enrolled identity
+        const auto& claim = genuine[probe.fid ? probe.index : rng() % genuine.size()];
+        hitFid = claim.first;
+        int score = 0;
+        if (options.backend == LoadBackend::HandlePool) {
+            score = handles.match(tpl, size, claim.second.data(), (unsigned int)claim.second.size());
+        } else {
+            std::lock_guard<std::mutex> lock(deviceMutex);
+            if (!device.verifyTemplate(claim.first, tpl, size, score)) score = 0;
+        }
+        accepted = score >= options.verifyThreshold;
+    }
+
+    if (probe.fid == 0) {
+        if (accepted) stats.falseMatches++;
+        else stats.correct++;
+    } else if (!accepted) {
+        stats.falseNonMatches++;
+    } else if (hitFid != probe.fid) {
+        stats.falseMatches++;
+    } else {
+        stats.correct++;
+    }
+}
+
+// Keeps the gallery size steady; runs outside the timed section
+void LoadGenerator::trimEnrolled() {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    while (enrolledByRun.size() > MaxEnrolledByRun) {
+        device.removeTemplate(enrolledByRun.front());
+        enrolledByRun.pop_front();
+    }
+}
+
+bool LoadGenerator::run(const LoadOptions& runOptions, LoadReport& report) {
+    if (genuine.empty()) {
+        lastError = "prepare() has not been called.";
+        return false;
+    }
+    options = runOptions;
+    options.clients = std::max<size_t>(options.clients, 1);
+    if (options.mix[(size_t)LoadOp::Enroll] > 0.0 && enrollPool.empty()) {
+        lastError = "Enroll traffic needs held-out templates; use a gallery size below the imported count.";
+        return false;
+    }
+    if (options.mode == LoadMode::Open && options.rate <= 0.0) {
+        lastError = "Open loop needs a positive rate.";
+        return false;
+    }
+    if (options.backend == LoadBackend::HandlePool && !poolAttached) {
+        lastError = "The handle pool backend was not prepared.";
+        return false;
+    }
+    report = LoadReport();
+    report.options = options;
+    report.gallerySize = genuine.size();
+    report.impostorProbes = impostors.size();
+
+    std::vector<ClientResult> results(options.clients);
+    if (options.mode == LoadMode::Open) runOpen(results, report);
+    else runClosed(results);
+
+    report.measuredSeconds = std::max(0.0, options.seconds - options.warmupSeconds);
+    for (const ClientResult& r : results)
+        for (size_t i = 0; i < r.ops.size(); ++i) {
+            mergeStats(report.ops[i], r.ops[i]);
+            mergeStats(report.all, r.ops[i]);
+        }
+    return true;
+}
+
+void LoadGenerator::runOpen(std::vector<ClientResult>& results, LoadReport& report) {
+    struct Job {
+        Clock::time_point due;
+        LoadOp op;
+    };
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<Job> queue;
+    bool dispatching = true;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmupSeconds));
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < options.clients; ++c) {
+        clients.emplace_back([&, c] {
+            std::mt19937_64 rng(options.seed * 1000003 + c + 1);
+            ClientResult& result = results[c];
+            LoadOpStats scratch; // outcomes of warm-up requests, dropped
+            for (;;) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    queueReady.wait(lock, [&] { return !queue.empty() || !dispatching; });
+                    if (queue.empty() || Clock::now() > end + DrainLimit) return;
+                    job = queue.front();
+                    queue.pop_front();
+                }
+                LoadOpStats& stats = result.ops[(size_t)job.op];
+                scratch.clearCounts();
+                Clock::time_point picked = Clock::now();
+                execute(job.op, rng, job.due >= measureFrom ? stats : scratch);
+                Clock::time_point finished = Clock::now();
+                if (job.due >= measureFrom) {
+                    stats.completed++;
+                    stats.latency.record(micros(finished - job.due));
+                    stats.service.record(micros(finished - picked));
+                }
+                if (job.op == LoadOp::Enroll) trimEnrolled();
+            }
+        });
+    }
+
+    // Arrival times are drawn up front from the schedule, never from when the previous request finished
+    std::mt19937_64 rng(options.seed);
+    double meanGap = 1.0 / options.rate;
+    Clock::time_point due = start;
+    for (;;) {
+        due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(exponential(rng, meanGap)));
+        if (due >= end) break;
+        std::this_thread::sleep_until(due);
+        LoadOp op = pickOp(rng);
+        if (due >= measureFrom) report.offered++;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            queue.push_back({ due, op });
+        }
+        queueReady.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        dispatching = false;
+    }
+    queueReady.notify_all();
+    for (std::thread& t : clients) t.join();
+    for (const Job& job : queue) report.unfinished += job.due >= measureFrom;
+}
+
+void LoadGenerator::runClosed(std::vector<ClientResult>& results) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmupSeconds));
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < options.clients; ++c) {
+        clients.emplace_back([&, c] {
+            std::mt19937_64 rng(options.seed * 1000003 + c + 1);
+            ClientResult& result = results[c];
+            // A closed-loop client sends nothing while it waits, so a stall hides
+            // the requests it would have sent; the correction assumes it would
+            // otherwise have kept its usual cycle (think time + mean service so
+            // far). Without think time there is no intended cadence to keep, so
+            // latency is recorded as measured.
+            double serviceSumUs = 0.0;
+            uint64_t serviceCount = 0;
+            LoadOpStats scratch; // outcomes of warm-up requests, dropped
+            for (;;) {
+                if (options.thinkMs > 0.0)
+                    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(exponential(rng, options.thinkMs)));
+                scratch.clearCounts();
+                Clock::time_point started = Clock::now();
+                if (started >= end) return;
+                LoadOp op = pickOp(rng);
+                LoadOpStats& stats = result.ops[(size_t)op];
+                execute(op, rng, started >= measureFrom ? stats : scratch);
+                uint64_t us = micros(Clock::now() - started);
+                uint64_t pace = serviceCount && options.thinkMs > 0.0
+                    ? (uint64_t)(options.thinkMs * 1000.0 + serviceSumUs / serviceCount) : 0;
+                serviceSumUs += (double)us;
+                serviceCount++;
+                if (started >= measureFrom) {
+                    stats.completed++;
+                    stats.service.record(us);
+                    stats.latency.recordCorrected(us, pace);
+                }
+                if (op == LoadOp::Enroll) trimEnrolled();
+            }
+        });
+    }
+    for (std::thread& t : clients) t.join();
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include "DbHandlePool.h"
+#include "FingerprintDevice.h"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// Latencies in microseconds, log-linear buckets: exact below 128 us, then 64
+// sub-buckets per power of two (under 1.6% error) up to ~12 days.
+class LatencyHistogram {
+public:
+    void record(uint64_t us);
+    // Coordinated-omission correction for a client that meant to issue a
+    // request every expectedIntervalUs: a stall of `us` also hid the requests
+    // that would have been sent meanwhile, so they are recorded as having
+    // waited us - interval, us - 2 * interval, ...
+    void recordCorrected(uint64_t us, uint64_t expectedIntervalUs);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return total; }
+    double percentileMs(double q) const; // q in [0, 100]
+    double meanMs() const { return total ? sumUs / total / 1000.0 : 0.0; }
+    double maxMs() const { return maxUs / 1000.0; }
+
+private:
+    static constexpr size_t BucketCount = 128 + 34 * 64;
+    static size_t bucketOf(uint64_t us);
+    static uint64_t bucketValue(size_t index);
+
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(BucketCount, 0);
+    uint64_t total = 0;
+    uint64_t maxUs = 0;
+    double sumUs = 0.0;
+};
+
+enum class LoadOp { Identify, Verify, Enroll, Count };
+enum class LoadMode {
+    Open,   // Poisson arrivals at a fixed rate, whether or not earlier requests finished
+    Closed  // each client waits for its reply, thinks, then sends the next
+};
+enum class LoadBackend {
+    Device,     // FingerprintDevice under one mutex, as the demo calls it
+    HandlePool  // identify/verify on a DbHandlePool mirroring the device gallery
+};
+
+const char* toString(LoadOp op);
+const char* toString(LoadMode mode);
+const char* toString(LoadBackend backend);
+
+struct LoadOptions {
+    LoadMode mode = LoadMode::Closed;
+    LoadBackend backend = LoadBackend::Device;
+    size_t clients = 8;
+    double rate = 100.0;         // open loop: requests per second across all clients
+    double thinkMs = 0.0;        // closed loop: mean exponential pause between requests
+    std::array<double, (size_t)LoadOp::Count> mix{ 1.0, 0.0, 0.0 }; // relative weights
+    double matchRate = 0.8;      // share of identify/verify probes taken from the gallery
+    double seconds = 10.0;
+    double warmupSeconds = 1.0;  // requests started during warm-up are not recorded
+    uint64_t seed = 1;
+    int verifyThreshold = 55;
+};
+
+struct LoadOpStats {
+    uint64_t completed = 0;
+    uint64_t correct = 0;       // expected outcome (hit on the right FID, or no hit for an impostor)
+    uint64_t falseMatches = 0;  // impostor probe accepted, or genuine probe hit another FID
+    uint64_t falseNonMatches = 0;
+    uint64_t errors = 0;        // enroll failures
+    LatencyHistogram latency;   // corrected: from intended start (open), or backfilled for stalls (closed)
+    LatencyHistogram service;   // raw: from when a client actually picked the request up
+
+    // The outcome counters only; the histograms are left as they are
+    void clearCounts() { completed = correct = falseMatches = falseNonMatches = errors = 0; }
+};
+
+struct LoadReport {
+    LoadOptions options;
+    size_t gallerySize = 0;
+    size_t impostorProbes = 0;
+    double measuredSeconds = 0.0;
+    uint64_t offered = 0;        // open loop: arrivals scheduled in the measured window
+    uint64_t unfinished = 0;     // open loop: still queued when the drain deadline passed
+    std::array<LoadOpStats, (size_t)LoadOp::Count> ops;
+    LoadOpStats all;
+
+    double throughput() const { return measuredSeconds > 0.0 ? all.completed / measuredSeconds : 0.0; }
+    std::string summary() const;
+    void writeJson(FILE* out, int indent = 0) const;
+};
+
+// Synthetic identify/verify/enroll traffic against a FingerprintDevice, for
+// capacity numbers before rollout.
+//
+// prepare() keeps the first gallerySize enrolled templates and removes the
+// rest: those become impostor probes (held out, so they should not match) and
+// the supply for enroll requests. Genuine probes are copies of enrolled
+// templates, so on real data identify scores are optimistic; the point is
+// the cost of the search, which depends on gallery size, not probe quality.
+//
+// Open loop measures latency from when each request was due, so a backlog
+// shows up in the percentiles instead of silently lowering the send rate.
+class LoadGenerator {
+public:
+    explicit LoadGenerator(FingerprintDevice& device);
+    ~LoadGenerator();
+    LoadGenerator(const LoadGenerator&) = delete;
+    LoadGenerator& operator=(const LoadGenerator&) = delete;
+
+    // gallerySize 0 keeps 90% of the enrolled templates
+    bool prepare(size_t gallerySize, LoadBackend backend, size_t handles);
+    // Removes what the run enrolled and restores the held-out templates
+    void restore();
+
+    bool run(const LoadOptions& options, LoadReport& report);
+    std::string getLastError() const { return lastError; }
+
+private:
+    struct Probe {
+        const std::vector<unsigned char>* tpl;
+        unsigned int fid; // expected FID, 0 for an impostor
+        size_t index;     // into genuine, when fid != 0
+    };
+    struct ClientResult {
+        std::array<LoadOpStats, (size_t)LoadOp::Count> ops;
+    };
+
+    LoadOp pickOp(std::mt19937_64& rng) const;
+    Probe pickProbe(std::mt19937_64& rng, bool fromGallery) const;
+    void execute(LoadOp op, std::mt19937_64& rng, LoadOpStats& stats);
+    void trimEnrolled();
+    void runOpen(std::vector<ClientResult>& results, LoadReport& report);
+    void runClosed(std::vector<ClientResult>& results);
+
+    FingerprintDevice& device;
+    std::mutex deviceMutex; // FingerprintDevice is not thread-safe
+    DbHandlePool handles;
+    bool poolAttached = false;
+
+    LoadOptions options;
+    std::vector<std::pair<unsigned int, std::vector<unsigned char>>> genuine;
+    std::vector<std::pair<unsigned int, std::vector<unsigned char>>> heldOut; // original FIDs, for restore()
+    std::vector<size_t> impostors;  // indices into heldOut
+    std::vector<size_t> enrollPool; // indices into heldOut
+    size_t nextEnroll = 0;
+    std::deque<unsigned int> enrolledByRun;
+    unsigned int nextFid = 1;
+
+    std::string lastError;
+};
@@ -0,0 +1,174 @@
+#include "FingerprintDevice.h"
+#include "GalleryTransfer.h"
+#include "LoadGenerator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Synthetic identify/verify/enroll load against a loaded gallery.
+//
+//   load_tool --gallery <dump> [--format jsonl|csv|bin] [--gallery-size N]
+//             [--open --rate R | --closed [--think ms]] [--clients N]
+//             [--mix identify:verify:enroll] [--match-rate F]
+//             [--backend device|pool] [--handles N]
+//             [--seconds S] [--warmup S] [--seed N] [--json <file>]
+//             [--find-max <p99 ms>]
+//
+// --find-max runs open loop from --rate upwards (x1.5 per step) and reports
+// the highest rate whose corrected p99 stays under the target with no backlog.
+
+static void printUsage() {
+    std::printf("Usage: load_tool --gallery <dump> [--format jsonl|csv|bin] [--gallery-size N]\n"
+                "                 [--open --rate R | --closed [--think ms]] [--clients N]\n"
+                "                 [--mix identify:verify:enroll] [--match-rate F]\n"
+                "                 [--backend device|pool] [--handles N]\n"
+                "                 [--seconds S] [--warmup S] [--seed N] [--json <file>]\n"
+                "                 [--find-max <p99 ms>]\n");
+}
+
+static bool parseMix(const std::string& text, LoadOptions& options) {
+    double weights[3] = { 0.0, 0.0, 0.0 };
+    int parsed = std::sscanf(text.c_str(), "%lf:%lf:%lf", &weights[0], &weights[1], &weights[2]);
+    if (parsed < 1 || weights[0] < 0.0 || weights[1] < 0.0 || weights[2] < 0.0) return false;
+    if (weights[0] + weights[1] + weights[2] <= 0.0) return false;
+    for (int i = 0; i < 3; ++i) options.mix[i] = weights[i];
+    return true;
+}
+
+// A step passes when its corrected p99 is under target and the box kept up with the offered rate
+static bool sustained(const LoadReport& report, double p99Ms) {
+    return report.all.latency.percentileMs(99.0) <= p99Ms && report.unfinished == 0 &&
+           report.throughput() >= 0.9 * report.options.rate;
+}
+
+int main(int argc, char** argv) {
+    std::string galleryPath, formatName, jsonPath;
+    size_t gallerySize = 0, handleCount = 0;
+    double findMaxP99 = 0.0;
+    LoadOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--gallery") galleryPath = next();
+        else if (arg == "--format") formatName = next();
+        else if (arg == "--gallery-size") gallerySize = (size_t)std::strtoull(next().c_str(), nullptr, 10);
+        else if (arg == "--open") options.mode = LoadMode::Open;
+        else if (arg == "--closed") options.mode = LoadMode::Closed;
+        else if (arg == "--rate") options.rate = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--think") options.thinkMs = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--clients") options.clients = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--match-rate") options.matchRate = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--handles") handleCount = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--seconds") options.seconds = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--warmup") options.warmupSeconds = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--seed") options.seed = std::strtoull(next().c_str(), nullptr, 10);
+        else if (arg == "--json") jsonPath = next();
+        else if (arg == "--find-max") findMaxP99 = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--mix") {
+            if (!parseMix(next(), options)) {
+                std::fprintf(stderr, "--mix takes non-negative weights identify:verify:enroll\n");
+                return 1;
+            }
+        } else if (arg == "--backend") {
+            std::string name = next();
+            if (name == "device") options.backend = LoadBackend::Device;
+            else if (name == "pool") options.backend = LoadBackend::HandlePool;
+            else {
+                printUsage();
+                return 1;
+            }
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (galleryPath.empty() || options.seconds <= options.warmupSeconds) {
+        printUsage();
+        return 1;
+    }
+    GalleryFormat format = guessGalleryFormat(galleryPath);
+    if (!formatName.empty() && !parseGalleryFormat(formatName, format)) {
+        std::fprintf(stderr, "Unknown format: %s\n", formatName.c_str());
+        return 1;
+    }
+
+    FingerprintDevice fp;
+    if (!fp.initialize()) {
+        std::fprintf(stderr, "%s\n", fp.getLastError().c_str());
+        return 1;
+    }
+    GalleryImporter importer(fp);
+    TransferStats stats;
+    if (!importer.run(galleryPath, format, "", stats)) {
+        std::fprintf(stderr, "Import failed: %s\n", importer.getLastError().c_str());
+        fp.terminate();
+        return 1;
+    }
+
+    int rc = 0;
+    {
+        LoadGenerator generator(fp);
+        if (!generator.prepare(gallerySize, options.backend, handleCount ? handleCount : options.clients)) {
+            std::fprintf(stderr, "%s\n", generator.getLastError().c_str());
+            rc = 1;
+        } else if (findMaxP99 > 0.0) {
+            std::vector<LoadReport> steps;
+            options.mode = LoadMode::Open;
+            double bestRate = 0.0;
+            for (int step = 0; step < 20; ++step, options.rate *= 1.5) {
+                LoadReport report;
+                if (!generator.run(options, report)) {
+                    std::fprintf(stderr, "%s\n", generator.getLastError().c_str());
+                    rc = 1;
+                    break;
+                }
+                std::printf("%s", report.summary().c_str());
+                std::fflush(stdout);
+                bool ok = sustained(report, findMaxP99);
+                steps.push_back(report);
+                if (!ok) break;
+                bestRate = options.rate;
+            }
+            std::printf("max sustainable rate at p99 <= %.2f ms: %.1f/s\n", findMaxP99, bestRate);
+
+            if (!jsonPath.empty() && rc == 0) {
+                FILE* out = std::fopen(jsonPath.c_str(), "w");
+                if (!out) {
+                    std::fprintf(stderr, "Cannot write %s\n", jsonPath.c_str());
+                    rc = 1;
+                } else {
+                    std::fprintf(out, "{\n  \"targetP99Ms\": %.3f,\n  \"maxRate\": %.3f,\n  \"steps\": [\n", findMaxP99, bestRate);
+                    for (size_t i = 0; i < steps.size(); ++i) {
+                        steps[i].writeJson(out, 4);
+                        std::fprintf(out, "%s\n", i + 1 < steps.size() ? "," : "");
+                    }
+                    std::fprintf(out, "  ]\n}\n");
+                    std::fclose(out);
+                }
+            }
+        } else {
+            LoadReport report;
+            if (!generator.run(options, report)) {
+                std::fprintf(stderr, "%s\n", generator.getLastError().c_str());
+                rc = 1;
+            } else {
+                std::printf("%s", report.summary().c_str());
+                if (!jsonPath.empty()) {
+                    FILE* out = std::fopen(jsonPath.c_str(), "w");
+                    if (!out) {
+                        std::fprintf(stderr, "Cannot write %s\n", jsonPath.c_str());
+                        rc = 1;
+                    } else {
+                        report.writeJson(out);
+                        std::fprintf(out, "\n");
+                        std::fclose(out);
+                    }
+                }
+            }
+        }
+    }
+    fp.terminate();
+    return rc;
+}
@@ -0,0 +1,366 @@
+#include "MatchEvaluator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+void ScoreHistogram::add(int score, uint64_t count) {
+    if (score < 0) {
+        errors[score] += count;
+        return;
+    }
+    bins[std::min(score, MaxScore)] += count;
+    total += count;
+}
+
+void ScoreHistogram::merge(const ScoreHistogram& other) {
+    for (int b = 0; b <= MaxScore; ++b) bins[b] += other.bins[b];
+    total += other.total;
+    for (const auto& [code, count] : other.errors) errors[code] += count;
+}
+
+void ScoreHistogram::clear() {
+    std::fill(bins.begin(), bins.end(), 0);
+    total = 0;
+    errors.clear();
+}
+
+uint64_t ScoreHistogram::errorCount() const {
+    uint64_t count = 0;
+    for (const auto& [code, n] : errors) count += n;
+    return count;
+}
+
+MatchEvaluator::MatchEvaluator(WorkerPool& pool) : pool(pool) {}
+
+MatchEvaluator::~MatchEvaluator() {
+    release();
+}
+
+bool MatchEvaluator::initialize() {
+    release();
+    for (size_t i = 0; i < pool.size(); ++i) {
+        HANDLE h = ZKFPM_DBInit();
+        if (!h) {
+            lastError = "Failed to create DB cache for evaluation worker " + std::to_string(i) + ".";
+            release();
+            return false;
+        }
+        handles.push_back(h);
+    }
+    return true;
+}
+
+void MatchEvaluator::release() {
+    for (HANDLE h : handles) ZKFPM_DBFree(h);
+    handles.clear();
+}
+
+bool MatchEvaluator::loadManifest(const std::string& path, std::vector<CorpusSample>& samples, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "Cannot open manifest: " + path;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        size_t comma = line.find(',');
+        if (comma == std::string::npos || comma == 0 || comma + 1 == line.size()) continue;
+        samples.push_back({ line.substr(0, comma), line.substr(comma + 1) });
+    }
+    if (samples.empty()) {
+        error = "Manifest has no samples: " + path;
+        return false;
+    }
+    return true;
+}
+
+// ===== Extraction (once per sample) =====
+
+bool MatchEvaluator::extract(const std::vector<CorpusSample>& corpus) {
+    if (handles.empty()) {
+        lastError = "Evaluator not initialized.";
+        return false;
+    }
+
+    std::vector<std::vector<unsigned char>> extracted(corpus.size());
+    pool.parallelFor(corpus.size(), [&](size_t begin, size_t end) {
+        HANDLE h = handles[pool.currentWorker()];
+        std::vector<unsigned char> buf(MAX_TEMPLATE_SIZE);
+        for (size_t i = begin; i < end; ++i) {
+            unsigned int size = (unsigned int)buf.size();
+            if (ZKFPM_ExtractFromImage(h, corpus[i].imagePath.c_str(), dpi, buf.data(), &size) == ZKFP_ERR_OK && size > 0)
+                extracted[i].assign(buf.begin(), buf.begin() + size);
+        }
+    }, TaskPriority::Low);
+
+    std::unordered_map<std::string, uint32_t> labels;
+    templates.clear();
+    samples.clear();
+    failedToEnroll = 0;
+    corpusHash = 1469598103934665603ull;
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        if (extracted[i].empty()) {
+            failedToEnroll++;
+            continue;
+        }
+        uint32_t label = labels.emplace(corpus[i].subject, (uint32_t)labels.size()).first->second;
+        TemplateArena::Handle handle = templates.add(extracted[i].data(), (unsigned int)extracted[i].size());
+        samples.push_back({ label, handle });
+        corpusHash = (corpusHash ^ label) * 1099511628211ull;
+        corpusHash = (corpusHash ^ TemplateArena::hashBytes(extracted[i].data(), (unsigned int)extracted[i].size())) * 1099511628211ull;
+        std::vector<unsigned char>().swap(extracted[i]);
+    }
+    if (samples.size() < 2) {
+        lastError = "Need at least two extractable samples.";
+        return false;
+    }
+    return true;
+}
+
+// ===== All-pairs scoring =====
+
+bool MatchEvaluator::score(const std::string& checkpointPath) {
+    if (handles.empty() || samples.size() < 2) {
+        lastError = "Nothing to score (call initialize() and extract() first).";
+        return false;
+    }
+    genuine = ScoreHistogram();
+    impostor = ScoreHistogram();
+
+    size_t n = samples.size();
+    size_t blocks = (n + tileSize - 1) / tileSize;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t bi = 0; bi < blocks; ++bi)
+        for (size_t bj = bi; bj < blocks; ++bj) tiles.emplace_back(bi, bj);
+    std::vector<char> done(tiles.size(), 0);
+
+    std::ostringstream hdr;
+    hdr << "EVAL 2 " << n << " " << tileSize << " " << corpusHash;
+    std::string header = hdr.str();
+
+    // ---- Resume: each line is one finished tile with sparse histogram deltas ----
+    // "T <tile> <genuineBins> (<bin> <count>)... <impostorBins> (<bin> <count>)..."
+    // where a negative bin is an SDK error code
+    bool resume = false;
+    if (!checkpointPath.empty()) {
+        std::ifstream in(checkpointPath);
+        std::string line;
+        if (in && std::getline(in, line) && line == header) {
+            resume = true;
+            while (std::getline(in, line)) {
+                std::istringstream ls(line);
+                char kind = 0;
+                size_t idx = 0, count = 0;
+                if (!(ls >> kind >> idx) || kind != 'T' || idx >= tiles.size()) continue;
+                ScoreHistogram g, im;
+                bool ok = true;
+                for (ScoreHistogram* h : { &g, &im }) {
+                    ok = ok && (bool)(ls >> count);
+                    for (size_t k = 0; ok && k < count; ++k) {
+                        int bin;
+                        uint64_t c;
+                        ok = (bool)(ls >> bin >> c);
+                        if (ok) h->add(bin, c);
+                    }
+                }
+                if (!ok || done[idx]) continue; // torn line from an interrupted write
+                done[idx] = 1;
+                genuine.merge(g);
+                impostor.merge(im);
+            }
+        }
+    }
+
+    std::ofstream checkpoint;
+    if (!checkpointPath.empty()) {
+        checkpoint.open(checkpointPath, resume ? std::ios::app : std::ios::trunc);
+        if (!checkpoint) {
+            lastError = "Cannot write checkpoint file: " + checkpointPath;
+            return false;
+        }
+        if (!resume) checkpoint << header << "\n" << std::flush;
+    }
+
+    // Tiles run as short strips of rows, as in DuplicateDetector::audit, so a
+    // background evaluation never holds a worker for long and High or pinned
+    // tasks get in between strips. Each tile's histograms are collected until
+    // its last strip is done, then merged and checkpointed as one 'T' line.
+    struct Strip {
+        size_t tile, rowBegin, rowEnd;
+    };
+    struct Partial {
+        size_t stripsLeft = 0;
+        ScoreHistogram genuine, impostor;
+    };
+    size_t stripRows = std::max<size_t>(1, StripComparisons / tileSize);
+    std::unordered_map<size_t, Partial> partial; // tiles in progress; inserted between rounds only
+    std::mutex mergeMutex;
+
+    size_t tileCursor = 0, rowCursor = 0;
+    auto nextStrip = [&](Strip& strip) {
+        for (; tileCursor < tiles.size(); ++tileCursor, rowCursor = 0) {
+            if (done[tileCursor]) continue;
+            size_t iBegin = tiles[tileCursor].first * tileSize, iEnd = std::min(n, iBegin + tileSize);
+            if (rowCursor == 0) {
+                rowCursor = iBegin;
+                partial[tileCursor].stripsLeft = (iEnd - iBegin + stripRows - 1) / stripRows;
+            }
+            if (rowCursor < iEnd) {
+                strip = { tileCursor, rowCursor, std::min(iEnd, rowCursor + stripRows) };
+                rowCursor = strip.rowEnd;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Per-worker strip histograms, reused across strips
+    std::vector<ScoreHistogram> stripGenuine(pool.size()), stripImpostor(pool.size());
+    std::vector<Strip> round;
+    for (;;) {
+        // One strip per task; a round is just enough to keep every worker busy
+        round.clear();
+        Strip strip;
+        while (round.size() < pool.size() * 4 && nextStrip(strip)) round.push_back(strip);
+        if (round.empty()) break;
+
+        pool.parallelFor(round.size(), [&](size_t begin, size_t end) {
+            int worker = pool.currentWorker();
+            HANDLE h = handles[worker];
+            ScoreHistogram& g = stripGenuine[worker];
+            ScoreHistogram& im = stripImpostor[worker];
+            for (size_t r = begin; r < end; ++r) {
+                const Strip& s = round[r];
+                size_t jBegin = tiles[s.tile].second * tileSize, jEnd = std::min(n, jBegin + tileSize);
+                g.clear();
+                im.clear();
+                for (size_t i = s.rowBegin; i < s.rowEnd; ++i) {
+                    const unsigned char* a;
+                    unsigned int sa;
+                    templates.get(samples[i].handle, a, sa);
+                    for (size_t j = std::max(jBegin, i + 1); j < jEnd; ++j) {
+                        const unsigned char* b;
+                        unsigned int sb;
+                        templates.get(samples[j].handle, b, sb);
+                        int score = ZKFPM_DBMatch(h, const_cast<unsigned char*>(a), sa, const_cast<unsigned char*>(b), sb);
+                        (samples[i].label == samples[j].label ? g : im).add(score);
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                Partial& tile = partial.at(s.tile);
+                tile.genuine.merge(g);
+                tile.impostor.merge(im);
+                if (--tile.stripsLeft > 0) continue;
+
+                std::ostringstream line;
+                line << "T " << s.tile;
+                for (ScoreHistogram* hist : { &tile.genuine, &tile.impostor }) {
+                    size_t used = std::count_if(hist->bins.begin(), hist->bins.end(), [](uint64_t c) { return c != 0; });
+                    line << " " << used + hist->errors.size();
+                    for (const auto& [code, count] : hist->errors) line << " " << code << " " << count;
+                    for (int b = 0; b <= ScoreHistogram::MaxScore; ++b)
+                        if (hist->bins[b]) line << " " << b << " " << hist->bins[b];
+                }
+                genuine.merge(tile.genuine);
+                impostor.merge(tile.impostor);
+                if (checkpoint.is_open()) checkpoint << line.str() << "\n" << std::flush;
+                // Erasing leaves every other tile's entry where it is
+                partial.erase(s.tile);
+            }
+        }, TaskPriority::Low, 1);
+    }
+    return true;
+}
+
+// ===== Results =====
+
+std::vector<DetPoint> MatchEvaluator::detCurve() const {
+    std::vector<DetPoint> curve;
+    if (genuine.total == 0 || impostor.total == 0) return curve;
+    uint64_t impostorAbove = impostor.total; // scores >= t
+    uint64_t genuineBelow = 0;               // scores < t
+    for (int t = 0; t <= ScoreHistogram::MaxScore + 1; ++t) {
+        curve.push_back({ t, (double)impostorAbove / impostor.total, (double)genuineBelow / genuine.total });
+        if (t <= ScoreHistogram::MaxScore) {
+            impostorAbove -= impostor.bins[t];
+            genuineBelow += genuine.bins[t];
+        }
+    }
+    return curve;
+}
+
+double MatchEvaluator::equalErrorRate(int& threshold) const {
+    auto curve = detCurve();
+    double best = 2.0, eer = 1.0;
+    threshold = 0;
+    for (const auto& p : curve) {
+        double gap = std::fabs(p.far - p.frr);
+        if (gap < best) {
+            best = gap;
+            eer = (p.far + p.frr) / 2.0;
+            threshold = p.threshold;
+        }
+    }
+    return eer;
+}
+
+ThresholdPick MatchEvaluator::thresholdForFar(double targetFar) const {
+    for (const auto& p : detCurve())
+        if (p.far <= targetFar) return { targetFar, p.threshold, p.far, p.frr };
+    return { targetFar, ScoreHistogram::MaxScore + 1, 0.0, 1.0 };
+}
+
+bool MatchEvaluator::writeDetCsv(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    out << "threshold,far,frr,genuine,impostor\n";
+    auto curve = detCurve();
+    for (const auto& p : curve) {
+        uint64_t g = p.threshold <= ScoreHistogram::MaxScore ? genuine.bins[p.threshold] : 0;
+        uint64_t im = p.threshold <= ScoreHistogram::MaxScore ? impostor.bins[p.threshold] : 0;
+        out << p.threshold << "," << p.far << "," << p.frr << "," << g << "," << im << "\n";
+    }
+    return (bool)out;
+}
+
+std::string MatchEvaluator::report() const {
+    std::ostringstream oss;
+    oss << "Samples: " << samples.size() << " (failed to enroll: " << failedToEnroll << ")\n";
+    oss << "Genuine pairs: " << genuine.total << ", impostor pairs: " << impostor.total << "\n";
+    if (genuine.errorCount() || impostor.errorCount()) {
+        // Not in the rates below: a failed match is neither a reject nor an accept
+        oss << "Match errors (excluded): " << genuine.errorCount() << " genuine, " << impostor.errorCount()
+            << " impostor pairs;";
+        std::map<int, uint64_t> codes = genuine.errors;
+        for (const auto& [code, count] : impostor.errors) codes[code] += count;
+        for (const auto& [code, count] : codes) oss << " code " << code << " x " << count;
+        oss << "\n";
+    }
+    if (genuine.total == 0 || impostor.total == 0) {
+        oss << "Need both genuine and impostor pairs for error rates.\n";
+        return oss.str();
+    }
+    int eerThreshold = 0;
+    double eer = equalErrorRate(eerThreshold);
+    char line[160];
+    std::snprintf(line, sizeof(line), "EER: %.4f%% at threshold %d\n", 100.0 * eer, eerThreshold);
+    oss << line;
+    for (double target : { 1e-2, 1e-3, 1e-4, 1e-5 }) {
+        ThresholdPick p = thresholdForFar(target);
+        std::snprintf(line, sizeof(line), "FAR <= %g: threshold %d (FAR %.6f, FRR %.4f%%)\n",
+                      target, p.threshold, p.far, 100.0 * p.frr);
+        oss << line;
+    }
+    ThresholdPick oneToOne = thresholdForFar(1e-4);
+    ThresholdPick oneToN = thresholdForFar(1e-5);
+    oss << "Recommended: FP_THRESHOLD_CODE (1:1) = " << oneToOne.threshold
+        << ", FP_MTHRESHOLD_CODE (1:N) = " << oneToN.threshold << "\n";
+    return oss.str();
+}
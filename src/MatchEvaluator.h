@@ -0,0 +1,97 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "TemplateArena.h"
+#include "WorkerPool.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// One labelled sample of the evaluation corpus
+struct CorpusSample {
+    std::string subject; // same subject + finger = genuine pair
+    std::string imagePath;
+};
+
+struct ScoreHistogram {
+    static constexpr int MaxScore = 1000; // DBMatch scores above this share the top bin
+    std::vector<uint64_t> bins = std::vector<uint64_t>(MaxScore + 1, 0);
+    uint64_t total = 0;                   // scored pairs (errors not included)
+    std::map<int, uint64_t> errors;       // negative DBMatch results: SDK error code -> pairs
+
+    // A negative score is an SDK error code and is counted apart from the bins
+    void add(int score, uint64_t count = 1);
+    void merge(const ScoreHistogram& other);
+    void clear();
+    uint64_t errorCount() const;
+};
+
+struct DetPoint {
+    int threshold;
+    double far; // impostor scores >= threshold
+    double frr; // genuine scores < threshold
+};
+
+struct ThresholdPick {
+    double targetFar;
+    int threshold;
+    double far;
+    double frr;
+};
+
+// Genuine/impostor score evaluation for tuning FP_THRESHOLD_CODE and
+// FP_MTHRESHOLD_CODE. Templates are extracted once (in parallel), then every
+// pair is scored with ZKFPM_DBMatch in square tiles across the shared pool,
+// one DB handle per worker. Scores go straight into histograms; finished
+// tiles are appended to a checkpoint so a long run can be resumed. Pairs the
+// SDK fails to score are counted by error code and left out of the rates.
+class MatchEvaluator {
+public:
+    explicit MatchEvaluator(WorkerPool& pool = WorkerPool::shared());
+    ~MatchEvaluator();
+
+    bool initialize();
+    void release();
+    std::string getLastError() const { return lastError; }
+
+    void setTileSize(size_t size) { tileSize = size ? size : 1; }
+    void setDpi(unsigned int value) { dpi = value; }
+
+    // "subject,imagePath" per line; lines starting with '#' are ignored
+    static bool loadManifest(const std::string& path, std::vector<CorpusSample>& samples, std::string& error);
+
+    bool extract(const std::vector<CorpusSample>& samples);
+    bool score(const std::string& checkpointPath);
+
+    const ScoreHistogram& getGenuine() const { return genuine; }
+    const ScoreHistogram& getImpostor() const { return impostor; }
+    size_t getFailedToEnroll() const { return failedToEnroll; }
+
+    std::vector<DetPoint> detCurve() const;
+    double equalErrorRate(int& threshold) const;
+    ThresholdPick thresholdForFar(double targetFar) const;
+
+    bool writeDetCsv(const std::string& path) const;
+    std::string report() const;
+
+private:
+    // Scoring work per pool task, in DBMatch calls
+    static constexpr size_t StripComparisons = 4096;
+
+    struct Sample {
+        uint32_t label;
+        TemplateArena::Handle handle;
+    };
+
+    WorkerPool& pool;
+    std::vector<HANDLE> handles; // indexed by pool worker
+    TemplateArena templates;
+    std::vector<Sample> samples;  // successfully extracted, in manifest order
+    uint64_t corpusHash = 0;
+    size_t failedToEnroll = 0;
+    size_t tileSize = 256;
+    unsigned int dpi = 500;
+    ScoreHistogram genuine;
+    ScoreHistogram impostor;
+    std::string lastError;
+};
@@ -0,0 +1,161 @@
+#include "MemoryAccounting.h"
+#include "FingerprintDevice.h"
+#include <windows.h>
+#include <psapi.h>
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+
+struct TagCounters {
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> peakBytes{ 0 };
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> frees{ 0 };
+};
+
+TagCounters counters[(size_t)MemoryTag::Count];
+std::atomic<uint64_t> sdkTemplates{ 0 };
+std::atomic<uint64_t> sdkTemplatesPeak{ 0 };
+std::atomic<double> sdkBytesPerTemplate{ 0.0 };
+
+void raisePeak(std::atomic<uint64_t>& peak, uint64_t value) {
+    uint64_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+const char* toString(MemoryTag tag) {
+    switch (tag) {
+    case MemoryTag::Capture: return "capture";
+    case MemoryTag::Templates: return "templates";
+    case MemoryTag::Gallery: return "gallery";
+    case MemoryTag::Ui: return "ui";
+    case MemoryTag::Logging: return "logging";
+    case MemoryTag::SdkCache: return "sdk cache";
+    default: return "?";
+    }
+}
+
+// ===== Counters =====
+
+void MemoryAccounting::allocated(MemoryTag tag, size_t bytes) {
+    TagCounters& c = counters[(size_t)tag];
+    uint64_t now = c.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    raisePeak(c.peakBytes, now);
+}
+
+void MemoryAccounting::freed(MemoryTag tag, size_t bytes) {
+    TagCounters& c = counters[(size_t)tag];
+    c.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryAccounting::sdkTemplatesAdded(size_t count) {
+    raisePeak(sdkTemplatesPeak, sdkTemplates.fetch_add(count, std::memory_order_relaxed) + count);
+}
+
+void MemoryAccounting::sdkTemplatesRemoved(size_t count) {
+    sdkTemplates.fetch_sub(count, std::memory_order_relaxed);
+}
+
+void MemoryAccounting::setSdkBytesPerTemplate(double bytes) {
+    sdkBytesPerTemplate.store(bytes, std::memory_order_relaxed);
+}
+
+double MemoryAccounting::calibrateSdkCache(const std::vector<GalleryEntry>& sample) {
+    if (sample.empty()) return sdkBytesPerTemplate.load(std::memory_order_relaxed);
+    HANDLE cache = ZKFPM_DBInit();
+    if (!cache) return sdkBytesPerTemplate.load(std::memory_order_relaxed);
+    uint64_t before = processPrivateBytes();
+    size_t added = 0;
+    for (const GalleryEntry& e : sample)
+        added += ZKFPM_DBAdd(cache, e.fid, const_cast<unsigned char*>(e.data), e.size) == ZKFP_ERR_OK;
+    uint64_t after = processPrivateBytes();
+    ZKFPM_DBFree(cache);
+    if (added == 0 || after <= before) return sdkBytesPerTemplate.load(std::memory_order_relaxed);
+    double perTemplate = (double)(after - before) / added;
+    setSdkBytesPerTemplate(perTemplate);
+    return perTemplate;
+}
+
+uint64_t MemoryAccounting::processPrivateBytes() {
+    PROCESS_MEMORY_COUNTERS_EX pmc{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) return 0;
+    return pmc.PrivateUsage;
+}
+
+MemorySnapshot MemoryAccounting::snapshot() {
+    MemorySnapshot s;
+    for (size_t i = 0; i < (size_t)MemoryTag::Count; ++i) {
+        const TagCounters& c = counters[i];
+        s.tags[i].bytes = c.bytes.load(std::memory_order_relaxed);
+        s.tags[i].peakBytes = c.peakBytes.load(std::memory_order_relaxed);
+        s.tags[i].allocations = c.allocations.load(std::memory_order_relaxed);
+        s.tags[i].frees = c.frees.load(std::memory_order_relaxed);
+    }
+    // The SDK tag is priced at snapshot time, so a later calibration applies to templates already loaded
+    s.sdkTemplates = sdkTemplates.load(std::memory_order_relaxed);
+    s.sdkBytesPerTemplate = sdkBytesPerTemplate.load(std::memory_order_relaxed);
+    MemoryTagUsage& sdk = s.tags[(size_t)MemoryTag::SdkCache];
+    sdk.bytes = (uint64_t)(s.sdkTemplates * s.sdkBytesPerTemplate);
+    sdk.peakBytes = (uint64_t)(sdkTemplatesPeak.load(std::memory_order_relaxed) * s.sdkBytesPerTemplate);
+    s.processPrivateBytes = processPrivateBytes();
+    return s;
+}
+
+void MemoryAccounting::resetPeaks() {
+    for (TagCounters& c : counters) c.peakBytes.store(c.bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sdkTemplatesPeak.store(sdkTemplates.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// ===== Snapshot =====
+
+uint64_t MemorySnapshot::trackedBytes() const {
+    uint64_t total = 0;
+    for (const MemoryTagUsage& t : tags) total += t.bytes;
+    return total;
+}
+
+uint64_t MemorySnapshot::untrackedBytes() const {
+    uint64_t tracked = trackedBytes();
+    return processPrivateBytes > tracked ? processPrivateBytes - tracked : 0;
+}
+
+std::string MemorySnapshot::summary() const {
+    std::ostringstream oss;
+    for (size_t i = 0; i < tags.size(); ++i) {
+        const MemoryTagUsage& t = tags[i];
+        char line[192];
+        if ((MemoryTag)i == MemoryTag::SdkCache) {
+            if (sdkBytesPerTemplate > 0.0)
+                std::snprintf(line, sizeof(line), "%-10s %9.2f MB (peak %.2f MB), %llu templates x %.0f bytes (estimate)\n",
+                              toString((MemoryTag)i), t.bytes / 1048576.0, t.peakBytes / 1048576.0,
+                              (unsigned long long)sdkTemplates, sdkBytesPerTemplate);
+            else
+                std::snprintf(line, sizeof(line), "%-10s         ? MB, %llu templates (not calibrated)\n",
+                              toString((MemoryTag)i), (unsigned long long)sdkTemplates);
+        } else {
+            std::snprintf(line, sizeof(line), "%-10s %9.2f MB (peak %.2f MB), %llu allocations, %llu frees\n",
+                          toString((MemoryTag)i), t.bytes / 1048576.0, t.peakBytes / 1048576.0,
+                          (unsigned long long)t.allocations, (unsigned long long)t.frees);
+        }
+        oss << line;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-10s %9.2f MB tracked, %.2f MB private (%.2f MB untracked)\n", "total",
+                  trackedBytes() / 1048576.0, processPrivateBytes / 1048576.0, untrackedBytes() / 1048576.0);
+    oss << line;
+    return oss.str();
+}
+
+// ===== MemoryCharge =====
+
+void MemoryCharge::set(size_t newBytes) {
+    if (newBytes > current) MemoryAccounting::allocated(tag, newBytes - current);
+    else if (newBytes < current) MemoryAccounting::freed(tag, current - newBytes);
+    current = newBytes;
+}
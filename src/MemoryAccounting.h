@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct GalleryEntry;
+
+// Where the process's memory goes, by subsystem. Buffers the app owns are
+// counted by TrackingAllocator (containers) or MemoryCharge (anything else:
+// GPU textures, mapped views). The SDK allocates on its own heap, so its DB
+// caches are estimated: templates held in caches x measured bytes per template.
+enum class MemoryTag : uint8_t {
+    Capture,   // sensor images, pipeline slots, archive frames, frame bus
+    Templates, // last template, SDK scratch, hex text
+    Gallery,   // template arena, FID maps, identity index
+    Ui,        // textures and render targets
+    Logging,   // debug log ring
+    SdkCache,  // estimate, see MemoryAccounting::calibrateSdkCache
+    Count
+};
+
+const char* toString(MemoryTag tag);
+
+struct MemoryTagUsage {
+    uint64_t bytes = 0;
+    uint64_t peakBytes = 0; // high-water mark since start (or resetPeaks)
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+};
+
+struct MemorySnapshot {
+    std::array<MemoryTagUsage, (size_t)MemoryTag::Count> tags{};
+    uint64_t sdkTemplates = 0;        // templates currently held across SDK DB caches
+    double sdkBytesPerTemplate = 0.0; // 0 until calibrated
+    uint64_t processPrivateBytes = 0; // what the OS charges the process, tracked or not
+
+    const MemoryTagUsage& operator[](MemoryTag tag) const { return tags[(size_t)tag]; }
+    uint64_t trackedBytes() const;
+    uint64_t untrackedBytes() const; // private bytes not explained by the tags (CRT, raylib, code)
+    std::string summary() const;
+};
+
+namespace MemoryAccounting {
+
+void allocated(MemoryTag tag, size_t bytes);
+void freed(MemoryTag tag, size_t bytes);
+
+// Called wherever templates enter or leave an SDK DB cache
+void sdkTemplatesAdded(size_t count);
+void sdkTemplatesRemoved(size_t count);
+
+// Loads `sample` into a scratch DB cache and measures the growth in private
+// bytes; the result prices the SdkCache tag from then on. Needs ZKFPM_Init.
+double calibrateSdkCache(const std::vector<GalleryEntry>& sample);
+void setSdkBytesPerTemplate(double bytes);
+
+uint64_t processPrivateBytes();
+MemorySnapshot snapshot();
+void resetPeaks();
+
+} // namespace MemoryAccounting
+
+// Standard allocator that charges every allocation to Tag
+template <typename T, MemoryTag Tag>
+struct TrackingAllocator {
+    using value_type = T;
+    template <typename U>
+    struct rebind {
+        using other = TrackingAllocator<U, Tag>;
+    };
+
+    TrackingAllocator() noexcept = default;
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U, Tag>&) noexcept {}
+
+    T* allocate(size_t n) {
+        T* p = std::allocator<T>().allocate(n);
+        MemoryAccounting::allocated(Tag, n * sizeof(T));
+        return p;
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        MemoryAccounting::freed(Tag, n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U, Tag>&) const noexcept { return true; }
+};
+
+template <MemoryTag Tag, typename T>
+using TrackedVector = std::vector<T, TrackingAllocator<T, Tag>>;
+template <MemoryTag Tag, typename T>
+using TrackedDeque = std::deque<T, TrackingAllocator<T, Tag>>;
+
+using CaptureBuffer = TrackedVector<MemoryTag::Capture, unsigned char>;
+using TemplateBuffer = TrackedVector<MemoryTag::Templates, unsigned char>;
+
+// A block of memory allocated outside the tracked containers; set() moves the
+// charge to the new size, and the destructor releases it
+class MemoryCharge {
+public:
+    explicit MemoryCharge(MemoryTag tag) : tag(tag) {}
+    ~MemoryCharge() { set(0); }
+    MemoryCharge(const MemoryCharge&) = delete;
+    MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+    void set(size_t newBytes);
+    size_t bytes() const { return current; }
+
+private:
+    MemoryTag tag;
+    size_t current = 0;
+};
@@ -0,0 +1,628 @@
+#include "Replication.h"
+#include <ws2tcpip.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+namespace {
+
+enum FrameType : uint8_t {
+    Hello = 1,
+    SnapBegin = 2,
+    SnapChunk = 3,
+    SnapEnd = 4,
+    Ops = 5,
+    Heartbeat = 6,
+    Ack = 7,
+};
+
+constexpr size_t kSnapshotChunk = 512;       // records per SnapChunk
+constexpr size_t kMaxBatchOps = 256;         // entries per Ops frame
+constexpr size_t kMaxBatchBytes = 1u << 20;
+constexpr uint32_t kMaxFrameBytes = 16u << 20;
+constexpr auto kHeartbeat = std::chrono::milliseconds(500);
+
+uint64_t unixTimeUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// ===== Wire encoding =====
+
+void put32(std::vector<unsigned char>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back((unsigned char)(v >> (8 * i)));
+}
+
+void put64(std::vector<unsigned char>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back((unsigned char)(v >> (8 * i)));
+}
+
+struct Reader {
+    const unsigned char* p;
+    const unsigned char* end;
+
+    bool u8(uint8_t& v) {
+        if (end - p < 1) return false;
+        v = *p++;
+        return true;
+    }
+    bool u32(uint32_t& v) {
+        if (end - p < 4) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= (uint32_t)p[i] << (8 * i);
+        p += 4;
+        return true;
+    }
+    bool u64(uint64_t& v) {
+        if (end - p < 8) return false;
+        v = 0;
+        for (int i = 0; i < 8; ++i) v |= (uint64_t)p[i] << (8 * i);
+        p += 8;
+        return true;
+    }
+    bool bytes(uint32_t n, const unsigned char*& data) {
+        if ((size_t)(end - p) < n) return false;
+        data = p;
+        p += n;
+        return true;
+    }
+};
+
+// Starts a frame; the length is patched in by sendFrame
+std::vector<unsigned char> frame(FrameType type) {
+    std::vector<unsigned char> out(4, 0);
+    out.push_back(type);
+    return out;
+}
+
+bool sendAll(SOCKET s, const unsigned char* data, size_t size) {
+    while (size > 0) {
+        int n = send(s, (const char*)data, (int)std::min<size_t>(size, 1u << 20), 0);
+        if (n <= 0) return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool sendFrame(SOCKET s, std::vector<unsigned char>& out) {
+    uint32_t length = (uint32_t)(out.size() - 4);
+    for (int i = 0; i < 4; ++i) out[i] = (unsigned char)(length >> (8 * i));
+    return sendAll(s, out.data(), out.size());
+}
+
+bool recvAll(SOCKET s, unsigned char* data, size_t size) {
+    while (size > 0) {
+        int n = recv(s, (char*)data, (int)std::min<size_t>(size, 1u << 20), 0);
+        if (n <= 0) return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool recvFrame(SOCKET s, uint8_t& type, std::vector<unsigned char>& payload) {
+    unsigned char header[4];
+    if (!recvAll(s, header, 4)) return false;
+    uint32_t length = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+    if (length < 1 || length > kMaxFrameBytes) return false;
+    if (!recvAll(s, &type, 1)) return false;
+    payload.resize(length - 1);
+    return payload.empty() || recvAll(s, payload.data(), payload.size());
+}
+
+void setNoDelay(SOCKET s) {
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+} // namespace
+
+// ===== Primary =====
+
+ReplicationPrimary::ReplicationPrimary(FingerprintDevice& device, size_t maxLogBytes)
+    : device(device), maxLogBytes(maxLogBytes) {
+    std::random_device rd;
+    epoch = ((uint64_t)rd() << 32) | rd();
+    if (epoch == 0) epoch = 1;
+}
+
+ReplicationPrimary::~ReplicationPrimary() {
+    stop();
+}
+
+bool ReplicationPrimary::start(unsigned short port) {
+    if (listener != INVALID_SOCKET) return true;
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        lastError = "WSAStartup failed.";
+        return false;
+    }
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (s == INVALID_SOCKET || bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 8) != 0) {
+        if (s != INVALID_SOCKET) closesocket(s);
+        WSACleanup();
+        std::lock_guard<std::mutex> lock(errorMutex);
+        lastError = "Cannot listen on 127.0.0.1:" + std::to_string(port) + ".";
+        return false;
+    }
+    listener = s;
+    stopping = false;
+    acceptor = std::thread([this] { acceptLoop(); });
+    return true;
+}
+
+void ReplicationPrimary::stop() {
+    if (listener == INVALID_SOCKET) return;
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        stopping = true;
+        logChanged.notify_all();
+    }
+    shutdown(listener, SD_BOTH);
+    closesocket(listener);
+    if (acceptor.joinable()) acceptor.join();
+    listener = INVALID_SOCKET;
+    reapSessions(true);
+    WSACleanup();
+}
+
+void ReplicationPrimary::acceptLoop() {
+    while (!stopping) {
+        sockaddr_in peer{};
+        socklen_t peerLen = sizeof(peer);
+        SOCKET s = accept(listener, (sockaddr*)&peer, &peerLen);
+        if (s == INVALID_SOCKET) break;
+        setNoDelay(s);
+        reapSessions(false);
+
+        auto session = std::make_unique<Session>();
+        session->socket = s;
+        char host[64] = {};
+        inet_ntop(AF_INET, &peer.sin_addr, host, sizeof(host));
+        session->status.peer = std::string(host) + ":" + std::to_string(ntohs(peer.sin_port));
+        Session* raw = session.get();
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        sessions.push_back(std::move(session));
+        raw->thread = std::thread([this, raw] { serve(raw); });
+    }
+}
+
+void ReplicationPrimary::reapSessions(bool all) {
+    std::vector<std::unique_ptr<Session>> done;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        for (auto& s : sessions) {
+            if (all) shutdown(s->socket, SD_BOTH);
+            if (all || s->finished) done.push_back(std::move(s));
+        }
+        sessions.erase(std::remove(sessions.begin(), sessions.end(), nullptr), sessions.end());
+    }
+    for (auto& s : done) {
+        if (s->thread.joinable()) s->thread.join();
+        closesocket(s->socket);
+    }
+}
+
+// ===== Log =====
+
+void ReplicationPrimary::onTemplateAdded(unsigned int fid, const unsigned char* tpl, unsigned int size) {
+    append(ReplicationOp::Add, fid, tpl, size);
+}
+
+void ReplicationPrimary::onTemplateRemoved(unsigned int fid) {
+    append(ReplicationOp::Remove, fid, nullptr, 0);
+}
+
+void ReplicationPrimary::onGalleryCleared() {
+    append(ReplicationOp::Clear, 0, nullptr, 0);
+}
+
+void ReplicationPrimary::append(ReplicationOp op, unsigned int fid, const unsigned char* tpl, unsigned int size) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    LogEntry e{ ++head, unixTimeUs(), op, fid, {} };
+    if (tpl && size) e.tpl.assign(tpl, tpl + size);
+    logBytes += sizeof(LogEntry) + e.tpl.size();
+    log.push_back(std::move(e));
+    // Replicas that fall behind the trimmed tail are re-seeded from a snapshot
+    while (logBytes > maxLogBytes && log.size() > 1) {
+        logBytes -= sizeof(LogEntry) + log.front().tpl.size();
+        log.pop_front();
+    }
+    logChanged.notify_all();
+}
+
+uint64_t ReplicationPrimary::headLsn() const {
+    std::lock_guard<std::mutex> lock(logMutex);
+    return head;
+}
+
+// ===== Sessions =====
+
+void ReplicationPrimary::serve(Session* session) {
+    SOCKET s = session->socket;
+    uint8_t type = 0;
+    std::vector<unsigned char> payload;
+    uint64_t replicaEpoch = 0, sentLsn = 0;
+    if (!recvFrame(s, type, payload) || type != Hello) {
+        session->finished = true;
+        return;
+    }
+    Reader hello{ payload.data(), payload.data() + payload.size() };
+    if (!hello.u64(replicaEpoch) || !hello.u64(sentLsn)) {
+        session->finished = true;
+        return;
+    }
+
+    bool needSnapshot;
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        uint64_t oldest = log.empty() ? head + 1 : log.front().lsn;
+        needSnapshot = replicaEpoch != epoch || sentLsn > head || sentLsn + 1 < oldest;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        session->status.ackedLsn = needSnapshot ? 0 : sentLsn;
+    }
+    if (needSnapshot && !sendSnapshot(session, sentLsn)) {
+        session->finished = true;
+        return;
+    }
+
+    auto lastSend = std::chrono::steady_clock::now();
+    while (!stopping) {
+        std::vector<unsigned char> out;
+        bool resnapshot = false;
+        {
+            std::unique_lock<std::mutex> lock(logMutex);
+            logChanged.wait_until(lock, lastSend + kHeartbeat, [&] { return stopping || head > sentLsn; });
+            if (stopping) break;
+            if (head > sentLsn) {
+                uint64_t oldest = log.empty() ? head + 1 : log.front().lsn;
+                if (sentLsn + 1 < oldest) {
+                    resnapshot = true;
+                } else {
+                    out = frame(Ops);
+                    size_t countAt = out.size();
+                    put32(out, 0);
+                    uint32_t n = 0;
+                    for (size_t i = (size_t)(sentLsn + 1 - oldest); i < log.size(); ++i) {
+                        const LogEntry& e = log[i];
+                        if (n >= kMaxBatchOps || (n > 0 && out.size() + e.tpl.size() > kMaxBatchBytes)) break;
+                        put64(out, e.lsn);
+                        put64(out, e.unixTimeUs);
+                        out.push_back((unsigned char)e.op);
+                        put32(out, e.fid);
+                        put32(out, (uint32_t)e.tpl.size());
+                        out.insert(out.end(), e.tpl.begin(), e.tpl.end());
+                        sentLsn = e.lsn;
+                        ++n;
+                    }
+                    for (int i = 0; i < 4; ++i) out[countAt + i] = (unsigned char)(n >> (8 * i));
+                }
+            } else {
+                out = frame(Heartbeat);
+                put64(out, head);
+                put64(out, unixTimeUs());
+            }
+        }
+        if (resnapshot) {
+            if (!sendSnapshot(session, sentLsn)) break;
+        } else {
+            if (!sendFrame(s, out)) break;
+            std::lock_guard<std::mutex> lock(sessionMutex);
+            session->status.bytesSent += out.size();
+        }
+        lastSend = std::chrono::steady_clock::now();
+        readAcks(session);
+    }
+    session->finished = true;
+}
+
+bool ReplicationPrimary::sendSnapshot(Session* session, uint64_t& sentLsn) {
+    // Copy the gallery and its LSN together; the device mutex keeps both still
+    std::vector<std::pair<unsigned int, std::vector<unsigned char>>> records;
+    uint64_t lsn;
+    {
+        std::unique_lock<std::mutex> deviceLock;
+        if (deviceMutex) deviceLock = std::unique_lock<std::mutex>(*deviceMutex);
+        for (const GalleryEntry& e : device.snapshotGallery())
+            records.emplace_back(e.fid, std::vector<unsigned char>(e.data, e.data + e.size));
+        std::lock_guard<std::mutex> lock(logMutex);
+        lsn = head;
+    }
+
+    size_t bytes = 0;
+    std::vector<unsigned char> out = frame(SnapBegin);
+    put64(out, epoch);
+    put64(out, lsn);
+    put32(out, (uint32_t)records.size());
+    if (!sendFrame(session->socket, out)) return false;
+    bytes += out.size();
+    for (size_t begin = 0; begin < records.size(); begin += kSnapshotChunk) {
+        size_t end = std::min(records.size(), begin + kSnapshotChunk);
+        out = frame(SnapChunk);
+        put32(out, (uint32_t)(end - begin));
+        for (size_t i = begin; i < end; ++i) {
+            put32(out, records[i].first);
+            put32(out, (uint32_t)records[i].second.size());
+            out.insert(out.end(), records[i].second.begin(), records[i].second.end());
+        }
+        if (!sendFrame(session->socket, out)) return false;
+        bytes += out.size();
+        if (stopping) return false;
+    }
+    out = frame(SnapEnd);
+    if (!sendFrame(session->socket, out)) return false;
+    bytes += out.size();
+
+    sentLsn = lsn;
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    ++session->status.snapshots;
+    session->status.bytesSent += bytes;
+    return true;
+}
+
+// Drains any acks already waiting without blocking the send loop
+void ReplicationPrimary::readAcks(Session* session) {
+    for (;;) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(session->socket, &readable);
+        timeval none{ 0, 0 };
+        if (select((int)session->socket + 1, &readable, nullptr, nullptr, &none) <= 0) return;
+        uint8_t type = 0;
+        std::vector<unsigned char> payload;
+        if (!recvFrame(session->socket, type, payload)) {
+            shutdown(session->socket, SD_BOTH);
+            return;
+        }
+        Reader r{ payload.data(), payload.data() + payload.size() };
+        uint64_t acked = 0;
+        if (type == Ack && r.u64(acked)) {
+            std::lock_guard<std::mutex> lock(sessionMutex);
+            session->status.ackedLsn = std::max(session->status.ackedLsn, acked);
+        }
+    }
+}
+
+std::vector<ReplicaStatus> ReplicationPrimary::replicas() const {
+    std::vector<ReplicaStatus> out;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        for (const auto& s : sessions)
+            if (!s->finished) out.push_back(s->status);
+    }
+    std::lock_guard<std::mutex> lock(logMutex);
+    uint64_t now = unixTimeUs();
+    for (ReplicaStatus& r : out) {
+        r.lagOps = head > r.ackedLsn ? head - r.ackedLsn : 0;
+        r.lagSeconds = 0.0;
+        if (r.lagOps > 0 && !log.empty()) {
+            uint64_t next = std::max(r.ackedLsn + 1, log.front().lsn);
+            const LogEntry& e = log[(size_t)(next - log.front().lsn)];
+            r.lagSeconds = now > e.unixTimeUs ? (now - e.unixTimeUs) / 1e6 : 0.0;
+        }
+    }
+    return out;
+}
+
+std::string ReplicationPrimary::summary() const {
+    std::ostringstream oss;
+    std::vector<ReplicaStatus> all = replicas();
+    oss << "head lsn " << headLsn() << ", " << all.size() << " replica(s)\n";
+    for (const ReplicaStatus& r : all) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-21s acked %llu, lag %llu ops / %.3f s, %llu snapshots, %.1f MB sent\n",
+                      r.peer.c_str(), (unsigned long long)r.ackedLsn, (unsigned long long)r.lagOps, r.lagSeconds,
+                      (unsigned long long)r.snapshots, r.bytesSent / 1048576.0);
+        oss << line;
+    }
+    return oss.str();
+}
+
+std::string ReplicationPrimary::getLastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return lastError;
+}
+
+// ===== Replica =====
+
+std::string ReplicaStats::summary() const {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%s, applied lsn %llu of %llu (lag %llu ops, last apply %.1f ms behind), %llu batches, "
+                  "%llu ops, %llu snapshots, %llu apply errors, %llu reconnects",
+                  connected ? "connected" : "disconnected", (unsigned long long)appliedLsn,
+                  (unsigned long long)primaryLsn, (unsigned long long)lagOps, lastApplyLagMs,
+                  (unsigned long long)batches, (unsigned long long)opsApplied, (unsigned long long)snapshots,
+                  (unsigned long long)applyErrors, (unsigned long long)reconnects);
+    return line;
+}
+
+ReplicationReplica::ReplicationReplica(FingerprintDevice& device) : device(device) {}
+
+ReplicationReplica::~ReplicationReplica() {
+    stop();
+}
+
+bool ReplicationReplica::start(const std::string& primaryHost, unsigned short primaryPort) {
+    if (worker.joinable()) return true;
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+    host = primaryHost;
+    port = primaryPort;
+    stopping = false;
+    worker = std::thread([this] { run(); });
+    return true;
+}
+
+void ReplicationReplica::stop() {
+    if (!worker.joinable()) return;
+    stopping = true;
+    SOCKET s = current.load();
+    if (s != INVALID_SOCKET) shutdown(s, SD_BOTH);
+    worker.join();
+    WSACleanup();
+}
+
+ReplicaStats ReplicationReplica::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return counters;
+}
+
+void ReplicationReplica::run() {
+    auto backoff = std::chrono::milliseconds(100);
+    bool first = true;
+    while (!stopping) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+        if (s != INVALID_SOCKET && connect(s, (sockaddr*)&addr, sizeof(addr)) == 0) {
+            setNoDelay(s);
+            current = s;
+            if (stopping) shutdown(s, SD_BOTH);
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                counters.connected = true;
+                if (!first) ++counters.reconnects;
+            }
+            first = false;
+            if (session(s)) backoff = std::chrono::milliseconds(100);
+            current = INVALID_SOCKET;
+            std::lock_guard<std::mutex> lock(statsMutex);
+            counters.connected = false;
+        }
+        if (s != INVALID_SOCKET) closesocket(s);
+        for (auto waited = std::chrono::milliseconds(0); waited < backoff && !stopping;
+             waited += std::chrono::milliseconds(50))
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        backoff = std::min(backoff * 2, std::chrono::milliseconds(5000));
+    }
+}
+
+// Returns true if the session got as far as receiving data
+bool ReplicationReplica::session(SOCKET s) {
+    std::vector<unsigned char> out = frame(Hello);
+    put64(out, epoch);
+    put64(out, stats().appliedLsn);
+    if (!sendFrame(s, out)) return false;
+
+    bool received = false;
+    uint8_t type = 0;
+    std::vector<unsigned char> payload;
+    uint64_t snapshotLsn = 0, snapshotEpoch = 0;
+    while (!stopping && recvFrame(s, type, payload)) {
+        received = true;
+        Reader r{ payload.data(), payload.data() + payload.size() };
+        if (type == SnapBegin) {
+            uint32_t count = 0;
+            if (!r.u64(snapshotEpoch) || !r.u64(snapshotLsn) || !r.u32(count)) return received;
+            std::unique_lock<std::mutex> deviceLock;
+            if (deviceMutex) deviceLock = std::unique_lock<std::mutex>(*deviceMutex);
+            device.clearFingerprints();
+            // Until SnapEnd the local gallery is partial; a fresh Hello must re-seed
+            epoch = 0;
+        } else if (type == SnapChunk) {
+            uint32_t n = 0;
+            if (!r.u32(n)) return received;
+            uint64_t errors = 0;
+            {
+                std::unique_lock<std::mutex> deviceLock;
+                if (deviceMutex) deviceLock = std::unique_lock<std::mutex>(*deviceMutex);
+                for (uint32_t i = 0; i < n; ++i) {
+                    uint32_t fid = 0, size = 0;
+                    const unsigned char* tpl = nullptr;
+                    if (!r.u32(fid) || !r.u32(size) || !r.bytes(size, tpl)) return received;
+                    if (!device.enrollTemplateAs(fid, tpl, size)) ++errors;
+                }
+            }
+            std::lock_guard<std::mutex> lock(statsMutex);
+            counters.applyErrors += errors;
+        } else if (type == SnapEnd) {
+            epoch = snapshotEpoch;
+            std::lock_guard<std::mutex> lock(statsMutex);
+            counters.appliedLsn = snapshotLsn;
+            counters.primaryLsn = std::max(counters.primaryLsn, snapshotLsn);
+            counters.lagOps = counters.primaryLsn - snapshotLsn;
+            ++counters.snapshots;
+        } else if (type == Ops) {
+            apply(payload);
+        } else if (type == Heartbeat) {
+            uint64_t headLsn = 0;
+            if (!r.u64(headLsn)) return received;
+            std::lock_guard<std::mutex> lock(statsMutex);
+            counters.primaryLsn = headLsn;
+            counters.lagOps = headLsn > counters.appliedLsn ? headLsn - counters.appliedLsn : 0;
+            continue;
+        } else {
+            continue;
+        }
+        if (type == Ops || type == SnapEnd) {
+            out = frame(Ack);
+            put64(out, stats().appliedLsn);
+            if (!sendFrame(s, out)) return received;
+        }
+    }
+    return received;
+}
+
+// Applies one Ops batch under a single hold of the device mutex
+void ReplicationReplica::apply(const std::vector<unsigned char>& payload) {
+    Reader r{ payload.data(), payload.data() + payload.size() };
+    uint32_t n = 0;
+    if (!r.u32(n)) return;
+    uint64_t applied = stats().appliedLsn, lastTime = 0, ops = 0, errors = 0;
+    {
+        std::unique_lock<std::mutex> deviceLock;
+        if (deviceMutex) deviceLock = std::unique_lock<std::mutex>(*deviceMutex);
+        for (uint32_t i = 0; i < n; ++i) {
+            uint64_t lsn = 0, time = 0;
+            uint8_t op = 0;
+            uint32_t fid = 0, size = 0;
+            const unsigned char* tpl = nullptr;
+            if (!r.u64(lsn) || !r.u64(time) || !r.u8(op) || !r.u32(fid) || !r.u32(size) || !r.bytes(size, tpl)) break;
+            if (lsn <= applied) continue; // already applied before a reconnect
+            bool ok = true;
+            switch ((ReplicationOp)op) {
+            case ReplicationOp::Add:
+                if (device.isEnrolled(fid)) device.removeTemplate(fid);
+                ok = device.enrollTemplateAs(fid, tpl, size);
+                break;
+            case ReplicationOp::Remove:
+                ok = !device.isEnrolled(fid) || device.removeTemplate(fid);
+                break;
+            case ReplicationOp::Clear:
+                ok = device.clearFingerprints();
+                break;
+            default:
+                ok = false;
+                break;
+            }
+            errors += !ok;
+            ++ops;
+            applied = lsn;
+            lastTime = time;
+        }
+    }
+    uint64_t now = unixTimeUs();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    counters.appliedLsn = applied;
+    counters.primaryLsn = std::max(counters.primaryLsn, applied);
+    counters.lagOps = counters.primaryLsn - applied;
+    if (lastTime) counters.lastApplyLagMs = now > lastTime ? (now - lastTime) / 1000.0 : 0.0;
+    ++counters.batches;
+    counters.opsApplied += ops;
+    counters.applyErrors += errors;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <winsock2.h>
+#include "FingerprintDevice.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Primary/replica gallery replication between stations over TCP.
+//
+// The primary records every gallery change (via GalleryListener) as an
+// ordered, numbered log entry (LSN) and ships the entries to each replica in
+// batches. A replica that connects with an LSN still in the retained log only
+// gets the tail; one that is new, too far behind, or that last followed a
+// different primary run (epoch) gets a snapshot first and then the tail.
+//
+// Frames are [u32 length][u8 type][payload], little-endian:
+//   Hello      replica -> primary  u64 epoch, u64 appliedLsn
+//   SnapBegin  primary -> replica  u64 epoch, u64 lsn, u32 count
+//   SnapChunk                      u32 n, n x ([u32 fid][u32 size][bytes])
+//   SnapEnd
+//   Ops                            u32 n, n x ([u64 lsn][u64 unixTimeUs][u8 op][u32 fid][u32 size][bytes])
+//   Heartbeat                      u64 headLsn, u64 unixTimeUs
+//   Ack        replica -> primary  u64 appliedLsn
+enum class ReplicationOp : uint8_t { Add = 1, Remove = 2, Clear = 3 };
+
+struct ReplicaStatus {
+    std::string peer;
+    uint64_t ackedLsn = 0;
+    uint64_t lagOps = 0;      // head - acked
+    double lagSeconds = 0.0;  // age of the oldest change the replica has not acked
+    uint64_t snapshots = 0;
+    uint64_t bytesSent = 0;
+};
+
+class ReplicationPrimary : public GalleryListener {
+public:
+    explicit ReplicationPrimary(FingerprintDevice& device, size_t maxLogBytes = 32u << 20);
+    ~ReplicationPrimary();
+
+    // The mutex the application holds around gallery changes; snapshots take
+    // it so the copied gallery and its LSN agree
+    void setDeviceMutex(std::mutex* mutex) { deviceMutex = mutex; }
+
+    bool start(unsigned short port);
+    void stop();
+
+    // GalleryListener (called on the thread that changed the gallery)
+    void onTemplateAdded(unsigned int fid, const unsigned char* tpl, unsigned int size) override;
+    void onTemplateRemoved(unsigned int fid) override;
+    void onGalleryCleared() override;
+
+    uint64_t headLsn() const;
+    std::vector<ReplicaStatus> replicas() const;
+    std::string summary() const;
+    std::string getLastError() const;
+
+private:
+    struct LogEntry {
+        uint64_t lsn;
+        uint64_t unixTimeUs;
+        ReplicationOp op;
+        unsigned int fid;
+        std::vector<unsigned char> tpl;
+    };
+    struct Session {
+        SOCKET socket = INVALID_SOCKET;
+        std::thread thread;
+        std::atomic<bool> finished{ false };
+        ReplicaStatus status;
+    };
+
+    void append(ReplicationOp op, unsigned int fid, const unsigned char* tpl, unsigned int size);
+    void acceptLoop();
+    void serve(Session* session);
+    bool sendSnapshot(Session* session, uint64_t& sentLsn);
+    void readAcks(Session* session);
+    void reapSessions(bool all);
+
+    FingerprintDevice& device;
+    std::mutex* deviceMutex = nullptr;
+    size_t maxLogBytes;
+    uint64_t epoch = 0;
+
+    mutable std::mutex logMutex;
+    std::condition_variable logChanged;
+    std::deque<LogEntry> log; // lsn log.front().lsn .. head
+    size_t logBytes = 0;
+    uint64_t head = 0;
+
+    SOCKET listener = INVALID_SOCKET;
+    std::thread acceptor;
+    std::atomic<bool> stopping{ false };
+    mutable std::mutex sessionMutex;
+    std::vector<std::unique_ptr<Session>> sessions;
+    mutable std::mutex errorMutex;
+    std::string lastError;
+};
+
+struct ReplicaStats {
+    bool connected = false;
+    uint64_t appliedLsn = 0;
+    uint64_t primaryLsn = 0;   // last head seen from the primary
+    uint64_t lagOps = 0;
+    double lastApplyLagMs = 0.0; // primary commit -> applied here, for the last batch
+    uint64_t batches = 0;
+    uint64_t opsApplied = 0;
+    uint64_t snapshots = 0;
+    uint64_t applyErrors = 0;
+    uint64_t reconnects = 0;
+
+    std::string summary() const;
+};
+
+class ReplicationReplica {
+public:
+    explicit ReplicationReplica(FingerprintDevice& device);
+    ~ReplicationReplica();
+
+    // Held while a batch is applied; the application can use the device in between.
+    // The device must not have a duplicate detector attached.
+    void setDeviceMutex(std::mutex* mutex) { deviceMutex = mutex; }
+
+    // Connects in the background and reconnects (resuming from the applied LSN) until stop()
+    bool start(const std::string& host, unsigned short port);
+    void stop();
+
+    ReplicaStats stats() const;
+
+private:
+    void run();
+    bool session(SOCKET s);
+    void apply(const std::vector<unsigned char>& payload);
+
+    FingerprintDevice& device;
+    std::mutex* deviceMutex = nullptr;
+    std::string host;
+    unsigned short port = 0;
+    std::thread worker;
+    std::atomic<bool> stopping{ false };
+    std::atomic<SOCKET> current{ INVALID_SOCKET };
+
+    uint64_t epoch = 0; // worker thread only
+    mutable std::mutex statsMutex;
+    ReplicaStats counters;
+};
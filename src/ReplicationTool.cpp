@@ -0,0 +1,153 @@
+#include "FingerprintDevice.h"
+#include "GalleryTransfer.h"
+#include "Replication.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Gallery replication between two local processes.
+//
+//   replication_tool --primary [--port P] [--gallery <dump>] [--format jsonl|csv|bin]
+//                    [--churn ops/s] [--seconds S]
+//   replication_tool --replica [--host 127.0.0.1] [--port P] [--seconds S]
+//
+// The primary loads the dump, serves it, and with --churn keeps removing and
+// re-adding templates. The replica follows it; both print lag once a second.
+// Start and stop either side in any order to exercise snapshot catch-up.
+
+static void printUsage() {
+    std::printf("Usage: replication_tool --primary [--port P] [--gallery <dump>] [--format jsonl|csv|bin]\n"
+                "                        [--churn ops/s] [--seconds S]\n"
+                "       replication_tool --replica [--host 127.0.0.1] [--port P] [--seconds S]\n");
+}
+
+static int runPrimary(FingerprintDevice& fp, unsigned short port, const std::string& galleryPath,
+                      const std::string& formatName, double churn, double seconds) {
+    std::mutex deviceMutex;
+    ReplicationPrimary primary(fp);
+    primary.setDeviceMutex(&deviceMutex);
+    fp.addGalleryListener(&primary);
+
+    if (!galleryPath.empty()) {
+        GalleryFormat format = guessGalleryFormat(galleryPath);
+        if (!formatName.empty() && !parseGalleryFormat(formatName, format)) {
+            std::fprintf(stderr, "Unknown format: %s\n", formatName.c_str());
+            return 1;
+        }
+        GalleryImporter importer(fp);
+        TransferStats stats;
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        if (!importer.run(galleryPath, format, "", stats)) {
+            std::fprintf(stderr, "Import failed: %s\n", importer.getLastError().c_str());
+            return 1;
+        }
+    }
+    if (!primary.start(port)) {
+        std::fprintf(stderr, "%s\n", primary.getLastError().c_str());
+        return 1;
+    }
+    std::printf("primary on 127.0.0.1:%u, %zu templates, head lsn %llu\n", port, fp.getEnrolledCount(),
+                (unsigned long long)primary.headLsn());
+
+    // Churn re-enrolls copies of the loaded templates so the gallery size stays put
+    std::vector<std::pair<unsigned int, std::vector<unsigned char>>> pool;
+    for (const GalleryEntry& e : fp.snapshotGallery())
+        pool.emplace_back(e.fid, std::vector<unsigned char>(e.data, e.data + e.size));
+    std::mt19937 rng(7);
+    uint64_t churned = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    auto nextReport = started + std::chrono::seconds(1);
+    for (;;) {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - started).count();
+        if (seconds > 0.0 && elapsed >= seconds) break;
+        if (churn > 0.0 && !pool.empty()) {
+            uint64_t due = (uint64_t)(elapsed * churn);
+            for (; churned < due; ++churned) {
+                auto& [fid, tpl] = pool[rng() % pool.size()];
+                std::lock_guard<std::mutex> lock(deviceMutex);
+                if (fp.isEnrolled(fid)) fp.removeTemplate(fid);
+                else fp.enrollTemplateAs(fid, tpl.data(), (unsigned int)tpl.size());
+            }
+        }
+        if (now >= nextReport) {
+            std::printf("[%.0f s] %llu churn ops, %s", elapsed, (unsigned long long)churned, primary.summary().c_str());
+            std::fflush(stdout);
+            nextReport += std::chrono::seconds(1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(churn > 0.0 ? 2 : 50));
+    }
+    std::printf("final: %zu templates, %s", fp.getEnrolledCount(), primary.summary().c_str());
+    primary.stop();
+    fp.removeGalleryListener(&primary);
+    return 0;
+}
+
+static int runReplica(FingerprintDevice& fp, const std::string& host, unsigned short port, double seconds) {
+    std::mutex deviceMutex;
+    ReplicationReplica replica(fp);
+    replica.setDeviceMutex(&deviceMutex);
+    if (!replica.start(host, port)) {
+        std::fprintf(stderr, "Cannot start networking.\n");
+        return 1;
+    }
+    std::printf("replica of %s:%u\n", host.c_str(), port);
+
+    auto started = std::chrono::steady_clock::now();
+    for (int tick = 1;; ++tick) {
+        std::this_thread::sleep_until(started + std::chrono::seconds(tick));
+        size_t count;
+        {
+            std::lock_guard<std::mutex> lock(deviceMutex);
+            count = fp.getEnrolledCount();
+        }
+        std::printf("[%d s] %zu templates, %s\n", tick, count, replica.stats().summary().c_str());
+        std::fflush(stdout);
+        if (seconds > 0.0 && tick >= seconds) break;
+    }
+    replica.stop();
+    std::printf("final: %zu templates, %s\n", fp.getEnrolledCount(), replica.stats().summary().c_str());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::string mode, host = "127.0.0.1", galleryPath, formatName;
+    unsigned short port = 4750;
+    double churn = 0.0, seconds = 0.0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--primary" || arg == "--replica") mode = arg;
+        else if (arg == "--host") host = next();
+        else if (arg == "--port") port = (unsigned short)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--gallery") galleryPath = next();
+        else if (arg == "--format") formatName = next();
+        else if (arg == "--churn") churn = std::strtod(next().c_str(), nullptr);
+        else if (arg == "--seconds") seconds = std::strtod(next().c_str(), nullptr);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (mode.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    FingerprintDevice fp;
+    if (!fp.initialize()) {
+        std::fprintf(stderr, "%s\n", fp.getLastError().c_str());
+        return 1;
+    }
+    int rc = mode == "--primary" ? runPrimary(fp, port, galleryPath, formatName, churn, seconds)
+                                 : runReplica(fp, host, port, seconds);
+    fp.terminate();
+    return rc;
+}
@@ -0,0 +1,62 @@
+#include "RetainedUi.h"
+
+RetainedUi::~RetainedUi() {
+    unload();
+}
+
+int RetainedUi::addPanel(Rectangle bounds, DrawFn draw, Color background) {
+    Panel panel;
+    panel.bounds = bounds;
+    panel.target = LoadRenderTexture((int)bounds.width, (int)bounds.height);
+    panel.draw = std::move(draw);
+    panel.background = background;
+    panels.push_back(std::move(panel));
+    targetCharge.set(targetCharge.bytes() + (size_t)bounds.width * (size_t)bounds.height * 8);
+    return (int)panels.size() - 1;
+}
+
+void RetainedUi::markDirty(int panel) {
+    if (panel >= 0 && panel < (int)panels.size()) panels[panel].dirty = true;
+}
+
+void RetainedUi::markAllDirty() {
+    for (auto& p : panels) p.dirty = true;
+}
+
+bool RetainedUi::anyDirty() const {
+    for (const auto& p : panels)
+        if (p.dirty) return true;
+    return false;
+}
+
+int RetainedUi::update() {
+    int rendered = 0;
+    for (auto& p : panels) {
+        if (!p.dirty) continue;
+        // Shift the camera so callbacks can keep drawing in window coordinates
+        Camera2D camera = { { 0, 0 }, { p.bounds.x, p.bounds.y }, 0.0f, 1.0f };
+        BeginTextureMode(p.target);
+        ClearBackground(p.background);
+        BeginMode2D(camera);
+        p.draw();
+        EndMode2D();
+        EndTextureMode();
+        p.dirty = false;
+        rendered++;
+    }
+    return rendered;
+}
+
+void RetainedUi::composite() const {
+    for (const auto& p : panels) {
+        // Render textures are stored bottom-up; flip with a negative source height
+        Rectangle src = { 0, 0, p.bounds.width, -p.bounds.height };
+        DrawTextureRec(p.target.texture, src, { p.bounds.x, p.bounds.y }, WHITE);
+    }
+}
+
+void RetainedUi::unload() {
+    for (auto& p : panels) UnloadRenderTexture(p.target);
+    panels.clear();
+    targetCharge.set(0);
+}
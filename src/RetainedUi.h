@@ -0,0 +1,64 @@
+#pragma once
+#include "raylib.h"
+#include "MemoryAccounting.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Retained-mode layer for the demo window. Each panel draws once into its own
+// RenderTexture and is only re-rendered after markDirty(); every frame just
+// blits the cached textures. Panel draw callbacks use window coordinates.
+class RetainedUi {
+public:
+    using DrawFn = std::function<void()>;
+
+    RetainedUi() = default;
+    ~RetainedUi();
+
+    RetainedUi(const RetainedUi&) = delete;
+    RetainedUi& operator=(const RetainedUi&) = delete;
+
+    int addPanel(Rectangle bounds, DrawFn draw, Color background = RAYWHITE);
+    void markDirty(int panel);
+    void markAllDirty();
+    bool anyDirty() const;
+
+    // Re-render dirty panels into their textures (call outside BeginDrawing)
+    int update();
+    // Blit every cached panel (call between BeginDrawing/EndDrawing)
+    void composite() const;
+
+    void unload();
+
+private:
+    struct Panel {
+        Rectangle bounds;
+        RenderTexture2D target;
+        DrawFn draw;
+        Color background;
+        bool dirty = true;
+    };
+    std::vector<Panel> panels;
+    MemoryCharge targetCharge{ MemoryTag::Ui }; // render targets: RGBA color + 32-bit depth per pixel
+};
+
+// A label whose display string is rebuilt only when its value changes
+class CachedLabel {
+public:
+    explicit CachedLabel(std::string prefix) : prefix(std::move(prefix)) { text = this->prefix; }
+
+    // Returns true if the text changed (caller marks the owning panel dirty)
+    bool set(const std::string& value) {
+        if (value == current) return false;
+        current = value;
+        text = prefix + value;
+        return true;
+    }
+    const std::string& value() const { return current; }
+    const char* c_str() const { return text.c_str(); }
+
+private:
+    std::string prefix;
+    std::string current;
+    std::string text;
+};
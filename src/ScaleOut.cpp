@@ -0,0 +1,434 @@
+#include "ScaleOut.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace {
+
+const auto HeartbeatTimeout = std::chrono::seconds(5);
+const auto CheckInterval = std::chrono::milliseconds(100);
+const auto RespawnBackoffMin = std::chrono::milliseconds(200);
+const auto RespawnBackoffMax = std::chrono::seconds(30);
+const auto IdleWaitTimeout = std::chrono::milliseconds(50); // bounds heartbeat and supervision gaps while idle
+const unsigned IdleSpins = 2000;
+
+// None for the first restart; then doubling from the minimum
+std::chrono::milliseconds respawnBackoff(unsigned failures) {
+    if (failures == 0) return std::chrono::milliseconds(0);
+    auto delay = RespawnBackoffMin * (1ll << std::min(failures - 1, 16u));
+    return std::min<std::chrono::milliseconds>(delay, RespawnBackoffMax);
+}
+
+const char* formatName(GalleryFormat format) {
+    switch (format) {
+    case GalleryFormat::Jsonl:  return "jsonl";
+    case GalleryFormat::Csv:    return "csv";
+    case GalleryFormat::Binary: return "bin";
+    }
+    return "jsonl";
+}
+
+// Short spin first (requests arrive back to back under load), then block on
+// the wake-up event. The waiting flag goes up before 'ready' rechecks the
+// rings, so a push that raced it is seen either by the recheck or by the
+// producer, which then signals the event.
+template <typename Announce, typename Ready>
+void idleWait(unsigned& spins, HANDLE wake, Announce announce, Ready ready) {
+    if (++spins < IdleSpins) {
+        std::this_thread::yield();
+        return;
+    }
+    announce(1u);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready()) WaitForSingleObject(wake, (DWORD)IdleWaitTimeout.count());
+    announce(0u);
+}
+
+// Producer side, after a push
+void wakePeer(std::atomic<uint32_t>& waiting, HANDLE wake) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) && waiting.exchange(0)) SetEvent(wake);
+}
+
+} // namespace
+
+// ===== Supervisor =====
+
+ScaleOutSupervisor::ScaleOutSupervisor(std::string galleryPath, GalleryFormat format, WorkerPool& pool)
+    : pool(pool), galleryPath(std::move(galleryPath)), format(format) {}
+
+ScaleOutSupervisor::~ScaleOutSupervisor() {
+    stop();
+}
+
+size_t ScaleOutSupervisor::getWorkerCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return workers.size();
+}
+
+size_t ScaleOutSupervisor::getRespawnCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return respawns;
+}
+
+std::string ScaleOutSupervisor::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastError;
+}
+
+bool ScaleOutSupervisor::spawn(size_t index) {
+    Worker& w = workers[index];
+    if (!w.mapping) {
+        w.channelName = "Local\\zkfp_scale_" + std::to_string(GetCurrentProcessId()) + "_" + std::to_string(index);
+        w.mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                       (DWORD)sizeof(ScaleChannel), w.channelName.c_str());
+        void* view = w.mapping ? MapViewOfFile(w.mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ScaleChannel)) : nullptr;
+        if (!view) {
+            lastError = "Cannot create shared memory channel " + w.channelName + ".";
+            return false;
+        }
+        w.channel = static_cast<ScaleChannel*>(view);
+        w.requestsReady = CreateEventA(nullptr, FALSE, FALSE, (w.channelName + "_requests").c_str());
+        if (!w.requestsReady) {
+            lastError = "Cannot create wake-up event for " + w.channelName + ".";
+            return false;
+        }
+    }
+    // The previous owner (if any) is gone, so the channel can be rebuilt from scratch
+    new (w.channel) ScaleChannel();
+    std::snprintf(w.channel->requestEvent, sizeof(w.channel->requestEvent), "%s_requests", w.channelName.c_str());
+    std::snprintf(w.channel->responseEvent, sizeof(w.channel->responseEvent), "%s", responseEventName.c_str());
+
+    char exe[MAX_PATH];
+    GetModuleFileNameA(nullptr, exe, MAX_PATH);
+    std::string cmd = std::string("\"") + exe + "\" --worker " + w.channelName + " --index " + std::to_string(index) +
+                      " --count " + std::to_string(workers.size()) + " --gallery \"" + galleryPath + "\" --format " +
+                      formatName(format);
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi = {};
+    std::vector<char> cmdLine(cmd.begin(), cmd.end());
+    cmdLine.push_back('\0');
+    if (!CreateProcessA(nullptr, cmdLine.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi)) {
+        lastError = "Failed to start worker " + std::to_string(index) + ". Error code: " + std::to_string(GetLastError());
+        return false;
+    }
+    CloseHandle(pi.hThread);
+    w.process = pi.hProcess;
+    w.lastHeartbeat = 0;
+    w.heartbeatSeen = std::chrono::steady_clock::now();
+    w.generation++;
+    return true;
+}
+
+void ScaleOutSupervisor::scheduleRetry(Worker& w, std::chrono::steady_clock::time_point now) {
+    w.retryAt = now + respawnBackoff(w.failures++);
+    if (w.downSince == std::chrono::steady_clock::time_point()) w.downSince = now;
+}
+
+void ScaleOutSupervisor::kill(Worker& w) {
+    if (!w.process) return;
+    TerminateProcess(w.process, 1);
+    WaitForSingleObject(w.process, 2000);
+    CloseHandle(w.process);
+    w.process = nullptr;
+}
+
+bool ScaleOutSupervisor::start(size_t workerCount, std::chrono::milliseconds timeout) {
+    stop();
+    bool ok = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (workerCount == 0) workerCount = 1;
+        workers.resize(workerCount);
+        respawns = 0;
+        readyTimeout = timeout;
+        responseEventName = "Local\\zkfp_scale_" + std::to_string(GetCurrentProcessId()) + "_responses";
+        responsesReady = CreateEventA(nullptr, FALSE, FALSE, responseEventName.c_str());
+        if (!responsesReady) {
+            lastError = "Cannot create wake-up event " + responseEventName + ".";
+            ok = false;
+        }
+        for (size_t i = 0; i < workers.size() && ok; ++i) ok = spawn(i);
+        if (ok) ok = waitReady(timeout);
+    }
+    if (!ok) {
+        stop();
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(timerMutex);
+    supervising = true;
+    timerArmed = true;
+    pool.postAfter(CheckInterval, [this] { onTimer(); }, TaskPriority::Low);
+    return true;
+}
+
+void ScaleOutSupervisor::onTimer() {
+    {
+        // A batch in progress holds the lock and supervises inline
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if (lock.owns_lock()) supervise();
+    }
+    std::lock_guard<std::mutex> lock(timerMutex);
+    if (supervising) {
+        pool.postAfter(CheckInterval, [this] { onTimer(); }, TaskPriority::Low);
+        return;
+    }
+    timerArmed = false;
+    timerIdle.notify_all();
+}
+
+bool ScaleOutSupervisor::waitReady(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        size_t ready = 0;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            auto state = (ScaleWorkerState)workers[i].channel->state.load();
+            if (state == ScaleWorkerState::Failed) {
+                lastError = "Worker " + std::to_string(i) + " failed: " + workers[i].channel->error;
+                return false;
+            }
+            if (state == ScaleWorkerState::Ready) ready++;
+            else if (WaitForSingleObject(workers[i].process, 0) == WAIT_OBJECT_0) {
+                lastError = "Worker " + std::to_string(i) + " exited while loading its shard.";
+                return false;
+            }
+        }
+        if (ready == workers.size()) return true;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            lastError = "Timed out waiting for workers to load the gallery.";
+            return false;
+        }
+        Sleep(10);
+    }
+}
+
+void ScaleOutSupervisor::stop() {
+    {
+        std::unique_lock<std::mutex> lock(timerMutex);
+        supervising = false;
+        timerIdle.wait(lock, [this] { return !timerArmed; });
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Worker& w : workers) {
+        if (w.channel) w.channel->state.store((uint32_t)ScaleWorkerState::Stopping);
+        if (w.requestsReady) SetEvent(w.requestsReady);
+    }
+    for (Worker& w : workers) {
+        if (w.process && WaitForSingleObject(w.process, 2000) != WAIT_OBJECT_0) kill(w);
+        if (w.process) {
+            CloseHandle(w.process);
+            w.process = nullptr;
+        }
+        if (w.channel) UnmapViewOfFile(w.channel);
+        if (w.mapping) CloseHandle(w.mapping);
+        if (w.requestsReady) CloseHandle(w.requestsReady);
+    }
+    workers.clear();
+    if (responsesReady) CloseHandle(responsesReady);
+    responsesReady = nullptr;
+}
+
+void ScaleOutSupervisor::checkWorkers() {
+    std::lock_guard<std::mutex> lock(mutex);
+    supervise();
+}
+
+void ScaleOutSupervisor::supervise() {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        Worker& w = workers[i];
+        if (w.process) {
+            bool dead = WaitForSingleObject(w.process, 0) == WAIT_OBJECT_0;
+            bool hung = false;
+            if (!dead && (ScaleWorkerState)w.channel->state.load() == ScaleWorkerState::Ready) {
+                w.failures = 0;
+                w.downSince = std::chrono::steady_clock::time_point();
+                uint64_t beat = w.channel->heartbeat.load();
+                if (beat != w.lastHeartbeat) {
+                    w.lastHeartbeat = beat;
+                    w.heartbeatSeen = now;
+                } else if (now - w.heartbeatSeen > HeartbeatTimeout) {
+                    hung = true;
+                }
+            }
+            if (!dead && !hung) continue;
+            std::fprintf(stderr, "Worker %zu %s; restarting.\n", i, dead ? "exited" : "stopped responding");
+            kill(w);
+            scheduleRetry(w, now);
+        }
+        if (now < w.retryAt) continue;
+        if (spawn(i)) {
+            respawns++;
+        } else {
+            scheduleRetry(w, now);
+            std::fprintf(stderr, "%s Retrying in %lld ms.\n", lastError.c_str(),
+                         (long long)std::chrono::duration_cast<std::chrono::milliseconds>(w.retryAt - now).count());
+        }
+    }
+}
+
+bool ScaleOutSupervisor::identifyBatch(const std::vector<std::vector<unsigned char>>& probes,
+                                       std::vector<ScaleResult>& results, std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t n = workers.size();
+    if (n == 0) {
+        lastError = "No workers running.";
+        return false;
+    }
+    results.assign(probes.size(), ScaleResult());
+    std::vector<size_t> pending(probes.size(), n); // shards still to answer per probe
+    std::vector<size_t> sent(n, 0), received(n, 0);
+    std::vector<uint64_t> generation(n);
+    for (size_t w = 0; w < n; ++w) generation[w] = workers[w].generation;
+
+    ScaleRequest request;
+    size_t done = 0;
+    auto lastProgress = std::chrono::steady_clock::now();
+    auto lastCheck = lastProgress;
+    unsigned spins = 0;
+
+    while (done < probes.size()) {
+        bool progress = false;
+        for (size_t w = 0; w < n; ++w) {
+            ScaleChannel* ch = workers[w].channel;
+            if (workers[w].generation != generation[w]) {
+                // Restarted: its ring was rebuilt, so resend everything it had not answered
+                generation[w] = workers[w].generation;
+                sent[w] = received[w];
+            }
+            size_t before = sent[w];
+            while (sent[w] < probes.size()) {
+                const std::vector<unsigned char>& tpl = probes[sent[w]];
+                request.id = sent[w];
+                request.size = (uint32_t)std::min<size_t>(tpl.size(), MAX_TEMPLATE_SIZE);
+                std::memcpy(request.tpl, tpl.data(), request.size);
+                if (!ch->requests.push(request)) break;
+                sent[w]++;
+            }
+            if (sent[w] != before) wakePeer(ch->workerWaiting, workers[w].requestsReady);
+            ScaleResponse response;
+            while (ch->responses.pop(response)) {
+                if (response.id != received[w]) continue; // stale answer from before a restart
+                received[w]++;
+                ScaleResult& r = results[response.id];
+                if (response.result == ZKFP_ERR_OK && (!r.ok() || response.score > r.score)) {
+                    r.result = ZKFP_ERR_OK;
+                    r.fid = response.fid;
+                    r.score = response.score;
+                } else if (!r.ok()) {
+                    r.result = response.result;
+                }
+                if (--pending[response.id] == 0) done++;
+                progress = true;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (progress) {
+            lastProgress = now;
+            spins = 0;
+            continue;
+        }
+        if (now - lastCheck > CheckInterval) {
+            supervise();
+            lastCheck = now;
+        }
+        // A restarting shard has to reload before it can answer; that wait is
+        // bounded by the ready timeout instead of the batch timeout
+        bool reloading = false;
+        for (size_t w = 0; w < n; ++w) {
+            const Worker& worker = workers[w];
+            if (worker.downSince == std::chrono::steady_clock::time_point()) continue;
+            if (now - worker.downSince > readyTimeout) {
+                lastError = "Worker " + std::to_string(w) + " has not come back within " +
+                            std::to_string(readyTimeout.count()) + " ms; " +
+                            std::to_string(probes.size() - done) + " probes unanswered.";
+                return false;
+            }
+            reloading = true;
+        }
+        if (reloading) lastProgress = now;
+        if (now - lastProgress > timeout) {
+            lastError = "Identify timed out with " + std::to_string(probes.size() - done) + " probes unanswered.";
+            return false;
+        }
+        idleWait(spins, responsesReady,
+                 [&](uint32_t waiting) {
+                     for (const Worker& worker : workers) worker.channel->frontWaiting.store(waiting);
+                 },
+                 [&] {
+                     return std::any_of(workers.begin(), workers.end(),
+                                        [](const Worker& worker) { return worker.channel->responses.size() > 0; });
+                 });
+    }
+    return true;
+}
+
+// ===== Worker process =====
+
+int runScaleOutWorker(const std::string& channelName, size_t index, size_t count,
+                      const std::string& galleryPath, GalleryFormat format) {
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, channelName.c_str());
+    ScaleChannel* ch = mapping ? static_cast<ScaleChannel*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ScaleChannel)))
+                               : nullptr;
+    if (!ch) return 2;
+
+    auto fail = [&](const std::string& error) {
+        std::snprintf(ch->error, sizeof(ch->error), "%s", error.c_str());
+        ch->state.store((uint32_t)ScaleWorkerState::Failed);
+        return 1;
+    };
+
+    FingerprintDevice fp;
+    if (!fp.initialize()) return fail(fp.getLastError());
+
+    // Workers are one per core already; keep each process's decode pool small
+    GalleryImporter importer(fp, WorkerPool::shared(2));
+    importer.setFidFilter([index, count](unsigned int fid) { return fid % count == index; });
+    TransferStats stats;
+    if (!importer.run(galleryPath, format, "", stats)) return fail(importer.getLastError());
+
+    HANDLE requestsReady = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, ch->requestEvent);
+    HANDLE responsesReady = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, ch->responseEvent);
+    if (!requestsReady || !responsesReady) {
+        if (requestsReady) CloseHandle(requestsReady);
+        if (responsesReady) CloseHandle(responsesReady);
+        return fail("Cannot open the channel's wake-up events.");
+    }
+
+    ch->templates.store(fp.getEnrolledCount());
+    ch->state.store((uint32_t)ScaleWorkerState::Ready);
+
+    // Requests are ~2 KB; keep them off the stack
+    static ScaleRequest request;
+    unsigned spins = 0;
+    auto stopping = [ch] { return (ScaleWorkerState)ch->state.load() == ScaleWorkerState::Stopping; };
+    while (!stopping()) {
+        ch->heartbeat.fetch_add(1, std::memory_order_relaxed);
+        if (!ch->requests.pop(request)) {
+            idleWait(spins, requestsReady, [ch](uint32_t waiting) { ch->workerWaiting.store(waiting); },
+                     [&] { return ch->requests.size() > 0 || stopping(); });
+            continue;
+        }
+        spins = 0;
+        ScaleResponse response{ request.id, ZKFP_ERR_OK, 0, 0 };
+        if (!fp.identifyTemplate(request.tpl, request.size, response.fid, response.score))
+            response.result = fp.getLastErrorCode();
+        while (!ch->responses.push(response)) {
+            if (stopping()) break;
+            std::this_thread::yield();
+        }
+        wakePeer(ch->frontWaiting, responsesReady);
+    }
+
+    fp.terminate();
+    CloseHandle(requestsReady);
+    CloseHandle(responsesReady);
+    UnmapViewOfFile(ch);
+    CloseHandle(mapping);
+    return 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "GalleryTransfer.h"
+#include "ShmRing.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Identify scale-out across processes. Each worker process runs its own SDK
+// instance (ZKFPM_Init is process-global) holding the shard of the gallery
+// with fid % workers == index. The front end fans every probe out to all
+// shards over shared-memory rings and keeps the best hit.
+
+struct ScaleRequest {
+    uint64_t id;
+    uint32_t size;
+    unsigned char tpl[MAX_TEMPLATE_SIZE];
+};
+
+struct ScaleResponse {
+    uint64_t id;
+    int32_t result;   // ZKFP_ERR_* from DBIdentify
+    uint32_t fid;
+    uint32_t score;
+};
+
+enum class ScaleWorkerState : uint32_t { Starting = 0, Ready = 1, Failed = 2, Stopping = 3 };
+
+// One mapping per worker; created and placement-constructed by the supervisor.
+// An idle side blocks on a named auto-reset event after raising its waiting
+// flag; the other side signals the event after a push only if the flag is up.
+struct ScaleChannel {
+    static constexpr uint32_t RingSize = 64;
+
+    std::atomic<uint32_t> state{ (uint32_t)ScaleWorkerState::Starting };
+    std::atomic<uint64_t> heartbeat{ 0 }; // bumped by the worker while it polls
+    std::atomic<uint64_t> templates{ 0 }; // shard size once Ready
+    std::atomic<uint32_t> workerWaiting{ 0 }; // worker is blocking on requestEvent
+    std::atomic<uint32_t> frontWaiting{ 0 };  // front end is blocking on responseEvent
+    char requestEvent[64] = {};  // this channel's, signalled after requests are pushed
+    char responseEvent[64] = {}; // the supervisor's, shared by all channels
+    char error[256] = {};
+    ShmRing<ScaleRequest, RingSize> requests;   // front end -> worker
+    ShmRing<ScaleResponse, RingSize> responses; // worker -> front end
+};
+
+struct ScaleResult {
+    int result = ZKFP_ERR_FAIL;
+    unsigned int fid = 0;
+    unsigned int score = 0;
+    bool ok() const { return result == ZKFP_ERR_OK; }
+};
+
+// Workers are supervised from a pool timer between batches, and inline while
+// a batch runs. A dead or hung worker is restarted at once; one that fails to
+// start, or dies again before its shard is loaded, is retried with growing
+// backoff. A batch waits for a restarting shard to reload (up to the start()
+// ready timeout) without counting that time against its own timeout.
+class ScaleOutSupervisor {
+public:
+    ScaleOutSupervisor(std::string galleryPath, GalleryFormat format, WorkerPool& pool = WorkerPool::shared());
+    ~ScaleOutSupervisor();
+
+    // Spawns the workers and waits until every shard is loaded
+    bool start(size_t workerCount, std::chrono::milliseconds readyTimeout = std::chrono::minutes(5));
+    void stop();
+
+    // Fans each probe out to all shards, keeping up to a ring's worth in flight
+    bool identifyBatch(const std::vector<std::vector<unsigned char>>& probes, std::vector<ScaleResult>& results,
+                       std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+    // Dead (exited) or hung (stale heartbeat) workers are restarted on the same channel
+    void checkWorkers();
+
+    size_t getWorkerCount() const;
+    size_t getRespawnCount() const;
+    std::string getLastError() const;
+
+private:
+    struct Worker {
+        std::string channelName;
+        HANDLE mapping = nullptr;
+        ScaleChannel* channel = nullptr;
+        HANDLE requestsReady = nullptr; // the channel's request event
+        HANDLE process = nullptr; // null while waiting to be (re)spawned
+        uint64_t lastHeartbeat = 0;
+        std::chrono::steady_clock::time_point heartbeatSeen;
+        uint64_t generation = 0; // bumped on every (re)spawn
+        unsigned failures = 0;   // restarts in a row that never got to Ready
+        std::chrono::steady_clock::time_point retryAt;   // next spawn attempt while process is null
+        std::chrono::steady_clock::time_point downSince; // set while the shard is not serving
+    };
+
+    bool spawn(size_t index);
+    void kill(Worker& w);
+    bool waitReady(std::chrono::milliseconds timeout);
+    void supervise(); // caller holds mutex
+    void scheduleRetry(Worker& w, std::chrono::steady_clock::time_point now);
+    void onTimer();
+
+    WorkerPool& pool;
+    std::string galleryPath;
+    GalleryFormat format;
+    std::chrono::milliseconds readyTimeout{ 0 };
+    std::string responseEventName;
+    HANDLE responsesReady = nullptr; // any worker pushed a response
+    mutable std::mutex mutex; // guards the workers and the fields below; held for a whole batch
+    std::vector<Worker> workers;
+    size_t respawns = 0;
+    std::string lastError;
+    std::mutex timerMutex;
+    std::condition_variable timerIdle;
+    bool supervising = false; // the timer re-arms itself while set
+    bool timerArmed = false;
+};
+
+// Entry point for a worker process (see ScaleTool --worker)
+int runScaleOutWorker(const std::string& channelName, size_t index, size_t count,
+                      const std::string& galleryPath, GalleryFormat format);
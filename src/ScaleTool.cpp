@@ -0,0 +1,129 @@
+#include "FingerprintDevice.h"
+#include "GalleryTransfer.h"
+#include "ScaleOut.h"
+#include "WorkerPool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Multi-process identify: one SDK instance per worker process, each holding a
+// shard of the gallery.
+//
+//   scale_tool --gallery <dump> [--format jsonl|csv|bin] [--workers N]
+//              [--probes M] [--bench]
+//
+// --bench runs the probe set with 1, 2, ... N workers and prints throughput.
+// The tool re-launches itself with --worker for each shard.
+
+static void printUsage() {
+    std::printf("Usage: scale_tool --gallery <dump> [--format jsonl|csv|bin] [--workers N]\n"
+                "                  [--probes M] [--bench]\n");
+}
+
+// Probes are templates taken from the gallery itself, so every one should match
+static bool loadProbes(const std::string& path, GalleryFormat format, size_t count,
+                       std::vector<std::vector<unsigned char>>& probes) {
+    FingerprintDevice fp;
+    if (!fp.initialize()) {
+        std::fprintf(stderr, "%s\n", fp.getLastError().c_str());
+        return false;
+    }
+    GalleryImporter importer(fp);
+    importer.setFidFilter([](unsigned int fid) { return fid % 7 == 0; });
+    TransferStats stats;
+    if (!importer.run(path, format, "", stats)) {
+        std::fprintf(stderr, "Cannot read probes: %s\n", importer.getLastError().c_str());
+        fp.terminate();
+        return false;
+    }
+    for (const GalleryEntry& e : fp.snapshotGallery()) {
+        if (probes.size() >= count) break;
+        probes.emplace_back(e.data, e.data + e.size);
+    }
+    fp.terminate();
+    return !probes.empty();
+}
+
+static int runWorker(int argc, char** argv) {
+    std::string channel, gallery, formatName;
+    size_t index = 0, count = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--worker") channel = next();
+        else if (arg == "--index") index = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--count") count = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--gallery") gallery = next();
+        else if (arg == "--format") formatName = next();
+    }
+    GalleryFormat format = guessGalleryFormat(gallery);
+    parseGalleryFormat(formatName, format);
+    return runScaleOutWorker(channel, index, count ? count : 1, gallery, format);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--worker") return runWorker(argc, argv);
+
+    std::string galleryPath, formatName;
+    size_t workerCount = 0, probeCount = 1000;
+    bool bench = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--gallery") galleryPath = next();
+        else if (arg == "--format") formatName = next();
+        else if (arg == "--workers") workerCount = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--probes") probeCount = (size_t)std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--bench") bench = true;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (galleryPath.empty()) {
+        printUsage();
+        return 1;
+    }
+    GalleryFormat format = guessGalleryFormat(galleryPath);
+    if (!formatName.empty() && !parseGalleryFormat(formatName, format)) {
+        std::fprintf(stderr, "Unknown format: %s\n", formatName.c_str());
+        return 1;
+    }
+    if (workerCount == 0) workerCount = WorkerPool::shared().size();
+
+    std::vector<std::vector<unsigned char>> probes;
+    if (!loadProbes(galleryPath, format, probeCount, probes)) return 1;
+    std::printf("%zu probes\n", probes.size());
+
+    double baseline = 0.0;
+    for (size_t n = bench ? 1 : workerCount; n <= workerCount; ++n) {
+        ScaleOutSupervisor supervisor(galleryPath, format);
+        auto loadStart = std::chrono::steady_clock::now();
+        if (!supervisor.start(n)) {
+            std::fprintf(stderr, "%s\n", supervisor.getLastError().c_str());
+            return 1;
+        }
+        double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+        std::vector<ScaleResult> results;
+        auto started = std::chrono::steady_clock::now();
+        if (!supervisor.identifyBatch(probes, results)) {
+            std::fprintf(stderr, "%s\n", supervisor.getLastError().c_str());
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        size_t matched = 0;
+        for (const ScaleResult& r : results) matched += r.ok();
+        double rate = seconds > 0.0 ? probes.size() / seconds : 0.0;
+        if (n == (bench ? 1 : workerCount)) baseline = rate;
+        std::printf("workers %2zu: load %.2f s, %.0f identifies/sec (x%.2f), %zu/%zu matched, %zu restarts\n",
+                    n, loadSeconds, rate, baseline > 0.0 ? rate / baseline : 0.0, matched, probes.size(),
+                    supervisor.getRespawnCount());
+        supervisor.stop();
+    }
+    return 0;
+}
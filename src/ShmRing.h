@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Single-producer/single-consumer ring meant to live in memory shared between
+// processes. Only address-free lock-free atomics are used, so it works from
+// any mapping of the same pages. Construct in place once (placement new) by
+// the side that creates the mapping.
+template <typename T, uint32_t Capacity>
+struct ShmRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices must be lock-free");
+
+    alignas(64) std::atomic<uint64_t> head{ 0 }; // next slot the producer writes
+    alignas(64) std::atomic<uint64_t> tail{ 0 }; // next slot the consumer reads
+    alignas(64) T slots[Capacity];
+
+    void reset() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_release);
+    }
+
+    // Producer side; false when full
+    bool push(const T& item) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= Capacity) return false;
+        slots[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; false when empty
+    bool pop(T& item) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = slots[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+};
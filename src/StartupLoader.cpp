@@ -0,0 +1,172 @@
+#include "StartupLoader.h"
+#include <cstdio>
+
+std::string StartupProgress::summary() const {
+    if (!sdkError.empty()) return "SDK init failed: " + sdkError;
+    if (!sdkReady) return "Initializing SDK...";
+
+    std::string text = deviceReady ? "Device ready" : (deviceError.empty() ? "Opening device..." : "Device failed");
+    char buf[160];
+    if (galleryReady) {
+        std::snprintf(buf, sizeof(buf), ", gallery loaded (%llu templates)", (unsigned long long)gallery.imported);
+    } else if (!galleryError.empty()) {
+        std::snprintf(buf, sizeof(buf), ", gallery failed");
+    } else {
+        std::snprintf(buf, sizeof(buf), ", loading gallery %.0f%% (%llu templates)",
+                      100.0 * galleryFraction(), (unsigned long long)gallery.imported);
+    }
+    return text + buf;
+}
+
+StartupLoader::StartupLoader(FingerprintDevice& device, WorkerPool& pool) : device(device), pool(pool) {}
+
+StartupLoader::~StartupLoader() {
+    wait();
+}
+
+bool StartupLoader::start(int deviceIndex, const std::string& galleryPath, GalleryFormat format) {
+    if (busy()) return false;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        state = StartupProgress();
+        state.running = true;
+        state.deviceReady = deviceIndex < 0;
+        state.galleryReady = galleryPath.empty();
+    }
+    started = Clock::now();
+    firstMatchNanos = -1;
+    pending = 1;
+    pool.post([this, deviceIndex, galleryPath, format] { runSdkInit(deviceIndex, galleryPath, format); },
+              TaskPriority::High);
+    return true;
+}
+
+void StartupLoader::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    idle.wait(lock, [this] { return pending.load() == 0; });
+}
+
+void StartupLoader::finishJob() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (--pending == 0) {
+        state.running = false;
+        state.elapsedSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+        idle.notify_all();
+    }
+}
+
+StartupProgress StartupLoader::progress() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    StartupProgress p = state;
+    if (p.running) p.elapsedSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+    return p;
+}
+
+// ===== Startup steps =====
+
+void StartupLoader::runSdkInit(int deviceIndex, std::string galleryPath, GalleryFormat format) {
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ok = device.initialize();
+        std::lock_guard<std::mutex> stateLock(stateMutex);
+        if (ok) state.sdkReady = true;
+        else state.sdkError = device.getLastError();
+    }
+    if (ok) {
+        // Opening the sensor (USB round trips) overlaps reading/decoding the gallery
+        if (deviceIndex >= 0) {
+            pending++;
+            pool.post([this, deviceIndex] { runDeviceOpen(deviceIndex); }, TaskPriority::High);
+        }
+        if (!galleryPath.empty()) {
+            pending++;
+            pool.post([this, galleryPath, format] { runGalleryLoad(galleryPath, format); }, TaskPriority::Normal);
+        }
+    }
+    finishJob();
+}
+
+void StartupLoader::runDeviceOpen(int deviceIndex) {
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int count = device.getDeviceCount();
+        if (count <= deviceIndex) error = "No device at index " + std::to_string(deviceIndex) + ".";
+        else if (!device.openDevice(deviceIndex)) error = device.getLastError();
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (error.empty()) state.deviceReady = true;
+        else state.deviceError = error;
+    }
+    finishJob();
+}
+
+void StartupLoader::runGalleryLoad(std::string galleryPath, GalleryFormat format) {
+    // Small batches keep each hold on the device mutex short
+    GalleryImporter importer(device, pool, 512);
+    importer.setCommitMutex(&mutex);
+    importer.setProgressCallback([this](const TransferStats& stats) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        state.gallery = stats;
+    });
+    TransferStats stats;
+    bool ok = importer.run(galleryPath, format, "", stats);
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        state.gallery = stats;
+        if (ok) state.galleryReady = true;
+        else state.galleryError = importer.getLastError();
+    }
+    finishJob();
+}
+
+// ===== Matching during warm-up =====
+
+void StartupLoader::noteMatch() {
+    int64_t expected = -1;
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count();
+    firstMatchNanos.compare_exchange_strong(expected, now);
+}
+
+double StartupLoader::timeToFirstMatch() const {
+    int64_t nanos = firstMatchNanos.load();
+    return nanos < 0 ? -1.0 : nanos / 1e9;
+}
+
+bool StartupLoader::verify(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score, std::string& error) {
+    StartupProgress p = progress();
+    if (!p.sdkReady) {
+        error = "SDK is still starting.";
+        return false;
+    }
+    if (!device.isEnrolled(fid)) {
+        error = p.galleryReady ? "FID " + std::to_string(fid) + " is not enrolled."
+                               : "FID " + std::to_string(fid) + " is not loaded yet (" + p.summary() + ").";
+        return false;
+    }
+    if (!device.verifyTemplate(fid, tpl, size, score)) {
+        error = device.getLastError();
+        return false;
+    }
+    noteMatch();
+    return true;
+}
+
+bool StartupLoader::identify(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score,
+                             std::string& error) {
+    StartupProgress p = progress();
+    if (!p.sdkReady) {
+        error = "SDK is still starting.";
+        return false;
+    }
+    if (!device.identifyTemplate(tpl, size, fid, score)) {
+        error = device.getLastError();
+        if (!p.galleryReady)
+            error += " (searched " + std::to_string(device.getEnrolledCount()) + " templates loaded so far)";
+        return false;
+    }
+    noteMatch();
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "GalleryTransfer.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+struct StartupProgress {
+    bool running = false;
+    bool sdkReady = false;
+    bool deviceReady = false;
+    bool galleryReady = false;
+    std::string deviceError;  // empty unless the device step failed
+    std::string galleryError; // empty unless the gallery step failed
+    std::string sdkError;
+    TransferStats gallery;    // records/bytes loaded so far
+    double elapsedSeconds = 0.0;
+
+    double galleryFraction() const {
+        if (galleryReady) return 1.0;
+        return gallery.totalBytes ? (double)gallery.position / gallery.totalBytes : 0.0;
+    }
+    std::string summary() const;
+};
+
+// Brings the SDK up off the render thread. SDK init runs first; device open
+// and the gallery load then run side by side on the shared pool. Progress is
+// polled with progress() each frame.
+//
+// While busy(), every call into the device from other threads must hold
+// deviceMutex(); the gallery load only takes it per committed batch, so
+// verify/identify against the FIDs loaded so far work during warm-up.
+class StartupLoader {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StartupLoader(FingerprintDevice& device, WorkerPool& pool = WorkerPool::shared());
+    ~StartupLoader();
+
+    // deviceIndex < 0 skips opening a sensor (replay); an empty galleryPath skips the load
+    bool start(int deviceIndex, const std::string& galleryPath, GalleryFormat format);
+    bool busy() const { return pending.load() != 0; }
+    void wait();
+
+    StartupProgress progress() const;
+    std::mutex& deviceMutex() { return mutex; }
+
+    // Caller holds deviceMutex() while busy(). A miss on a FID that has not
+    // been loaded yet says so instead of reporting "no match".
+    bool verify(unsigned int fid, const unsigned char* tpl, unsigned int size, int& score, std::string& error);
+    bool identify(const unsigned char* tpl, unsigned int size, unsigned int& fid, unsigned int& score, std::string& error);
+
+    // Seconds from start() to the first successful verify/identify, or -1
+    double timeToFirstMatch() const;
+
+private:
+    void runSdkInit(int deviceIndex, std::string galleryPath, GalleryFormat format);
+    void runDeviceOpen(int deviceIndex);
+    void runGalleryLoad(std::string galleryPath, GalleryFormat format);
+    void finishJob();
+    void noteMatch();
+
+    FingerprintDevice& device;
+    WorkerPool& pool;
+    std::mutex mutex;                   // guards the device
+    mutable std::mutex stateMutex;      // guards state
+    std::condition_variable idle;
+    std::atomic<int> pending{ 0 };
+    StartupProgress state;
+    Clock::time_point started;
+    std::atomic<int64_t> firstMatchNanos{ -1 };
+};
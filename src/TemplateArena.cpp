@@ -0,0 +1,126 @@
+#include "TemplateArena.h"
+#include <cstring>
+
+uint64_t TemplateArena::hashBytes(const unsigned char* data, unsigned int size) {
+    // FNV-1a, 64-bit
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned int i = 0; i < size; ++i) {
+        h ^= data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+TemplateArena::Handle TemplateArena::find(const unsigned char* data, unsigned int size) const {
+    uint64_t h = hashBytes(data, size);
+    auto range = interned.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Slot& slot = slots[it->second];
+        const RecordHeader* hdr = reinterpret_cast<const RecordHeader*>(slab.data() + slot.offset);
+        if (hdr->size == size && std::memcmp(slab.data() + slot.offset + sizeof(RecordHeader), data, size) == 0)
+            return it->second;
+    }
+    return InvalidHandle;
+}
+
+TemplateArena::Handle TemplateArena::add(const unsigned char* data, unsigned int size) {
+    if (!data || size == 0) return InvalidHandle;
+
+    Handle existing = find(data, size);
+    if (existing != InvalidHandle) {
+        slots[existing].refs++;
+        return existing;
+    }
+
+    Handle handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = static_cast<Handle>(slots.size());
+        slots.emplace_back();
+    }
+
+    size_t offset = slab.size();
+    const unsigned char* base = slab.data();
+    slab.resize(offset + recordSpan(size));
+    if (slab.data() != base) layout++;
+    RecordHeader hdr{ size, handle };
+    std::memcpy(slab.data() + offset, &hdr, sizeof(hdr));
+    std::memcpy(slab.data() + offset + sizeof(hdr), data, size);
+
+    Slot& slot = slots[handle];
+    slot.offset = static_cast<uint32_t>(offset);
+    slot.refs = 1;
+    slot.hash = hashBytes(data, size);
+    interned.emplace(slot.hash, handle);
+    liveCount++;
+    return handle;
+}
+
+bool TemplateArena::contains(Handle handle) const {
+    return handle < slots.size() && slots[handle].refs > 0;
+}
+
+bool TemplateArena::get(Handle handle, const unsigned char*& data, unsigned int& size) const {
+    if (!contains(handle)) return false;
+    const RecordHeader* hdr = reinterpret_cast<const RecordHeader*>(slab.data() + slots[handle].offset);
+    data = slab.data() + slots[handle].offset + sizeof(RecordHeader);
+    size = hdr->size;
+    return true;
+}
+
+bool TemplateArena::release(Handle handle) {
+    if (!contains(handle)) return false;
+    Slot& slot = slots[handle];
+    if (--slot.refs > 0) return true;
+
+    auto range = interned.equal_range(slot.hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == handle) {
+            interned.erase(it);
+            break;
+        }
+    }
+
+    RecordHeader* hdr = reinterpret_cast<RecordHeader*>(slab.data() + slot.offset);
+    hdr->handle = InvalidHandle;
+    deadBytes += recordSpan(hdr->size);
+    freeHandles.push_back(handle);
+    liveCount--;
+
+    // Reclaim once at least half the slab is garbage
+    if (deadBytes * 2 >= slab.size()) compact();
+    return true;
+}
+
+void TemplateArena::compact() {
+    if (deadBytes == 0) return;
+    size_t read = 0, write = 0;
+    while (read < slab.size()) {
+        RecordHeader hdr;
+        std::memcpy(&hdr, slab.data() + read, sizeof(hdr));
+        size_t span = recordSpan(hdr.size);
+        if (hdr.handle != InvalidHandle) {
+            if (write != read) std::memmove(slab.data() + write, slab.data() + read, span);
+            slots[hdr.handle].offset = static_cast<uint32_t>(write);
+            write += span;
+        }
+        read += span;
+    }
+    slab.resize(write);
+    slab.shrink_to_fit();
+    deadBytes = 0;
+    layout++;
+}
+
+void TemplateArena::clear() {
+    slab.clear();
+    slab.shrink_to_fit();
+    slots.clear();
+    freeHandles.clear();
+    interned.clear();
+    deadBytes = 0;
+    liveCount = 0;
+    layout++;
+}
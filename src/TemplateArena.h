@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include "MemoryAccounting.h"
+
+// Append-only slab of fingerprint templates. Each record is stored as
+// [uint32 size][uint32 handle][bytes...] padded to 4 bytes, so a gallery scan
+// walks one contiguous buffer instead of chasing 2048-byte stack copies.
+// Handles stay valid across compaction; identical templates are interned
+// and share one record (reference counted).
+class TemplateArena {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle InvalidHandle = 0xFFFFFFFFu;
+
+    TemplateArena() = default;
+
+    // Store a template, returning the existing handle if the same bytes are already present
+    Handle add(const unsigned char* data, unsigned int size);
+    // Drop one reference; the record is reclaimed when the last reference goes
+    bool release(Handle handle);
+    void clear();
+
+    bool get(Handle handle, const unsigned char*& data, unsigned int& size) const;
+    bool contains(Handle handle) const;
+    Handle find(const unsigned char* data, unsigned int size) const;
+
+    // Slide live records down over dead space; handles are preserved
+    void compact();
+
+    // Walk live records in slab order (cache-friendly). fn(handle, data, size)
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        size_t off = 0;
+        while (off < slab.size()) {
+            const RecordHeader* hdr = reinterpret_cast<const RecordHeader*>(slab.data() + off);
+            if (hdr->handle != InvalidHandle)
+                fn(hdr->handle, slab.data() + off + sizeof(RecordHeader), hdr->size);
+            off += recordSpan(hdr->size);
+        }
+    }
+
+    // Changes whenever records may have moved (slab growth, compaction, clear);
+    // pointers from get() stay valid while it does not
+    uint64_t layoutVersion() const { return layout; }
+
+    size_t count() const { return liveCount; }
+    size_t bytesUsed() const { return slab.size() - deadBytes; }
+    size_t bytesReserved() const { return slab.capacity(); }
+
+    static uint64_t hashBytes(const unsigned char* data, unsigned int size);
+
+private:
+    struct RecordHeader {
+        uint32_t size;
+        uint32_t handle; // InvalidHandle once the record is dead
+    };
+
+    struct Slot {
+        uint32_t offset = 0;
+        uint32_t refs = 0;
+        uint64_t hash = 0;
+    };
+
+    static size_t recordSpan(uint32_t size) {
+        return sizeof(RecordHeader) + ((size + 3u) & ~size_t(3));
+    }
+
+    TrackedVector<MemoryTag::Gallery, unsigned char> slab;
+    TrackedVector<MemoryTag::Gallery, Slot> slots;  // indexed by handle
+    TrackedVector<MemoryTag::Gallery, Handle> freeHandles;
+    std::unordered_multimap<uint64_t, Handle, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                            TrackingAllocator<std::pair<const uint64_t, Handle>, MemoryTag::Gallery>> interned;
+    size_t deadBytes = 0;
+    size_t liveCount = 0;
+    uint64_t layout = 0;
+};
@@ -0,0 +1,142 @@
+#include "TextViews.h"
+#include <algorithm>
+#include <cstring>
+
+// ===== LogRing =====
+
+LogRing::LogRing(size_t capacityBytes, size_t maxLines, size_t maxLineLength)
+    : ring(std::max(capacityBytes, maxLineLength)), maxLines(maxLines), maxLineLength(maxLineLength) {}
+
+void LogRing::append(const std::string& text) {
+    for (char c : text) {
+        if (c == '\n') {
+            if (!lineOpen) lines.push_back({ written, 0 });
+            lineOpen = false;
+            continue;
+        }
+        if (!lineOpen) {
+            lines.push_back({ written, 0 });
+            lineOpen = true;
+        }
+        LineRef& current = lines.back();
+        if (current.length >= maxLineLength) continue; // truncate overlong lines
+        ring[written % ring.size()] = c;
+        written++;
+        current.length++;
+        evict();
+    }
+    evict();
+    generation++;
+}
+
+void LogRing::evict() {
+    while (!lines.empty() && (written - lines.front().start > ring.size() || lines.size() > maxLines))
+        lines.pop_front();
+}
+
+void LogRing::clear() {
+    lines.clear();
+    written = 0;
+    lineOpen = false;
+    generation++;
+}
+
+size_t LogRing::copyRow(size_t i, char* out, size_t cap) const {
+    if (cap == 0) return 0;
+    if (i >= lines.size()) {
+        out[0] = '\0';
+        return 0;
+    }
+    const LineRef& line = lines[i];
+    size_t n = std::min<size_t>(line.length, cap - 1);
+    for (size_t k = 0; k < n; ++k) out[k] = ring[(line.start + k) % ring.size()];
+    out[n] = '\0';
+    return n;
+}
+
+// ===== WrappedTextSource =====
+
+void WrappedTextSource::setText(const std::string& value) {
+    if (value == text) return;
+    text = value;
+    generation++;
+}
+
+size_t WrappedTextSource::copyRow(size_t i, char* out, size_t cap) const {
+    if (cap == 0) return 0;
+    size_t start = i * columns;
+    size_t n = start < text.size() ? std::min({ columns, text.size() - start, cap - 1 }) : 0;
+    if (n) std::memcpy(out, text.data() + start, n);
+    out[n] = '\0';
+    return n;
+}
+
+// ===== VirtualTextView =====
+
+VirtualTextView::VirtualTextView(Rectangle bounds, int fontSize, Color color, bool followTail)
+    : bounds(bounds), fontSize(fontSize), lineHeight(fontSize + 2), color(color), tail(followTail) {}
+
+size_t VirtualTextView::visibleRows() const {
+    return std::max(1, (int)bounds.height / lineHeight);
+}
+
+size_t VirtualTextView::firstVisibleRow() const {
+    size_t count = source ? source->rowCount() : 0;
+    size_t visible = visibleRows();
+    size_t maxFirst = count > visible ? count - visible : 0;
+    return tail ? maxFirst : std::min(firstRow, maxFirst);
+}
+
+void VirtualTextView::scrollBy(long long rows) {
+    size_t count = source ? source->rowCount() : 0;
+    size_t visible = visibleRows();
+    long long maxFirst = count > visible ? (long long)(count - visible) : 0;
+    long long next = std::clamp((long long)firstVisibleRow() + rows, 0LL, maxFirst);
+    firstRow = (size_t)next;
+    tail = (next == maxFirst);
+}
+
+bool VirtualTextView::update() {
+    size_t before = firstVisibleRow();
+
+    if (source && CheckCollisionPointRec(GetMousePosition(), bounds)) {
+        long long page = (long long)visibleRows();
+        float wheel = GetMouseWheelMove();
+        if (wheel != 0.0f) scrollBy((long long)(-wheel * 3));
+        if (IsKeyPressed(KEY_PAGE_UP)) scrollBy(-page);
+        if (IsKeyPressed(KEY_PAGE_DOWN)) scrollBy(page);
+        if (IsKeyPressed(KEY_HOME)) scrollBy(-(long long)source->rowCount());
+        if (IsKeyPressed(KEY_END)) scrollBy((long long)source->rowCount());
+    }
+
+    bool changed = firstVisibleRow() != before;
+    uint64_t generation = source ? source->getGeneration() : 0;
+    if (generation != seenGeneration) {
+        seenGeneration = generation;
+        changed = true;
+    }
+    return changed;
+}
+
+void VirtualTextView::draw() const {
+    if (!source) return;
+    size_t count = source->rowCount();
+    size_t first = firstVisibleRow();
+    size_t last = std::min(count, first + visibleRows());
+
+    char row[1024];
+    int y = (int)bounds.y;
+    for (size_t i = first; i < last; ++i) {
+        source->copyRow(i, row, sizeof(row));
+        DrawText(row, (int)bounds.x, y, fontSize, color);
+        y += lineHeight;
+    }
+
+    // Scrollbar thumb when there is more than one page
+    if (count > visibleRows()) {
+        float trackX = bounds.x + bounds.width - 4;
+        float thumbH = std::max(8.0f, bounds.height * visibleRows() / count);
+        float thumbY = bounds.y + (bounds.height - thumbH) * first / (count - visibleRows());
+        DrawRectangleRec({ trackX, thumbY, 4, thumbH }, LIGHTGRAY);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "raylib.h"
+#include "MemoryAccounting.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Anything a VirtualTextView can page through, one row at a time
+class RowSource {
+public:
+    virtual ~RowSource() = default;
+    virtual size_t rowCount() const = 0;
+    // Copy row i into out (NUL-terminated, truncated to cap-1); returns its length
+    virtual size_t copyRow(size_t i, char* out, size_t cap) const = 0;
+    // Bumped on every change so views/panels know when to redraw
+    uint64_t getGeneration() const { return generation; }
+
+protected:
+    uint64_t generation = 0;
+};
+
+// Bounded log: characters live in a fixed ring, with a line index on top.
+// Oldest lines are evicted once either the byte or the line limit is hit.
+class LogRing : public RowSource {
+public:
+    explicit LogRing(size_t capacityBytes = 64 * 1024, size_t maxLines = 2048, size_t maxLineLength = 512);
+
+    void append(const std::string& text);
+    void clear();
+
+    size_t rowCount() const override { return lines.size(); }
+    size_t copyRow(size_t i, char* out, size_t cap) const override;
+
+private:
+    struct LineRef {
+        uint64_t start; // absolute write position of the first character
+        uint32_t length;
+    };
+
+    void evict();
+
+    TrackedVector<MemoryTag::Logging, char> ring;
+    TrackedDeque<MemoryTag::Logging, LineRef> lines;
+    uint64_t written = 0;
+    bool lineOpen = false;
+    size_t maxLines;
+    size_t maxLineLength;
+};
+
+// Fixed-width rows over one string (e.g. the HEX dump of a template)
+class WrappedTextSource : public RowSource {
+public:
+    explicit WrappedTextSource(size_t columns = 64) : columns(columns) {}
+
+    void setText(const std::string& value);
+    const std::string& getText() const { return text; }
+
+    size_t rowCount() const override { return (text.size() + columns - 1) / columns; }
+    size_t copyRow(size_t i, char* out, size_t cap) const override;
+
+private:
+    std::string text;
+    size_t columns;
+};
+
+// Draws only the rows that fit in its bounds; scrolls with the mouse wheel
+// and PageUp/PageDown/Home/End while hovered. Per-frame cost depends only on
+// the number of visible rows, not on how much the source holds.
+class VirtualTextView {
+public:
+    VirtualTextView(Rectangle bounds, int fontSize, Color color, bool followTail = false);
+
+    void setSource(const RowSource* src) { source = src; }
+
+    // Returns true if the view needs redrawing (scrolled, or the source changed)
+    bool update();
+    void draw() const;
+
+    size_t visibleRows() const;
+    size_t firstVisibleRow() const;
+
+private:
+    void scrollBy(long long rows);
+
+    const RowSource* source = nullptr;
+    Rectangle bounds;
+    int fontSize;
+    int lineHeight;
+    Color color;
+    size_t firstRow = 0;
+    bool tail;
+    uint64_t seenGeneration = ~0ull;
+};
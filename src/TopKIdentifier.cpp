@@ -0,0 +1,97 @@
+#include "TopKIdentifier.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Min-heap on score so the weakest of the current K sits at the front
+bool weaker(const Candidate& a, const Candidate& b) {
+    return a.score > b.score || (a.score == b.score && a.fid < b.fid);
+}
+
+void offer(std::vector<Candidate>& heap, size_t k, const Candidate& c) {
+    if (heap.size() < k) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end(), weaker);
+    } else if (weaker(c, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), weaker);
+        heap.back() = c;
+        std::push_heap(heap.begin(), heap.end(), weaker);
+    }
+}
+
+} // namespace
+
+TopKIdentifier::TopKIdentifier(WorkerPool& pool) : pool(pool) {}
+
+TopKIdentifier::~TopKIdentifier() {
+    release();
+}
+
+bool TopKIdentifier::initialize() {
+    release();
+    for (size_t i = 0; i < pool.size(); ++i) {
+        HANDLE h = ZKFPM_DBInit();
+        if (!h) {
+            lastError = "Failed to create DB cache for top-K worker " + std::to_string(i) + ".";
+            release();
+            return false;
+        }
+        matchHandles.push_back(h);
+    }
+    return true;
+}
+
+void TopKIdentifier::release() {
+    for (HANDLE h : matchHandles) ZKFPM_DBFree(h);
+    matchHandles.clear();
+}
+
+bool TopKIdentifier::identify(const std::vector<GalleryEntry>& gallery, const unsigned char* tpl, unsigned int size,
+                              const TopKOptions& options, std::vector<Candidate>& candidates, bool* stoppedEarly) {
+    candidates.clear();
+    if (stoppedEarly) *stoppedEarly = false;
+    if (matchHandles.empty()) {
+        lastError = "Top-K identifier not initialized.";
+        return false;
+    }
+    if (!tpl || size == 0 || options.k == 0) {
+        lastError = "Invalid template or K.";
+        return false;
+    }
+    if (gallery.empty()) return true;
+
+    const size_t k = options.k;
+    std::vector<std::vector<Candidate>> heaps(pool.size()); // one per worker, no locking
+    for (auto& heap : heaps) heap.reserve(k);
+    std::atomic<bool> accepted{ false };
+
+    pool.parallelFor(gallery.size(), [&](size_t begin, size_t end) {
+        int worker = pool.currentWorker();
+        HANDLE h = matchHandles[worker];
+        std::vector<Candidate>& heap = heaps[worker];
+        for (size_t i = begin; i < end; ++i) {
+            if (options.acceptScore > 0 && accepted.load(std::memory_order_relaxed)) return;
+            const GalleryEntry& e = gallery[i];
+            int score = ZKFPM_DBMatch(h, const_cast<unsigned char*>(tpl), size,
+                                      const_cast<unsigned char*>(e.data), e.size);
+            if (score <= 0) continue;
+            offer(heap, k, { e.fid, score });
+            if (options.acceptScore > 0 && score >= options.acceptScore)
+                accepted.store(true, std::memory_order_relaxed);
+        }
+    }, TaskPriority::High, 64);
+
+    // At most workers*K survivors; a final partial sort picks the K best
+    for (const auto& heap : heaps) candidates.insert(candidates.end(), heap.begin(), heap.end());
+    size_t keep = std::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(), weaker);
+    candidates.resize(keep);
+    if (stoppedEarly) *stoppedEarly = accepted.load();
+    return true;
+}
+
+bool TopKIdentifier::identify(const FingerprintDevice& device, const unsigned char* tpl, unsigned int size,
+                              const TopKOptions& options, std::vector<Candidate>& candidates, bool* stoppedEarly) {
+    return identify(device.snapshotGallery(), tpl, size, options, candidates, stoppedEarly);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "FingerprintDevice.h"
+#include "WorkerPool.h"
+#include <string>
+#include <vector>
+
+struct Candidate {
+    unsigned int fid = 0;
+    int score = 0;
+};
+
+struct TopKOptions {
+    size_t k = 10;
+    // Stop scoring once any candidate reaches this (0 = always score the whole gallery).
+    // The list then holds the best K among the templates scored so far.
+    int acceptScore = 0;
+};
+
+// 1:N identify that returns the K best candidates with scores, for sending
+// borderline cases to an adjudicator. ZKFPM_DBIdentify only reports the single
+// best hit, so every template is scored with ZKFPM_DBMatch across the shared
+// pool. Each worker keeps a bounded min-heap of size K on its own DB handle;
+// the heaps are merged at the end.
+class TopKIdentifier {
+public:
+    explicit TopKIdentifier(WorkerPool& pool = WorkerPool::shared());
+    ~TopKIdentifier();
+
+    bool initialize();
+    void release();
+    std::string getLastError() const { return lastError; }
+
+    // Candidates come back best first. Returns false if nothing could be scored.
+    bool identify(const std::vector<GalleryEntry>& gallery, const unsigned char* tpl, unsigned int size,
+                  const TopKOptions& options, std::vector<Candidate>& candidates, bool* stoppedEarly = nullptr);
+    bool identify(const FingerprintDevice& device, const unsigned char* tpl, unsigned int size,
+                  const TopKOptions& options, std::vector<Candidate>& candidates, bool* stoppedEarly = nullptr);
+
+private:
+    WorkerPool& pool;
+    std::vector<HANDLE> matchHandles; // indexed by pool worker
+    std::string lastError;
+};
@@ -0,0 +1,266 @@
+#include "WorkerPool.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+thread_local const WorkerPool* tlsPool = nullptr;
+thread_local int tlsWorker = WorkerPool::AnyWorker;
+}
+
+WorkerPool::WorkerPool(size_t threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    startedAt = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < threadCount; ++i) workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < threadCount; ++i) workers[i]->thread = std::thread(&WorkerPool::workerLoop, this, i);
+    timerThread = std::thread(&WorkerPool::timerLoop, this);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timerStopping = true;
+    }
+    timerCv.notify_all();
+    timerThread.join();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    for (auto& w : workers) w->wakeCv.notify_one();
+    for (auto& w : workers) w->thread.join();
+}
+
+WorkerPool& WorkerPool::shared(size_t threadCount) {
+    static WorkerPool pool(threadCount);
+    return pool;
+}
+
+int WorkerPool::currentWorker() const {
+    return tlsPool == this ? tlsWorker : AnyWorker;
+}
+
+void WorkerPool::wake(size_t target, bool pinned) {
+    Worker* sleeper = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        if (pinned) {
+            // Only the target may run it; if it is busy it finds the job on its next pass
+            Worker& w = *workers[target];
+            w.pinnedGeneration++;
+            if (w.sleeping) sleeper = &w;
+        } else {
+            // Any worker can take it (by stealing), so wake one sleeper, the
+            // owner of the deque first
+            postGeneration++;
+            for (size_t k = 0; k < workers.size() && !sleeper; ++k) {
+                Worker& w = *workers[(target + k) % workers.size()];
+                if (w.sleeping) sleeper = &w;
+            }
+        }
+        // Claimed: the next post picks another sleeper
+        if (sleeper) sleeper->sleeping = false;
+    }
+    if (sleeper) sleeper->wakeCv.notify_one();
+}
+
+void WorkerPool::post(std::function<void()> job, TaskPriority priority, int affinity) {
+    size_t p = (size_t)priority;
+    if (affinity >= 0) {
+        size_t target = (size_t)affinity % workers.size();
+        Worker& w = *workers[target];
+        {
+            std::lock_guard<std::mutex> lock(w.mutex);
+            w.pinned[p].push_back(std::move(job));
+        }
+        wake(target, true);
+        return;
+    }
+
+    // Keep work local to the posting worker; spread external posts round-robin
+    int self = currentWorker();
+    size_t target = self >= 0 ? (size_t)self : roundRobin.fetch_add(1) % workers.size();
+    Worker& w = *workers[target];
+    {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.local[p].push_back(std::move(job));
+    }
+    wake(target, false);
+}
+
+void WorkerPool::postAfter(std::chrono::steady_clock::duration delay, std::function<void()> job,
+                           TaskPriority priority, int affinity) {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timers.push({ std::chrono::steady_clock::now() + delay, std::move(job), priority, affinity });
+    }
+    timerCv.notify_one();
+}
+
+bool WorkerPool::popLocal(size_t index, std::function<void()>& job, bool& wasPinned) {
+    Worker& w = *workers[index];
+    std::lock_guard<std::mutex> lock(w.mutex);
+    for (size_t p = 0; p < PriorityCount; ++p) {
+        if (!w.pinned[p].empty()) {
+            job = std::move(w.pinned[p].front());
+            w.pinned[p].pop_front();
+            wasPinned = true;
+            return true;
+        }
+        if (!w.local[p].empty()) {
+            // Newest first: its data is most likely still in this core's cache
+            job = std::move(w.local[p].back());
+            w.local[p].pop_back();
+            wasPinned = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkerPool::steal(size_t thief, std::function<void()>& job) {
+    size_t n = workers.size();
+    for (size_t p = 0; p < PriorityCount; ++p) {
+        for (size_t k = 1; k < n; ++k) {
+            Worker& victim = *workers[(thief + k) % n];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.local[p].empty()) {
+                // Oldest first from the victim, the opposite end to its own pops
+                job = std::move(victim.local[p].front());
+                victim.local[p].pop_front();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool WorkerPool::tryRunOne(size_t index) {
+    std::function<void()> job;
+    bool wasPinned = false;
+    bool wasStolen = false;
+    if (!popLocal(index, job, wasPinned)) {
+        if (!steal(index, job)) return false;
+        wasStolen = true;
+    }
+
+    Worker& w = *workers[index];
+    auto begin = std::chrono::steady_clock::now();
+    job();
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    w.busyNanos.fetch_add((uint64_t)nanos, std::memory_order_relaxed);
+    w.executed.fetch_add(1, std::memory_order_relaxed);
+    if (wasStolen) w.stolen.fetch_add(1, std::memory_order_relaxed);
+    if (wasPinned) w.pinnedRuns.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void WorkerPool::workerLoop(size_t index) {
+    tlsPool = this;
+    tlsWorker = (int)index;
+    Worker& w = *workers[index];
+    for (;;) {
+        uint64_t seen, seenPinned;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            seen = postGeneration;
+            seenPinned = w.pinnedGeneration;
+        }
+        if (tryRunOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping) return;
+        w.sleeping = true;
+        while (!stopping && postGeneration == seen && w.pinnedGeneration == seenPinned) w.wakeCv.wait(lock);
+        w.sleeping = false;
+    }
+}
+
+void WorkerPool::timerLoop() {
+    std::unique_lock<std::mutex> lock(timerMutex);
+    while (!timerStopping) {
+        if (timers.empty()) {
+            timerCv.wait(lock);
+            continue;
+        }
+        auto due = timers.top().due;
+        if (std::chrono::steady_clock::now() < due) {
+            timerCv.wait_until(lock, due);
+            continue;
+        }
+        Timer t = std::move(const_cast<Timer&>(timers.top()));
+        timers.pop();
+        lock.unlock();
+        post(std::move(t.job), t.priority, t.affinity);
+        lock.lock();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn,
+                             TaskPriority priority, size_t minSlice) {
+    if (count == 0) return;
+    size_t slices = std::min(workers.size() * 4, std::max<size_t>(1, count / std::max<size_t>(1, minSlice)));
+    size_t chunk = (count + slices - 1) / slices;
+    slices = (count + chunk - 1) / chunk;
+
+    struct Latch {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t remaining;
+    };
+    auto latch = std::make_shared<Latch>();
+    latch->remaining = slices;
+
+    for (size_t s = 0; s < slices; ++s) {
+        size_t begin = s * chunk, end = std::min(count, begin + chunk);
+        post([latch, &fn, begin, end] {
+            fn(begin, end);
+            std::lock_guard<std::mutex> lock(latch->mutex);
+            if (--latch->remaining == 0) latch->cv.notify_all();
+        }, priority);
+    }
+
+    int self = currentWorker();
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(latch->mutex);
+            if (latch->remaining == 0) return;
+            if (self < 0) {
+                latch->cv.wait(lock, [&] { return latch->remaining == 0; });
+                return;
+            }
+        }
+        // Inside the pool: help instead of blocking a worker
+        if (!tryRunOne((size_t)self)) {
+            std::unique_lock<std::mutex> lock(latch->mutex);
+            latch->cv.wait_for(lock, std::chrono::microseconds(200), [&] { return latch->remaining == 0; });
+        }
+    }
+}
+
+std::vector<WorkerPool::WorkerStats> WorkerPool::stats() const {
+    double lifetime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startedAt).count();
+    std::vector<WorkerStats> out;
+    for (const auto& w : workers) {
+        WorkerStats s;
+        s.executed = w->executed.load();
+        s.stolen = w->stolen.load();
+        s.pinned = w->pinnedRuns.load();
+        s.busySeconds = w->busyNanos.load() * 1e-9;
+        s.utilization = lifetime > 0.0 ? s.busySeconds / lifetime : 0.0;
+        out.push_back(s);
+    }
+    return out;
+}
+
+std::string WorkerPool::statsSummary() const {
+    std::string out;
+    char line[128];
+    auto all = stats();
+    for (size_t i = 0; i < all.size(); ++i) {
+        std::snprintf(line, sizeof(line), "worker %zu: %llu tasks, %llu stolen, %llu pinned, %.1f%% busy\n", i,
+                      (unsigned long long)all[i].executed, (unsigned long long)all[i].stolen,
+                      (unsigned long long)all[i].pinned, 100.0 * all[i].utilization);
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class TaskPriority { High = 0, Normal = 1, Low = 2 };
+
+// Process-wide work-stealing scheduler. Every worker owns a deque per
+// priority; idle workers steal from the others. Tasks posted with an
+// affinity go to that worker's pinned queue and are never stolen, which is
+// how SDK handles that must stay on one thread are served.
+class WorkerPool {
+public:
+    static constexpr int AnyWorker = -1;
+    static constexpr size_t PriorityCount = 3;
+
+    struct WorkerStats {
+        uint64_t executed = 0;
+        uint64_t stolen = 0;  // tasks this worker took from another worker's deque
+        uint64_t pinned = 0;  // tasks run from its affinity queue
+        double busySeconds = 0.0;
+        double utilization = 0.0; // busy / lifetime
+    };
+
+    explicit WorkerPool(size_t threadCount = 0); // 0 = hardware_concurrency
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // The one pool shared by capture, extraction, matching and batch jobs.
+    // threadCount only matters on the first call.
+    static WorkerPool& shared(size_t threadCount = 0);
+
+    void post(std::function<void()> job, TaskPriority priority = TaskPriority::Normal, int affinity = AnyWorker);
+    void postAfter(std::chrono::steady_clock::duration delay, std::function<void()> job,
+                   TaskPriority priority = TaskPriority::Normal, int affinity = AnyWorker);
+
+    // Fork-join: fn(begin, end) over [0, count) in slices; blocks until done.
+    // A worker thread calling this keeps running tasks while it waits.
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn,
+                     TaskPriority priority = TaskPriority::Normal, size_t minSlice = 1);
+
+    size_t size() const { return workers.size(); }
+    // Index of the calling worker, or AnyWorker when called from outside the pool
+    int currentWorker() const;
+    // Spread long-lived affinities (one per SDK handle) across workers
+    int nextAffinity() { return (int)(affinityCursor.fetch_add(1) % workers.size()); }
+
+    std::vector<WorkerStats> stats() const;
+    std::string statsSummary() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> local[PriorityCount];
+        std::deque<std::function<void()>> pinned[PriorityCount];
+        std::thread thread;
+        std::atomic<uint64_t> executed{ 0 };
+        std::atomic<uint64_t> stolen{ 0 };
+        std::atomic<uint64_t> pinnedRuns{ 0 };
+        std::atomic<uint64_t> busyNanos{ 0 };
+        // Guarded by sleepMutex: each worker sleeps on its own cv so a pinned
+        // post wakes only the worker that may run it
+        std::condition_variable wakeCv;
+        uint64_t pinnedGeneration = 0;
+        bool sleeping = false;
+    };
+
+    struct Timer {
+        std::chrono::steady_clock::time_point due;
+        std::function<void()> job;
+        TaskPriority priority;
+        int affinity;
+        bool operator>(const Timer& other) const { return due > other.due; }
+    };
+
+    void workerLoop(size_t index);
+    void timerLoop();
+    bool tryRunOne(size_t index);
+    bool popLocal(size_t index, std::function<void()>& job, bool& wasPinned);
+    bool steal(size_t thief, std::function<void()>& job);
+    void wake(size_t target, bool pinned);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::chrono::steady_clock::time_point startedAt;
+    std::atomic<size_t> roundRobin{ 0 };
+    std::atomic<size_t> affinityCursor{ 0 };
+
+    std::mutex sleepMutex;
+    uint64_t postGeneration = 0; // bumped by every unpinned post
+    bool stopping = false;
+
+    std::thread timerThread;
+    std::mutex timerMutex;
+    std::condition_variable timerCv;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    bool timerStopping = false;
+};